@@ -2,11 +2,64 @@
 #define CHUNKWM_PLUGIN_CVAR_H
 
 #include <stddef.h>
+#include <stdint.h>
 
+enum cvar_type
+{
+    CVar_String,
+    CVar_Integer,
+    CVar_Unsigned,
+    CVar_FloatingPoint,
+};
+
+union cvar_value
+{
+    int Integer;
+    unsigned Unsigned;
+    float FloatingPoint;
+};
+
+/*
+ * NOTE(koekeishiya): Value is the string that was last assigned to the cvar, and may only be
+ * accessed while holding the cvar lock. Whenever it changes, it is parsed according to the
+ * declared type of the cvar, and the type and the parsed value are stored together in Typed,
+ * so that readers can load both with a single atomic operation.
+ */
 struct cvar
 {
     const char *Name;
     char *Value;
+    uint64_t Typed;
+};
+
+/*
+ * NOTE(koekeishiya): A cvar is never freed or moved before chunkwm exits, so a plugin can
+ * look up a cvar once and keep the handle for as long as it is loaded.
+ */
+typedef cvar *cvar_handle;
+
+/*
+ * NOTE(koekeishiya): A copy of a set of cvars, taken while holding the cvar lock once, so
+ * that every entry reflects the same point in time. Type and Value are the declared type
+ * and the parsed value. A requested cvar that does not exist has a NULL String.
+ *
+ * The entries and the strings they point to are a single allocation, owned by the caller
+ * and released with free(Entries). Generation is the value of the cvar generation counter
+ * when the snapshot was taken; it is increased by every change to any cvar.
+ */
+struct cvar_snapshot_entry
+{
+    const char *Name;
+    const char *String;
+    cvar_type Type;
+    cvar_value Value;
+};
+
+struct cvar_snapshot
+{
+    cvar_snapshot_entry *Entries;
+    unsigned Count;
+    uint64_t Generation;
 };
 
 #define CHUNKWM_API_BROADCAST_FUNC(name) void name(const char *Plugin, const char *Event, void *Data, size_t Size)
@@ -21,6 +74,42 @@ typedef CHUNKWM_API_ACQUIRE_CVAR_FUNC(chunkwm_acquire_cvar_func);
 #define CHUNKWM_API_FIND_CVAR_FUNC(name) bool name(const char *Name)
 typedef CHUNKWM_API_FIND_CVAR_FUNC(chunkwm_find_cvar_func);
 
+// NOTE(koekeishiya): Create the cvar with the given value unless it already exists, and set its type.
+#define CHUNKWM_API_DECLARE_CVAR_FUNC(name) void name(const char *Name, cvar_type Type, char *Value)
+typedef CHUNKWM_API_DECLARE_CVAR_FUNC(chunkwm_declare_cvar_func);
+
+// NOTE(koekeishiya): Does not take the cvar lock if the cvar was declared with the requested type.
+#define CHUNKWM_API_ACQUIRE_CVAR_VALUE_FUNC(name) bool name(const char *Name, cvar_type Type, cvar_value *Value)
+typedef CHUNKWM_API_ACQUIRE_CVAR_VALUE_FUNC(chunkwm_acquire_cvar_value_func);
+
+// NOTE(koekeishiya): Returns NULL if the cvar does not exist.
+#define CHUNKWM_API_RESOLVE_CVAR_FUNC(name) cvar_handle name(const char *Name)
+typedef CHUNKWM_API_RESOLVE_CVAR_FUNC(chunkwm_resolve_cvar_func);
+
+#define CHUNKWM_API_ACQUIRE_CVAR_HANDLE_VALUE_FUNC(name) bool name(cvar_handle Handle, cvar_type Type, cvar_value *Value)
+typedef CHUNKWM_API_ACQUIRE_CVAR_HANDLE_VALUE_FUNC(chunkwm_acquire_cvar_handle_value_func);
+
+/*
+ * NOTE(koekeishiya): Whenever the cvar is created or assigned a different value, the plugin
+ * receives 'chunkwm_cvar_changed' through PluginMain, with the name of the cvar as Data.
+ * If Prefix is set, every cvar whose name starts with Name is watched. A '#' in Name matches
+ * one or more digits, such as the desktop index in '#_desktop_mode'. Plugin must be the
+ * name the plugin was built with; its watches are removed when it is unloaded.
+ */
+#define CHUNKWM_API_WATCH_CVAR_FUNC(name) void name(const char *Plugin, const char *Name, bool Prefix)
+typedef CHUNKWM_API_WATCH_CVAR_FUNC(chunkwm_watch_cvar_func);
+
+// NOTE(koekeishiya): Entries are in the same order as Names.
+#define CHUNKWM_API_ACQUIRE_CVAR_SNAPSHOT_FUNC(name) void name(const char **Names, unsigned Count, cvar_snapshot *Snapshot)
+typedef CHUNKWM_API_ACQUIRE_CVAR_SNAPSHOT_FUNC(chunkwm_acquire_cvar_snapshot_func);
+
+// NOTE(koekeishiya): Every cvar whose name starts with Prefix, in no particular order.
+#define CHUNKWM_API_ACQUIRE_CVAR_PREFIX_SNAPSHOT_FUNC(name) void name(const char *Prefix, cvar_snapshot *Snapshot)
+typedef CHUNKWM_API_ACQUIRE_CVAR_PREFIX_SNAPSHOT_FUNC(chunkwm_acquire_cvar_prefix_snapshot_func);
+
+#define CHUNKWM_API_CVAR_GENERATION_FUNC(name) uint64_t name()
+typedef CHUNKWM_API_CVAR_GENERATION_FUNC(chunkwm_cvar_generation_func);
+
 #ifdef CHUNKWM_CORE
 #define CHUNKWM_API_LOG_FUNC(name) void name(unsigned Level, const char *Format, ...)
 #else
@@ -28,6 +117,10 @@ typedef CHUNKWM_API_FIND_CVAR_FUNC(chunkwm_find_cvar_func);
 #endif
 typedef CHUNKWM_API_LOG_FUNC(chunkwm_log);
 
+// NOTE(koekeishiya): Publish the window count and layout of a desktop to the shared state page.
+#define CHUNKWM_API_PUBLISH_DESKTOP_FUNC(name) void name(unsigned DesktopId, unsigned MonitorId, unsigned WindowCount, const char *Mode)
+typedef CHUNKWM_API_PUBLISH_DESKTOP_FUNC(chunkwm_publish_desktop_func);
+
 struct chunkwm_api
 {
     chunkwm_update_cvar_func *UpdateCVar;
@@ -35,6 +128,15 @@ struct chunkwm_api
     chunkwm_find_cvar_func *FindCVar;
     plugin_broadcast_func *Broadcast;
     chunkwm_log *Log;
+    chunkwm_publish_desktop_func *PublishDesktop;
+    chunkwm_declare_cvar_func *DeclareCVar;
+    chunkwm_acquire_cvar_value_func *AcquireCVarValue;
+    chunkwm_resolve_cvar_func *ResolveCVar;
+    chunkwm_acquire_cvar_handle_value_func *AcquireCVarHandleValue;
+    chunkwm_watch_cvar_func *WatchCVar;
+    chunkwm_acquire_cvar_snapshot_func *AcquireCVarSnapshot;
+    chunkwm_acquire_cvar_prefix_snapshot_func *AcquireCVarPrefixSnapshot;
+    chunkwm_cvar_generation_func *CVarGeneration;
 };
 
 #endif
@@ -1,54 +1,385 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
 
 #include <libproc.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 
 // NOTE(koekeishiya): 3920 is the port used by chunkwm.
 #define FALLBACK_PORT 3920
 
-int main(int Argc, char **Argv)
+// NOTE(koekeishiya): Must match the framed protocol in 'src/common/ipc/daemon.h'.
+#define SOCKET_PATH_FMT     "/tmp/chunkwm_%s.socket"
+#define MAX_REQUEST         (1 << 24)
+#define RESPONSE_END        '\0'
+
+static int
+ConnectToSocket(const char *Path)
 {
-    if (Argc < 2) {
-        fprintf(stderr, "chunkc: no arguments found!\n");
-        exit(1);
+    struct sockaddr_un SrvAddr;
+    if (strlen(Path) >= sizeof(SrvAddr.sun_path)) {
+        return -1;
+    }
+
+    int SockFD = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (SockFD == -1) {
+        return -1;
     }
 
-    int Port;
+    memset(&SrvAddr, 0, sizeof(SrvAddr));
+    SrvAddr.sun_family = AF_UNIX;
+    strcpy(SrvAddr.sun_path, Path);
 
-    char *PortEnv = getenv("CHUNKC_SOCKET");
-    if (PortEnv) {
-        sscanf(PortEnv, "%d", &Port);
-    } else {
-        Port = FALLBACK_PORT;
+    if (connect(SockFD, (struct sockaddr *) &SrvAddr, sizeof(SrvAddr)) == -1) {
+        close(SockFD);
+        return -1;
     }
 
-    int SockFD;
+    return SockFD;
+}
+
+static int
+ConnectToPort(int Port)
+{
     struct sockaddr_in SrvAddr;
     struct hostent *Server;
 
-    if ((SockFD = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
-        fprintf(stderr, "chunkc: could not create socket!\n");
-        exit(1);
+    int SockFD = socket(AF_INET, SOCK_STREAM, 0);
+    if (SockFD == -1) {
+        return -1;
     }
 
     Server = gethostbyname("localhost");
+    if (!Server) {
+        close(SockFD);
+        return -1;
+    }
+
     SrvAddr.sin_family = AF_INET;
     SrvAddr.sin_port = htons(Port);
     memcpy(&SrvAddr.sin_addr.s_addr, Server->h_addr, Server->h_length);
     memset(&SrvAddr.sin_zero, '\0', 8);
 
     if (connect(SockFD, (struct sockaddr*) &SrvAddr, sizeof(struct sockaddr)) == -1) {
+        close(SockFD);
+        return -1;
+    }
+
+    return SockFD;
+}
+
+/*
+ * NOTE(koekeishiya): 'CHUNKC_SOCKET' may be set to a port number, for compatibility, or to
+ * the path of a unix domain socket. If it is not set, we try the unix domain socket of the
+ * current user first, and fall back to the loopback port.
+ */
+static int
+ConnectToDaemon()
+{
+    char *SocketEnv = getenv("CHUNKC_SOCKET");
+    if (SocketEnv) {
+        if (isdigit(SocketEnv[0])) {
+            int Port;
+            sscanf(SocketEnv, "%d", &Port);
+            return ConnectToPort(Port);
+        }
+
+        return ConnectToSocket(SocketEnv);
+    }
+
+    char *User = getenv("USER");
+    if (User) {
+        char Path[256];
+        snprintf(Path, sizeof(Path), SOCKET_PATH_FMT, User);
+
+        int SockFD = ConnectToSocket(Path);
+        if (SockFD != -1) {
+            return SockFD;
+        }
+    }
+
+    return ConnectToPort(FALLBACK_PORT);
+}
+
+static int
+SendAll(int SockFD, const char *Buffer, size_t Length)
+{
+    while (Length > 0) {
+        ssize_t Sent = send(SockFD, Buffer, Length, 0);
+        if (Sent == -1) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+
+        Buffer += Sent;
+        Length -= Sent;
+    }
+
+    return 1;
+}
+
+static int
+SendRequest(int SockFD, const char *Message, size_t Length)
+{
+    if (Length >= MAX_REQUEST) {
+        return 0;
+    }
+
+    uint32_t Header = htonl((uint32_t) Length);
+    return SendAll(SockFD, (const char *) &Header, sizeof(Header)) &&
+           SendAll(SockFD, Message, Length);
+}
+
+/*
+ * NOTE(koekeishiya): Print the response until we reach the terminator. Returns the status
+ * byte that follows the terminator, or -1 if the connection was closed before that.
+ */
+static int
+ReadResponse(int SockFD)
+{
+    char Response[BUFSIZ];
+    int Terminated = 0;
+
+    for (;;) {
+        ssize_t BytesRead = recv(SockFD, Response, sizeof(Response), 0);
+        if (BytesRead == -1 && errno == EINTR) continue;
+        if (BytesRead <= 0) return -1;
+
+        if (Terminated) {
+            return (unsigned char) Response[0];
+        }
+
+        char *End = memchr(Response, RESPONSE_END, BytesRead);
+        size_t Length = End ? (size_t)(End - Response) : (size_t) BytesRead;
+        fwrite(Response, 1, Length, stdout);
+        fflush(stdout);
+
+        if (End) {
+            if (Length + 1 < (size_t) BytesRead) {
+                return (unsigned char) Response[Length + 1];
+            }
+            Terminated = 1;
+        }
+    }
+}
+
+struct batch_command
+{
+    const char *Text;
+    size_t Length;
+    int Line;
+};
+
+struct batch
+{
+    char *Input;
+    char *Requests;
+    size_t RequestLength;
+    struct batch_command *Commands;
+    int Count;
+};
+
+static char *
+ReadFile(FILE *File, size_t *Length)
+{
+    size_t Capacity = BUFSIZ;
+    char *Result = malloc(Capacity);
+
+    *Length = 0;
+    for (;;) {
+        if (*Length + BUFSIZ > Capacity) {
+            Capacity *= 2;
+            Result = realloc(Result, Capacity);
+        }
+
+        size_t BytesRead = fread(Result + *Length, 1, BUFSIZ, File);
+        if (BytesRead == 0) break;
+        *Length += BytesRead;
+    }
+
+    return Result;
+}
+
+/*
+ * NOTE(koekeishiya): Every line of the batch is one command, exactly as it would be sent
+ * by 'chunkc <command>'. Empty lines and lines starting with '#' are skipped. All commands
+ * are framed into a single buffer up front, so that they can be written back to back.
+ */
+static int
+ParseBatch(FILE *File, struct batch *Batch)
+{
+    size_t Length;
+    Batch->Input = ReadFile(File, &Length);
+    Batch->Requests = malloc(Length + 1 + (Length / 2 + 1) * sizeof(uint32_t));
+    Batch->RequestLength = 0;
+    Batch->Commands = malloc((Length / 2 + 1) * sizeof(struct batch_command));
+    Batch->Count = 0;
+
+    int Line = 0;
+    char *At = Batch->Input;
+    char *End = Batch->Input + Length;
+
+    while (At < End) {
+        char *LineEnd = memchr(At, '\n', End - At);
+        if (!LineEnd) LineEnd = End;
+        ++Line;
+
+        char *Start = At;
+        char *Stop = LineEnd;
+        At = LineEnd + 1;
+
+        while (Start < Stop && isspace((unsigned char) *Start)) ++Start;
+        while (Stop > Start && isspace((unsigned char) *(Stop - 1))) --Stop;
+        if (Start == Stop || *Start == '#') continue;
+
+        size_t CommandLength = Stop - Start;
+        if (CommandLength >= MAX_REQUEST) {
+            fprintf(stderr, "chunkc: line %d is too long!\n", Line);
+            return 0;
+        }
+
+        uint32_t Header = htonl((uint32_t) CommandLength);
+        memcpy(Batch->Requests + Batch->RequestLength, &Header, sizeof(Header));
+        memcpy(Batch->Requests + Batch->RequestLength + sizeof(Header), Start, CommandLength);
+        Batch->RequestLength += sizeof(Header) + CommandLength;
+
+        struct batch_command *Command = &Batch->Commands[Batch->Count++];
+        Command->Text = Start;
+        Command->Length = CommandLength;
+        Command->Line = Line;
+    }
+
+    return 1;
+}
+
+/*
+ * NOTE(koekeishiya): Requests are written while responses are being read, because the
+ * daemon only has so much room for responses that we have not yet read. Responses are
+ * printed in order; commands that fail are reported with their line number. Returns 0
+ * if every command succeeded.
+ */
+static int
+RunBatch(int SockFD, struct batch *Batch)
+{
+    size_t Sent = 0;
+    int Completed = 0;
+    int Failed = 0;
+    int Terminated = 0;
+
+    fcntl(SockFD, F_SETFL, fcntl(SockFD, F_GETFL, 0) | O_NONBLOCK);
+
+    while (Completed < Batch->Count) {
+        struct pollfd PollFD = { SockFD, POLLIN, 0 };
+        if (Sent < Batch->RequestLength) PollFD.events |= POLLOUT;
+
+        if (poll(&PollFD, 1, -1) == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (PollFD.revents & POLLOUT) {
+            ssize_t BytesSent = send(SockFD, Batch->Requests + Sent, Batch->RequestLength - Sent, 0);
+            if (BytesSent > 0) {
+                Sent += BytesSent;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                break;
+            }
+        }
+
+        if (PollFD.revents & (POLLIN | POLLHUP | POLLERR)) {
+            char Response[BUFSIZ];
+            ssize_t BytesRead = recv(SockFD, Response, sizeof(Response), 0);
+            if (BytesRead == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) continue;
+            if (BytesRead <= 0) break;
+
+            char *At = Response;
+            char *End = Response + BytesRead;
+            while (At < End && Completed < Batch->Count) {
+                if (Terminated) {
+                    if (*At != 0) {
+                        struct batch_command *Command = &Batch->Commands[Completed];
+                        fprintf(stderr, "chunkc: line %d failed: %.*s\n", Command->Line, (int) Command->Length, Command->Text);
+                        ++Failed;
+                    }
+
+                    ++Completed;
+                    Terminated = 0;
+                    ++At;
+                } else {
+                    char *Stop = memchr(At, RESPONSE_END, End - At);
+                    size_t Length = Stop ? (size_t)(Stop - At) : (size_t)(End - At);
+                    fwrite(At, 1, Length, stdout);
+                    At += Length;
+
+                    if (Stop) {
+                        Terminated = 1;
+                        ++At;
+                    }
+                }
+            }
+            fflush(stdout);
+        }
+    }
+
+    if (Completed < Batch->Count) {
+        fprintf(stderr, "chunkc: connection closed after %d of %d commands!\n", Completed, Batch->Count);
+        return 1;
+    }
+
+    return Failed ? 1 : 0;
+}
+
+static int
+BatchFromFile(int SockFD, const char *Path)
+{
+    FILE *File = stdin;
+    if (Path && strcmp(Path, "-") != 0) {
+        File = fopen(Path, "r");
+        if (!File) {
+            fprintf(stderr, "chunkc: could not open '%s'!\n", Path);
+            return 1;
+        }
+    }
+
+    struct batch Batch;
+    int Result = ParseBatch(File, &Batch) ? RunBatch(SockFD, &Batch) : 1;
+
+    if (File != stdin) fclose(File);
+    free(Batch.Input);
+    free(Batch.Requests);
+    free(Batch.Commands);
+    return Result;
+}
+
+int main(int Argc, char **Argv)
+{
+    if (Argc < 2) {
+        fprintf(stderr, "chunkc: no arguments found!\n");
+        exit(1);
+    }
+
+    int SockFD = ConnectToDaemon();
+    if (SockFD == -1) {
         fprintf(stderr, "chunkc: connection failed!\n");
         exit(1);
     }
 
+    if (strcmp(Argv[1], "--batch") == 0) {
+        int Result = BatchFromFile(SockFD, Argc > 2 ? Argv[2] : NULL);
+        close(SockFD);
+        return Result;
+    }
+
     size_t MessageLength = Argc - 1;
     size_t Argl[Argc];
 
@@ -57,7 +388,7 @@ int main(int Argc, char **Argv)
         MessageLength += Argl[Index];
     }
 
-    char Message[MessageLength];
+    char *Message = malloc(MessageLength);
     char *Temp = Message;
 
     for (size_t Index = 1; Index < Argc; ++Index) {
@@ -67,34 +398,16 @@ int main(int Argc, char **Argv)
     }
     *(Temp - 1) = '\0';
 
-    if (send(SockFD, Message, MessageLength, 0) == -1) {
+    int Status = -1;
+    if (!SendRequest(SockFD, Message, MessageLength - 1)) {
         fprintf(stderr, "chunkc: failed to send data!\n");
-    } else {
-        // NOTE(koekeishiya): Should we read and print a response ??
-        struct timeval TimeVal;
-        fd_set ReadFDs;
-
-        TimeVal.tv_sec = 0;
-        TimeVal.tv_usec = 10000;
-
-        FD_ZERO(&ReadFDs);
-        FD_SET(SockFD, &ReadFDs);
-
-        select(SockFD + 1, &ReadFDs, NULL, NULL, &TimeVal);
-        if (FD_ISSET(SockFD, &ReadFDs)) {
-            char Response[BUFSIZ];
-            int BytesRead;
-
-            while ((BytesRead = recv(SockFD, Response, sizeof(Response) - 1, 0)) > 0) {
-                Response[BytesRead] = '\0';
-                printf("%s", Response);
-                fflush(stdout);
-            }
-        }
+    } else if ((Status = ReadResponse(SockFD)) == -1) {
+        fprintf(stderr, "chunkc: connection closed before the response was complete!\n");
     }
 
+    free(Message);
     shutdown(SockFD, SHUT_RDWR);
     close(SockFD);
 
-    return 0;
+    return Status == 0 ? 0 : 1;
 }
@@ -0,0 +1,111 @@
+#include "chunkstate.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// NOTE(koekeishiya): Must match 'src/core/statepage.cpp'.
+#define STATE_PAGE_NAME_MAX 32
+
+/*
+ * NOTE(koekeishiya): An update takes no more than a few hundred nanoseconds. If the page
+ * is still being written after this many attempts, chunkwm is not going to finish it.
+ */
+#define READ_ATTEMPTS       (1 << 16)
+
+int ChunkStateOpen(struct chunkstate *State, const char *User)
+{
+    State->Page = NULL;
+    State->Sequence = 0;
+
+    if (!User) User = getenv("USER");
+    if (!User) return 0;
+
+    char Name[STATE_PAGE_NAME_MAX];
+    if (snprintf(Name, sizeof(Name), STATE_PAGE_NAME_FMT, User) >= (int) sizeof(Name)) {
+        return 0;
+    }
+
+    int FD = shm_open(Name, O_RDONLY, 0);
+    if (FD == -1) {
+        return 0;
+    }
+
+    /*
+     * NOTE(koekeishiya): chunkwm only publishes into an object that nobody else can access.
+     * Anything else was created by someone else, and its contents cannot be trusted.
+     */
+    struct stat Buffer;
+    if ((fstat(FD, &Buffer) == -1) ||
+        (Buffer.st_uid != geteuid()) ||
+        (Buffer.st_mode & (S_IRWXG | S_IRWXO)) ||
+        (Buffer.st_size < (off_t) sizeof(struct state_page))) {
+        close(FD);
+        return 0;
+    }
+
+    void *Memory = mmap(NULL, sizeof(struct state_page), PROT_READ, MAP_SHARED, FD, 0);
+    close(FD);
+
+    if (Memory == MAP_FAILED) {
+        return 0;
+    }
+
+    State->Page = (const struct state_page *) Memory;
+    return 1;
+}
+
+void ChunkStateClose(struct chunkstate *State)
+{
+    if (State->Page) {
+        munmap((void *) State->Page, sizeof(struct state_page));
+        State->Page = NULL;
+    }
+}
+
+int ChunkStateChanged(struct chunkstate *State)
+{
+    uint32_t Sequence = __atomic_load_n(&State->Page->Sequence, __ATOMIC_ACQUIRE);
+    return Sequence != State->Sequence;
+}
+
+int ChunkStateRead(struct chunkstate *State, struct state_page *Snapshot)
+{
+    const struct state_page *Page = State->Page;
+
+    for (int Attempt = 0; Attempt < READ_ATTEMPTS; ++Attempt) {
+        uint32_t Begin = __atomic_load_n(&Page->Sequence, __ATOMIC_ACQUIRE);
+        if (Begin & 1) continue;
+
+        memcpy(Snapshot, Page, sizeof(struct state_page));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        uint32_t End = __atomic_load_n(&Page->Sequence, __ATOMIC_RELAXED);
+        if (Begin != End) continue;
+
+        State->Sequence = Begin;
+        if ((Snapshot->Magic != STATE_PAGE_MAGIC) ||
+            (Snapshot->Version != STATE_PAGE_VERSION) ||
+            (Snapshot->Size != sizeof(struct state_page))) {
+            return 0;
+        }
+
+        // NOTE(koekeishiya): chunkwm always terminates these, but we do not have to trust it.
+        Snapshot->FocusedOwner[STATE_PAGE_OWNER_SIZE - 1] = '\0';
+        Snapshot->FocusedName[STATE_PAGE_NAME_SIZE - 1] = '\0';
+        if (Snapshot->DesktopCount > STATE_PAGE_MAX_DESKTOPS) {
+            Snapshot->DesktopCount = STATE_PAGE_MAX_DESKTOPS;
+        }
+        for (uint32_t Index = 0; Index < Snapshot->DesktopCount; ++Index) {
+            Snapshot->Desktops[Index].Mode[STATE_PAGE_MODE_SIZE - 1] = '\0';
+        }
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+#ifndef CHUNKSTATE_H
+#define CHUNKSTATE_H
+
+#include "../common/ipc/statepage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * NOTE(koekeishiya): Reads the state that chunkwm publishes in shared memory, without
+ * talking to the daemon. Once the page is mapped, checking for changes and reading a
+ * consistent copy do not make any system calls.
+ *
+ *     struct chunkstate State;
+ *     struct state_page Snapshot;
+ *     if (ChunkStateOpen(&State, NULL)) {
+ *         if (ChunkStateChanged(&State) && ChunkStateRead(&State, &Snapshot)) {
+ *             printf("%u: %s\n", Snapshot.ActiveDesktop, Snapshot.FocusedOwner);
+ *         }
+ *         ChunkStateClose(&State);
+ *     }
+ */
+struct chunkstate
+{
+    const struct state_page *Page;
+    uint32_t Sequence;
+};
+
+// NOTE(koekeishiya): User may be NULL, in which case $USER is used. Returns 1 on success.
+int ChunkStateOpen(struct chunkstate *State, const char *User);
+void ChunkStateClose(struct chunkstate *State);
+
+// NOTE(koekeishiya): Returns 1 if the page has been updated since it was last read.
+int ChunkStateChanged(struct chunkstate *State);
+
+/*
+ * NOTE(koekeishiya): Copies a consistent snapshot of the page. Returns 0 if chunkwm has not
+ * initialized the page, it was written by an incompatible version, or no consistent copy
+ * could be made because chunkwm stopped in the middle of an update.
+ */
+int ChunkStateRead(struct chunkstate *State, struct state_page *Snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
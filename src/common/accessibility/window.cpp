@@ -73,9 +73,9 @@ macos_window *AXLibCopyWindow(macos_window *Window)
     Result->Id = Window->Id;
     Result->Name = strdup(Window->Name);
     Result->Level = Window->Level;
-    Result->Position = Window->Position;
-    Result->Size = Window->Size;
-    Result->Flags = Window->Flags;
+    Result->Position = AXLibLoadWindowPosition(Window);
+    Result->Size = AXLibLoadWindowSize(Window);
+    Result->Flags = __atomic_load_n(&Window->Flags, __ATOMIC_RELAXED);
 
     return Result;
 }
@@ -28,6 +28,15 @@ enum macos_window_flags
 };
 
 struct macos_application;
+/*
+ * NOTE(koekeishiya): Plugins process events on their own threads, while the core keeps
+ * updating the same 'macos_window'. From a plugin it is safe to read 'Ref', 'Owner', 'Id',
+ * 'Level', 'Mainrole', 'Subrole' and 'Name'; roles and titles that are replaced are only
+ * released once every plugin has caught up. 'Flags' must be read through 'AXLibHasFlags',
+ * and 'Position' and 'Size' through 'AXLibLoadWindowPosition' and 'AXLibLoadWindowSize',
+ * which may observe components from two different updates. The window passed with
+ * 'window_moved' and 'window_resized' is a private snapshot whose geometry is consistent.
+ */
 struct macos_window
 {
     AXUIElementRef Ref;
@@ -58,19 +67,51 @@ macos_window **AXLibWindowListForApplication(macos_application *Application);
 inline void
 AXLibAddFlags(macos_window *Window, uint32_t Flag)
 {
-    Window->Flags |= Flag;
+    __atomic_or_fetch(&Window->Flags, Flag, __ATOMIC_RELAXED);
 }
 
 inline void
 AXLibClearFlags(macos_window *Window, uint32_t Flag)
 {
-    Window->Flags &= ~Flag;
+    __atomic_and_fetch(&Window->Flags, ~Flag, __ATOMIC_RELAXED);
 }
 
 inline bool
 AXLibHasFlags(macos_window *Window, uint32_t Flag)
 {
-    bool Result = ((Window->Flags & Flag) != 0);
+    bool Result = ((__atomic_load_n(&Window->Flags, __ATOMIC_RELAXED) & Flag) != 0);
+    return Result;
+}
+
+inline void
+AXLibStoreWindowPosition(macos_window *Window, CGPoint Position)
+{
+    __atomic_store(&Window->Position.x, &Position.x, __ATOMIC_RELAXED);
+    __atomic_store(&Window->Position.y, &Position.y, __ATOMIC_RELAXED);
+}
+
+inline void
+AXLibStoreWindowSize(macos_window *Window, CGSize Size)
+{
+    __atomic_store(&Window->Size.width, &Size.width, __ATOMIC_RELAXED);
+    __atomic_store(&Window->Size.height, &Size.height, __ATOMIC_RELAXED);
+}
+
+inline CGPoint
+AXLibLoadWindowPosition(macos_window *Window)
+{
+    CGPoint Result;
+    __atomic_load(&Window->Position.x, &Result.x, __ATOMIC_RELAXED);
+    __atomic_load(&Window->Position.y, &Result.y, __ATOMIC_RELAXED);
+    return Result;
+}
+
+inline CGSize
+AXLibLoadWindowSize(macos_window *Window)
+{
+    CGSize Result;
+    __atomic_load(&Window->Size.width, &Result.width, __ATOMIC_RELAXED);
+    __atomic_load(&Window->Size.height, &Result.height, __ATOMIC_RELAXED);
     return Result;
 }
 
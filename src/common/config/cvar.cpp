@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
 
 #define internal static
@@ -51,61 +52,147 @@ void UpdateCVar(const char *Name, char *Value)
     ChunkwmAPI->UpdateCVar(Name, Value);
 }
 
+internal void
+DeclareCVar(const char *Name, cvar_type Type, const char *Format, ...)
+{
+    char String[256];
+
+    va_list Args;
+    va_start(Args, Format);
+    vsnprintf(String, sizeof(String), Format, Args);
+    va_end(Args);
+
+    ChunkwmAPI->DeclareCVar(Name, Type, String);
+}
+
 void CreateCVar(const char *Name, int Value)
 {
-    if (CVarExists(Name)) return;
-    UpdateCVar(Name, Value);
+    DeclareCVar(Name, CVar_Integer, "%d", Value);
 }
 
 void CreateCVar(const char *Name, unsigned Value)
 {
-    if (CVarExists(Name)) return;
-    UpdateCVar(Name, Value);
+    DeclareCVar(Name, CVar_Unsigned, "%x", Value);
 }
 
 void CreateCVar(const char *Name, float Value)
 {
-    if (CVarExists(Name)) return;
-    UpdateCVar(Name, Value);
+    DeclareCVar(Name, CVar_FloatingPoint, "%f", Value);
 }
 
 void CreateCVar(const char *Name, char *Value)
 {
-    if (CVarExists(Name)) return;
-    UpdateCVar(Name, Value);
+    ChunkwmAPI->DeclareCVar(Name, CVar_String, Value);
 }
 
 int CVarIntegerValue(const char *Name)
+{
+    cvar_value Value;
+    return ChunkwmAPI->AcquireCVarValue(Name, CVar_Integer, &Value) ? Value.Integer : 0;
+}
+
+int CVarUnsignedValue(const char *Name)
+{
+    cvar_value Value;
+    return ChunkwmAPI->AcquireCVarValue(Name, CVar_Unsigned, &Value) ? Value.Unsigned : 0;
+}
+
+float CVarFloatingPointValue(const char *Name)
+{
+    cvar_value Value;
+    return ChunkwmAPI->AcquireCVarValue(Name, CVar_FloatingPoint, &Value) ? Value.FloatingPoint : 0.0f;
+}
+
+char *CVarStringValue(const char *Name)
+{
+    return ChunkwmAPI->AcquireCVar(Name);
+}
+
+void WatchCVar(const char *Plugin, const char *Name)
+{
+    ChunkwmAPI->WatchCVar(Plugin, Name, false);
+}
+
+void WatchCVarPrefix(const char *Plugin, const char *Prefix)
+{
+    ChunkwmAPI->WatchCVar(Plugin, Prefix, true);
+}
+
+cvar_handle CVarHandle(const char *Name)
+{
+    return ChunkwmAPI->ResolveCVar(Name);
+}
+
+int CVarIntegerValue(cvar_handle Handle)
+{
+    cvar_value Value;
+    return ChunkwmAPI->AcquireCVarHandleValue(Handle, CVar_Integer, &Value) ? Value.Integer : 0;
+}
+
+int CVarUnsignedValue(cvar_handle Handle)
+{
+    cvar_value Value;
+    return ChunkwmAPI->AcquireCVarHandleValue(Handle, CVar_Unsigned, &Value) ? Value.Unsigned : 0;
+}
+
+float CVarFloatingPointValue(cvar_handle Handle)
+{
+    cvar_value Value;
+    return ChunkwmAPI->AcquireCVarHandleValue(Handle, CVar_FloatingPoint, &Value) ? Value.FloatingPoint : 0.0f;
+}
+
+void AcquireCVarSnapshot(const char **Names, unsigned Count, cvar_snapshot *Snapshot)
+{
+    ChunkwmAPI->AcquireCVarSnapshot(Names, Count, Snapshot);
+}
+
+void AcquireCVarPrefixSnapshot(const char *Prefix, cvar_snapshot *Snapshot)
+{
+    ChunkwmAPI->AcquireCVarPrefixSnapshot(Prefix, Snapshot);
+}
+
+void ReleaseCVarSnapshot(cvar_snapshot *Snapshot)
+{
+    free(Snapshot->Entries);
+    Snapshot->Entries = NULL;
+    Snapshot->Count = 0;
+}
+
+uint64_t CVarGeneration()
+{
+    return ChunkwmAPI->CVarGeneration();
+}
+
+// NOTE(koekeishiya): Entries of a different declared type are parsed from their string value.
+int CVarIntegerValue(cvar_snapshot_entry *Entry)
 {
     int Result = 0;
-    char *String = ChunkwmAPI->AcquireCVar(Name);
-    if (String) {
-        sscanf(String, "%d", &Result);
+    if (Entry->Type == CVar_Integer) {
+        Result = Entry->Value.Integer;
+    } else if (Entry->String) {
+        sscanf(Entry->String, "%d", &Result);
     }
     return Result;
 }
 
-int CVarUnsignedValue(const char *Name)
+int CVarUnsignedValue(cvar_snapshot_entry *Entry)
 {
     unsigned Result = 0;
-    char *String = ChunkwmAPI->AcquireCVar(Name);
-    if (String) {
-        sscanf(String, "%x", &Result);
+    if (Entry->Type == CVar_Unsigned) {
+        Result = Entry->Value.Unsigned;
+    } else if (Entry->String) {
+        sscanf(Entry->String, "%x", &Result);
     }
     return Result;
 }
 
-float CVarFloatingPointValue(const char *Name)
+float CVarFloatingPointValue(cvar_snapshot_entry *Entry)
 {
     float Result = 0.0f;
-    char *String = ChunkwmAPI->AcquireCVar(Name);
-    if (String) {
-        sscanf(String, "%f", &Result);
+    if (Entry->Type == CVar_FloatingPoint) {
+        Result = Entry->Value.FloatingPoint;
+    } else if (Entry->String) {
+        sscanf(Entry->String, "%f", &Result);
     }
     return Result;
 }
-
-char *CVarStringValue(const char *Name)
-{
-    return ChunkwmAPI->AcquireCVar(Name);
-}
@@ -1,9 +1,17 @@
 #ifndef CHUNKWM_COMMON_CVAR_H
 #define CHUNKWM_COMMON_CVAR_H
 
+#include <stdint.h>
+
 struct chunkwm_api;
 void BeginCVars(chunkwm_api *Api);
 
+struct cvar;
+typedef cvar *cvar_handle;
+
+struct cvar_snapshot;
+struct cvar_snapshot_entry;
+
 bool CVarExists(const char *Name);
 
 void UpdateCVar(const char *Name, int Value);
@@ -21,4 +29,24 @@ int CVarUnsignedValue(const char *Name);
 float CVarFloatingPointValue(const char *Name);
 char *CVarStringValue(const char *Name);
 
+// NOTE(koekeishiya): The plugin receives 'chunkwm_cvar_changed' when a watched cvar changes.
+void WatchCVar(const char *Plugin, const char *Name);
+void WatchCVarPrefix(const char *Plugin, const char *Prefix);
+
+// NOTE(koekeishiya): Returns NULL if the cvar does not exist; resolve after creating the cvar.
+cvar_handle CVarHandle(const char *Name);
+
+int CVarIntegerValue(cvar_handle Handle);
+int CVarUnsignedValue(cvar_handle Handle);
+float CVarFloatingPointValue(cvar_handle Handle);
+
+void AcquireCVarSnapshot(const char **Names, unsigned Count, cvar_snapshot *Snapshot);
+void AcquireCVarPrefixSnapshot(const char *Prefix, cvar_snapshot *Snapshot);
+void ReleaseCVarSnapshot(cvar_snapshot *Snapshot);
+uint64_t CVarGeneration();
+
+int CVarIntegerValue(cvar_snapshot_entry *Entry);
+int CVarUnsignedValue(cvar_snapshot_entry *Entry);
+float CVarFloatingPointValue(cvar_snapshot_entry *Entry);
+
 #endif
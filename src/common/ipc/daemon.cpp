@@ -1,31 +1,166 @@
 #include "daemon.h"
+#include "../misc/assert.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <pthread.h>
 #include <string.h>
+#include <errno.h>
 
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include <vector>
+#include <queue>
+#include <map>
 
 #define internal static
 #define local_persist static
 
-internal int DaemonSockFD;
+#ifdef MSG_NOSIGNAL
+#define DAEMON_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define DAEMON_SEND_FLAGS 0
+#endif
+
+#define DAEMON_BUFFER_SIZE          4096
+#define DAEMON_BUFFER_POOL_SIZE     32
+#define DAEMON_MAX_PENDING_OUTPUT   (1 << 20)
+
+/*
+ * NOTE(koekeishiya): A buffer is borrowed while a request handed to the callback points into it;
+ * its data must not be moved until the request has been released.
+ */
+struct daemon_buffer
+{
+    char *Data;
+    size_t Offset;
+    size_t Length;
+    size_t Capacity;
+    bool Borrowed;
+    daemon_buffer *Next;
+};
+
+enum daemon_protocol
+{
+    Daemon_Protocol_Unknown,
+    Daemon_Protocol_Framed,
+    Daemon_Protocol_Legacy,
+};
+
+struct daemon_connection
+{
+    int SockFD;
+    int ResponseFD;
+    int HandlerFD;
+    char Status;
+    bool ReadClosed;
+    bool Broken;
+    bool InCallback;
+    daemon_protocol Protocol;
+    daemon_buffer *In;
+    daemon_buffer *Out;
+    size_t RequestSize;
+    char *RequestEnd;
+    char RequestSaved;
+};
+
+internal int DaemonSockFD = -1;
+internal int DaemonLocalSockFD = -1;
+internal int DaemonWakeFD[2] = { -1, -1 };
+internal char DaemonLocalPath[sizeof(((struct sockaddr_un *) 0)->sun_path)];
 internal bool IsRunning;
 internal pthread_t Thread;
 internal daemon_callback *ConnectionCallback;
 
-// NOTE(koekeishiya): Caller frees memory.
+// NOTE(koekeishiya): Requests submitted from within the process have a Task instead of a Connection.
+struct daemon_request
+{
+    daemon_connection *Connection;
+    const char *Message;
+    int SockFD;
+
+    daemon_task *Task;
+    void *Context;
+};
+
+internal pthread_t DispatchThread;
+internal pthread_mutex_t RequestLock;
+internal pthread_cond_t RequestCondition;
+internal std::queue<daemon_request> Requests;
+
+/*
+ * NOTE(koekeishiya): Maps the socket given to a handler to the connection its response belongs to,
+ * so that the handler can set the status of the response before it closes the socket.
+ */
+internal pthread_mutex_t StatusLock;
+internal std::map<int, daemon_connection *> StatusTable;
+
+internal std::vector<daemon_connection *> Connections;
+internal daemon_buffer *BufferPool;
+internal int BufferPoolCount;
+
+internal void
+DisableSigPipe(int SockFD)
+{
+#ifdef SO_NOSIGPIPE
+    int _True = 1;
+    setsockopt(SockFD, SOL_SOCKET, SO_NOSIGPIPE, &_True, sizeof(int));
+#endif
+}
+
+internal bool
+SendAll(int SockFD, const char *Buffer, size_t Length)
+{
+    while (Length > 0) {
+        ssize_t Sent = send(SockFD, Buffer, Length, DAEMON_SEND_FLAGS);
+        if (Sent == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        Buffer += Sent;
+        Length -= Sent;
+    }
+
+    return true;
+}
+
+/*
+ * NOTE(koekeishiya): Caller frees memory. Waits for the first part of the message, and then
+ * keeps reading for as long as more of it is immediately available.
+ */
 char *ReadFromSocket(int SockFD)
 {
-    int Length = 256;
-    char *Result = (char *) malloc(Length);
+    size_t Capacity = 256;
+    size_t Length = 0;
+    char *Result = (char *) malloc(Capacity);
+
+    int Flags = 0;
+    for (;;) {
+        if (Length + 1 == Capacity) {
+            Capacity *= 2;
+            Result = (char *) realloc(Result, Capacity);
+        }
+
+        ssize_t Received = recv(SockFD, Result + Length, Capacity - Length - 1, Flags);
+        if (Received > 0) {
+            Length += Received;
+            Flags = MSG_DONTWAIT;
+        } else if (Received == -1 && errno == EINTR) {
+            continue;
+        } else {
+            break;
+        }
+    }
 
-    Length = recv(SockFD, Result, Length, 0);
     if (Length > 0) {
         Result[Length] = '\0';
     } else {
@@ -36,9 +171,39 @@ char *ReadFromSocket(int SockFD)
     return Result;
 }
 
+void SetSocketStatus(int SockFD, int Status)
+{
+    pthread_mutex_lock(&StatusLock);
+    std::map<int, daemon_connection *>::iterator It = StatusTable.find(SockFD);
+    if (It != StatusTable.end()) {
+        It->second->Status = (char) Status;
+    }
+    pthread_mutex_unlock(&StatusLock);
+}
+
+bool IsSocketAbandoned(int SockFD)
+{
+    pthread_mutex_lock(&StatusLock);
+    std::map<int, daemon_connection *>::iterator It = StatusTable.find(SockFD);
+    bool Result = It != StatusTable.end() && __atomic_load_n(&It->second->Broken, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&StatusLock);
+    return Result;
+}
+
 void WriteToSocket(const char *Message, int SockFD)
 {
-    send(SockFD, Message, strlen(Message), 0);
+    SendAll(SockFD, Message, strlen(Message));
+}
+
+bool WriteRequestToSocket(const char *Message, size_t Length, int SockFD)
+{
+    if (Length >= DAEMON_MAX_REQUEST) {
+        return false;
+    }
+
+    uint32_t Header = htonl((uint32_t) Length);
+    return SendAll(SockFD, (const char *) &Header, DAEMON_FRAME_HEADER_SIZE) &&
+           SendAll(SockFD, Message, Length);
 }
 
 void CloseSocket(int SockFD)
@@ -48,21 +213,574 @@ void CloseSocket(int SockFD)
 }
 
 /*
- * NOTE(koekeishiya): The connection must be closed manually by the implementor of the connection callback !!!
+ * NOTE(koekeishiya): Buffers are recycled between connections, so that serving a request
+ * does not normally allocate. Buffers that had to grow for a large request are shrunk
+ * back to their default size before they are put back in the pool.
+ */
+internal daemon_buffer *
+AcquireBuffer()
+{
+    daemon_buffer *Buffer = BufferPool;
+    if (Buffer) {
+        BufferPool = Buffer->Next;
+        --BufferPoolCount;
+    } else {
+        Buffer = (daemon_buffer *) malloc(sizeof(daemon_buffer));
+        Buffer->Data = (char *) malloc(DAEMON_BUFFER_SIZE);
+        Buffer->Capacity = DAEMON_BUFFER_SIZE;
+    }
+
+    Buffer->Offset = 0;
+    Buffer->Length = 0;
+    Buffer->Borrowed = false;
+    Buffer->Next = NULL;
+    return Buffer;
+}
+
+internal void
+ReleaseBuffer(daemon_buffer *Buffer)
+{
+    if (BufferPoolCount >= DAEMON_BUFFER_POOL_SIZE) {
+        free(Buffer->Data);
+        free(Buffer);
+        return;
+    }
+
+    if (Buffer->Capacity > DAEMON_BUFFER_SIZE) {
+        Buffer->Data = (char *) realloc(Buffer->Data, DAEMON_BUFFER_SIZE);
+        Buffer->Capacity = DAEMON_BUFFER_SIZE;
+    }
+
+    Buffer->Next = BufferPool;
+    BufferPool = Buffer;
+    ++BufferPoolCount;
+}
+
+/*
+ * NOTE(koekeishiya): Make room for at least 'Size' more bytes after the data currently stored.
+ * A borrowed buffer is never moved; there is no room until the request has been released.
+ */
+internal bool
+BufferReserve(daemon_buffer *Buffer, size_t Size)
+{
+    ASSERT(!Buffer->Borrowed);
+    if (Buffer->Borrowed) {
+        return Buffer->Length + Size <= Buffer->Capacity;
+    }
+
+    if (Buffer->Offset > 0) {
+        memmove(Buffer->Data, Buffer->Data + Buffer->Offset, Buffer->Length - Buffer->Offset);
+        Buffer->Length -= Buffer->Offset;
+        Buffer->Offset = 0;
+    }
+
+    if (Buffer->Length + Size > Buffer->Capacity) {
+        size_t Capacity = Buffer->Capacity;
+        while (Buffer->Length + Size > Capacity) {
+            Capacity *= 2;
+        }
+
+        Buffer->Data = (char *) realloc(Buffer->Data, Capacity);
+        Buffer->Capacity = Capacity;
+    }
+
+    return true;
+}
+
+internal void
+BufferAppend(daemon_buffer *Buffer, const char *Data, size_t Size)
+{
+    BufferReserve(Buffer, Size);
+    memcpy(Buffer->Data + Buffer->Length, Data, Size);
+    Buffer->Length += Size;
+}
+
+internal inline size_t
+BufferPending(daemon_buffer *Buffer)
+{
+    return Buffer->Length - Buffer->Offset;
+}
+
+internal void
+BufferConsume(daemon_buffer *Buffer, size_t Size)
+{
+    Buffer->Offset += Size;
+    if (Buffer->Offset == Buffer->Length) {
+        Buffer->Offset = 0;
+        Buffer->Length = 0;
+    }
+}
+
+// NOTE(koekeishiya): Read by handlers through IsSocketAbandoned.
+internal inline void
+BreakConnection(daemon_connection *Connection)
+{
+    __atomic_store_n(&Connection->Broken, true, __ATOMIC_RELAXED);
+}
+
+internal void
+SetNonBlocking(int SockFD, bool NonBlocking)
+{
+    int Flags = fcntl(SockFD, F_GETFL, 0);
+    fcntl(SockFD, F_SETFL, NonBlocking ? (Flags | O_NONBLOCK) : (Flags & ~O_NONBLOCK));
+}
+
+internal void
+AddConnection(int SockFD)
+{
+    DisableSigPipe(SockFD);
+    SetNonBlocking(SockFD, true);
+
+    daemon_connection *Connection = (daemon_connection *) malloc(sizeof(daemon_connection));
+    Connection->SockFD = SockFD;
+    Connection->ResponseFD = -1;
+    Connection->HandlerFD = -1;
+    Connection->Status = DAEMON_STATUS_SUCCESS;
+    Connection->Protocol = Daemon_Protocol_Unknown;
+    Connection->ReadClosed = false;
+    Connection->Broken = false;
+    Connection->InCallback = false;
+    Connection->RequestSize = 0;
+    Connection->RequestEnd = NULL;
+    Connection->In = AcquireBuffer();
+    Connection->Out = AcquireBuffer();
+    Connections.push_back(Connection);
+}
+
+internal void
+DestroyConnection(daemon_connection *Connection)
+{
+    CloseSocket(Connection->SockFD);
+
+    ReleaseBuffer(Connection->In);
+    ReleaseBuffer(Connection->Out);
+    free(Connection);
+}
+
+/*
+ * NOTE(koekeishiya): Callbacks run one at a time on a thread of their own. A callback is free
+ * to write a large response, because the event loop keeps draining it for as long as the callback
+ * runs, even when the client is not reading. The event loop is woken when the callback returns,
+ * since the message may only be released after that.
+ */
+internal void
+DispatchRequest(daemon_connection *Connection, const char *Message, int SockFD)
+{
+    Connection->InCallback = true;
+
+    pthread_mutex_lock(&RequestLock);
+    Requests.push({ Connection, Message, SockFD, NULL, NULL });
+    pthread_cond_signal(&RequestCondition);
+    pthread_mutex_unlock(&RequestLock);
+}
+
+internal void *
+HandleRequests(void *)
+{
+    for (;;) {
+        pthread_mutex_lock(&RequestLock);
+        while (IsRunning && Requests.empty()) {
+            pthread_cond_wait(&RequestCondition, &RequestLock);
+        }
+
+        if (Requests.empty()) {
+            pthread_mutex_unlock(&RequestLock);
+            break;
+        }
+
+        daemon_request Request = Requests.front();
+        Requests.pop();
+        pthread_mutex_unlock(&RequestLock);
+
+        if (Request.Task) {
+            (*Request.Task)(Request.Context);
+            continue;
+        }
+
+        (*ConnectionCallback)(Request.Message, Request.SockFD);
+
+        __atomic_store_n(&Request.Connection->InCallback, false, __ATOMIC_RELEASE);
+        write(DaemonWakeFD[1], "", 1);
+    }
+
+    return NULL;
+}
+
+bool SubmitDaemonTask(daemon_task *Task, void *Context)
+{
+    // NOTE(koekeishiya): RequestLock is not initialized unless the daemon has been started.
+    if (!IsRunning) {
+        return false;
+    }
+
+    pthread_mutex_lock(&RequestLock);
+    bool Result = IsRunning;
+    if (Result) {
+        Requests.push({ NULL, NULL, -1, Task, Context });
+        pthread_cond_signal(&RequestCondition);
+    }
+    pthread_mutex_unlock(&RequestLock);
+    return Result;
+}
+
+/*
+ * NOTE(koekeishiya): Every framed request is handed to the callback together with one end of
+ * a socketpair. The callback writes its response and closes the socket whenever it is done,
+ * possibly from a different thread, exactly like it would with a connection of the old protocol.
+ * The event loop forwards everything to the client until it sees the end of the stream, and then
+ * terminates the response, so that the client knows the request is complete.
+ *
+ * The message is passed to the callback straight out of the read buffer of the connection, which
+ * is borrowed from TerminateRequest until ReleaseRequest. The request is released only once the
+ * callback has returned and the socket has been closed, and nothing reads into the buffer before
+ * that, because reading may compact or grow it; see RequestInFlight and ProcessRequests.
+ */
+internal void
+BeginRequest(daemon_connection *Connection, const char *Message)
+{
+    int Pair[2];
+    Connection->Status = DAEMON_STATUS_SUCCESS;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, Pair) == -1) {
+        if (Connection->Protocol == Daemon_Protocol_Framed) {
+            char Terminator[2] = { DAEMON_RESPONSE_END, DAEMON_STATUS_FAILURE };
+            BufferAppend(Connection->Out, Terminator, sizeof(Terminator));
+        }
+        return;
+    }
+
+    DisableSigPipe(Pair[0]);
+    DisableSigPipe(Pair[1]);
+    SetNonBlocking(Pair[0], true);
+    Connection->ResponseFD = Pair[0];
+    Connection->HandlerFD = Pair[1];
+
+    pthread_mutex_lock(&StatusLock);
+    StatusTable[Pair[1]] = Connection;
+    pthread_mutex_unlock(&StatusLock);
+
+    DispatchRequest(Connection, Message, Pair[1]);
+}
+
+/*
+ * NOTE(koekeishiya): The handler socket has been closed by now, so its descriptor may already
+ * have been reused for a request on a different connection; only remove our own entry.
+ */
+internal void
+EndRequest(daemon_connection *Connection)
+{
+    close(Connection->ResponseFD);
+    Connection->ResponseFD = -1;
+
+    pthread_mutex_lock(&StatusLock);
+    std::map<int, daemon_connection *>::iterator It = StatusTable.find(Connection->HandlerFD);
+    if (It != StatusTable.end() && It->second == Connection) {
+        StatusTable.erase(It);
+    }
+    char Status = Connection->Status;
+    pthread_mutex_unlock(&StatusLock);
+
+    if (Connection->Protocol == Daemon_Protocol_Framed) {
+        char Terminator[2] = { DAEMON_RESPONSE_END, Status };
+        BufferAppend(Connection->Out, Terminator, sizeof(Terminator));
+    }
+}
+
+internal inline bool
+RequestInFlight(daemon_connection *Connection)
+{
+    bool Result = ((Connection->ResponseFD != -1) ||
+                   (__atomic_load_n(&Connection->InCallback, __ATOMIC_ACQUIRE)));
+    return Result;
+}
+
+// NOTE(koekeishiya): Terminate the message in place, remembering the byte that belongs to the next request.
+internal const char *
+TerminateRequest(daemon_connection *Connection, size_t Start, size_t Length)
+{
+    char *Message = Connection->In->Data + Start;
+    Connection->RequestEnd = Message + Length;
+    Connection->RequestSaved = *Connection->RequestEnd;
+    *Connection->RequestEnd = '\0';
+    Connection->In->Borrowed = true;
+    return Message;
+}
+
+internal void
+ReleaseRequest(daemon_connection *Connection)
+{
+    if (Connection->RequestEnd) {
+        *Connection->RequestEnd = Connection->RequestSaved;
+        Connection->RequestEnd = NULL;
+        Connection->In->Borrowed = false;
+    }
+
+    BufferConsume(Connection->In, Connection->RequestSize);
+    Connection->RequestSize = 0;
+}
+
+/*
+ * NOTE(koekeishiya): The output of a request that is owned by the callback thread is always drained,
+ * so that a client that does not read can never stall the callbacks of other clients. Once the
+ * callback has returned, output is only drained while the client keeps up.
+ */
+internal inline bool
+ResponseThrottled(daemon_connection *Connection)
+{
+    bool Result = ((BufferPending(Connection->Out) >= DAEMON_MAX_PENDING_OUTPUT) &&
+                   (!__atomic_load_n(&Connection->InCallback, __ATOMIC_ACQUIRE)));
+    return Result;
+}
+
+/*
+ * NOTE(koekeishiya): Start the next complete request, if there is one, no other request is in flight,
+ * and the client has caught up with the responses that we have already buffered. A request that has
+ * finished is released even if the next one has to wait, as the read buffer may be moved after that.
+ */
+internal void
+ProcessRequests(daemon_connection *Connection)
+{
+    daemon_buffer *In = Connection->In;
+    while (!RequestInFlight(Connection) && !Connection->Broken) {
+        ReleaseRequest(Connection);
+        if (BufferPending(Connection->Out) >= DAEMON_MAX_PENDING_OUTPUT) break;
+        if (Connection->Protocol != Daemon_Protocol_Framed) break;
+
+        // NOTE(koekeishiya): Room for the terminator of a message that ends exactly at the end of the buffer.
+        BufferReserve(In, 1);
+
+        size_t Pending = BufferPending(In);
+        if (Pending < DAEMON_FRAME_HEADER_SIZE) break;
+
+        uint32_t Header;
+        memcpy(&Header, In->Data + In->Offset, DAEMON_FRAME_HEADER_SIZE);
+
+        uint32_t Length = ntohl(Header);
+        if (Length >= DAEMON_MAX_REQUEST) {
+            BreakConnection(Connection);
+            break;
+        }
+
+        if (Pending < DAEMON_FRAME_HEADER_SIZE + Length) break;
+
+        Connection->RequestSize = DAEMON_FRAME_HEADER_SIZE + Length;
+        BeginRequest(Connection, TerminateRequest(Connection, In->Offset + DAEMON_FRAME_HEADER_SIZE, Length));
+    }
+}
+
+/*
+ * NOTE(koekeishiya): Old protocol; a single message that is not terminated, so whatever
+ * the client has sent when we first read from it is the request. The connection is closed
+ * once the response has been delivered.
+ */
+internal void
+HandleLegacyRequest(daemon_connection *Connection)
+{
+    daemon_buffer *In = Connection->In;
+    BufferReserve(In, 1);
+
+    Connection->ReadClosed = true;
+    Connection->RequestSize = BufferPending(In);
+    BeginRequest(Connection, TerminateRequest(Connection, In->Offset, BufferPending(In)));
+}
+
+internal void
+ReadConnection(daemon_connection *Connection)
+{
+    daemon_buffer *In = Connection->In;
+    for (;;) {
+        if (!BufferReserve(In, DAEMON_BUFFER_SIZE)) break;
+        ssize_t Received = recv(Connection->SockFD, In->Data + In->Length, In->Capacity - In->Length, 0);
+        if (Received > 0) {
+            In->Length += Received;
+            if (Connection->Protocol == Daemon_Protocol_Unknown) {
+                Connection->Protocol = In->Data[In->Offset] == 0 ? Daemon_Protocol_Framed : Daemon_Protocol_Legacy;
+            }
+        } else if (Received == 0) {
+            Connection->ReadClosed = true;
+            break;
+        } else {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) BreakConnection(Connection);
+            break;
+        }
+    }
+
+    if (Connection->Protocol == Daemon_Protocol_Legacy) {
+        HandleLegacyRequest(Connection);
+    } else {
+        ProcessRequests(Connection);
+    }
+}
+
+internal void
+ReadResponse(daemon_connection *Connection)
+{
+    for (;;) {
+        BufferReserve(Connection->Out, DAEMON_BUFFER_SIZE);
+        daemon_buffer *Out = Connection->Out;
+
+        ssize_t Received = recv(Connection->ResponseFD, Out->Data + Out->Length, Out->Capacity - Out->Length, 0);
+        if (Received > 0) {
+            Out->Length += Received;
+            if (Connection->Broken) BufferConsume(Out, BufferPending(Out));
+            if (ResponseThrottled(Connection)) break;
+        } else if (Received == 0) {
+            EndRequest(Connection);
+            ProcessRequests(Connection);
+            break;
+        } else {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                Connection->Status = DAEMON_STATUS_FAILURE;
+                EndRequest(Connection);
+                ProcessRequests(Connection);
+            }
+            break;
+        }
+    }
+}
+
+internal void
+WriteConnection(daemon_connection *Connection)
+{
+    daemon_buffer *Out = Connection->Out;
+    while (BufferPending(Out) > 0) {
+        ssize_t Sent = send(Connection->SockFD, Out->Data + Out->Offset, BufferPending(Out), DAEMON_SEND_FLAGS);
+        if (Sent > 0) {
+            BufferConsume(Out, Sent);
+        } else {
+            if (Sent == -1 && errno == EINTR) continue;
+            if (Sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            BreakConnection(Connection);
+            BufferConsume(Out, BufferPending(Out));
+            break;
+        }
+    }
+}
+
+internal void
+AcceptConnections(int ListenFD)
+{
+    for (;;) {
+        int SockFD = accept(ListenFD, NULL, NULL);
+        if (SockFD == -1) break;
+        AddConnection(SockFD);
+    }
+}
+
+/*
+ * NOTE(koekeishiya): A single thread serves every client. Sockets are non-blocking, so a slow
+ * or idle client never holds up the others. Once DAEMON_MAX_PENDING_OUTPUT bytes are waiting to
+ * be sent to a client, we stop starting requests for it, and a handler that answers from a thread
+ * of its own blocks in WriteToSocket until the client has caught up.
  */
 internal void *
-HandleConnection(void *)
+HandleConnections(void *)
 {
+    std::vector<struct pollfd> PollFDs;
+    std::vector<daemon_connection *> Owners;
+
     while (IsRunning) {
-        struct sockaddr_in ClientAddr;
-        local_persist socklen_t SinSize = sizeof(struct sockaddr);
-
-        int SockFD = accept(DaemonSockFD, (struct sockaddr*)&ClientAddr, &SinSize);
-        if (SockFD != -1) {
-            char *Message = ReadFromSocket(SockFD);
-            if (Message) {
-                (*ConnectionCallback)(Message, SockFD);
-                free(Message);
+        PollFDs.clear();
+        Owners.clear();
+
+        int Listeners[3] = { DaemonWakeFD[0], DaemonSockFD, DaemonLocalSockFD };
+        for (int Index = 0; Index < 3; ++Index) {
+            if (Listeners[Index] == -1) continue;
+            PollFDs.push_back({ Listeners[Index], POLLIN, 0 });
+            Owners.push_back(NULL);
+        }
+
+        size_t ListenerCount = PollFDs.size();
+        for (size_t Index = 0; Index < Connections.size(); ++Index) {
+            daemon_connection *Connection = Connections[Index];
+            short Events = 0;
+            if (!Connection->Broken) {
+                if (!Connection->ReadClosed && !RequestInFlight(Connection)) Events |= POLLIN;
+                if (BufferPending(Connection->Out) > 0) Events |= POLLOUT;
+            }
+
+            /*
+             * NOTE(koekeishiya): A half-closed socket would keep reporting POLLHUP, so we only poll it when we
+             * have something to do, or while a request is in flight, so that we notice a client that goes away.
+             */
+            if (Events || (!Connection->Broken && !Connection->ReadClosed && RequestInFlight(Connection))) {
+                PollFDs.push_back({ Connection->SockFD, Events, 0 });
+                Owners.push_back(Connection);
+            }
+
+            if (Connection->ResponseFD != -1 && !ResponseThrottled(Connection)) {
+                PollFDs.push_back({ Connection->ResponseFD, POLLIN, 0 });
+                Owners.push_back(Connection);
+            }
+        }
+
+        if (poll(PollFDs.data(), PollFDs.size(), -1) <= 0) {
+            continue;
+        }
+
+        for (size_t Index = 0; Index < ListenerCount; ++Index) {
+            if (!(PollFDs[Index].revents & POLLIN)) continue;
+
+            if (PollFDs[Index].fd == DaemonWakeFD[0]) {
+                char Byte;
+                while (read(DaemonWakeFD[0], &Byte, 1) > 0);
+
+                // NOTE(koekeishiya): A callback has returned; its connection may have a request waiting.
+                for (size_t Conn = 0; Conn < Connections.size(); ++Conn) {
+                    ProcessRequests(Connections[Conn]);
+                }
+            } else {
+                AcceptConnections(PollFDs[Index].fd);
+            }
+        }
+
+        for (size_t Index = ListenerCount; Index < PollFDs.size(); ++Index) {
+            daemon_connection *Connection = Owners[Index];
+            short Events = PollFDs[Index].revents;
+            if (!Events) continue;
+
+            if (PollFDs[Index].fd == Connection->SockFD) {
+                if (Events & POLLOUT) {
+                    WriteConnection(Connection);
+                    ProcessRequests(Connection);
+                }
+
+                /*
+                 * NOTE(koekeishiya): Writing may have started a request, or the wakeup may have, and its message
+                 * is in the read buffer; the input that came with this wakeup waits until the request is done.
+                 */
+                if ((Events & POLLIN) && !RequestInFlight(Connection)) {
+                    ReadConnection(Connection);
+                }
+
+                if ((Events & POLLERR) || ((Events & POLLHUP) && !(Events & POLLIN))) {
+                    BreakConnection(Connection);
+                }
+            } else if (PollFDs[Index].fd == Connection->ResponseFD) {
+                ReadResponse(Connection);
+                WriteConnection(Connection);
+            }
+        }
+
+        /*
+         * NOTE(koekeishiya): A client that stops sending still receives the responses to the requests
+         * it has already sent. A connection is removed once those have been delivered, or the client
+         * has gone away. Because the handler of a request still owns the message, a connection with
+         * a request in flight is kept around, discarding the response, until the handler is done.
+         */
+        for (size_t Index = 0; Index < Connections.size();) {
+            daemon_connection *Connection = Connections[Index];
+            bool Done = !RequestInFlight(Connection) &&
+                        (Connection->Broken ||
+                         (Connection->ReadClosed && BufferPending(Connection->Out) == 0));
+            if (Done) {
+                DestroyConnection(Connection);
+                Connections[Index] = Connections.back();
+                Connections.pop_back();
+            } else {
+                ++Index;
             }
         }
     }
@@ -88,13 +806,103 @@ bool ConnectToDaemon(int *SockFD, int Port)
     return connect(*SockFD, (struct sockaddr*) &SrvAddr, sizeof(struct sockaddr)) != -1;
 }
 
-bool StartDaemon(int Port, daemon_callback *Callback)
+bool ConnectToDaemonSocket(int *SockFD, const char *Path)
+{
+    struct sockaddr_un SrvAddr;
+    if (strlen(Path) >= sizeof(SrvAddr.sun_path)) {
+        return false;
+    }
+
+    if ((*SockFD = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+        return false;
+    }
+
+    memset(&SrvAddr, 0, sizeof(SrvAddr));
+    SrvAddr.sun_family = AF_UNIX;
+    strcpy(SrvAddr.sun_path, Path);
+
+    if (connect(*SockFD, (struct sockaddr *) &SrvAddr, sizeof(SrvAddr)) == -1) {
+        close(*SockFD);
+        return false;
+    }
+
+    DisableSigPipe(*SockFD);
+    return true;
+}
+
+bool DaemonSocketPath(char *Buffer, size_t Size)
+{
+    const char *User = getenv("USER");
+    if (!User) {
+        return false;
+    }
+
+    return snprintf(Buffer, Size, DAEMON_SOCKET_PATH_FMT, User) < (int) Size;
+}
+
+/*
+ * NOTE(koekeishiya): The unix domain socket is preferred by chunkc; we keep listening on the
+ * loopback port for clients that do not know about it. Failing to create the unix domain
+ * socket is therefore not fatal.
+ */
+internal void
+StartLocalDaemon(const char *SocketPath)
+{
+    struct sockaddr_un SrvAddr;
+    if (!SocketPath || strlen(SocketPath) >= sizeof(SrvAddr.sun_path)) {
+        return;
+    }
+
+    if ((DaemonLocalSockFD = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+        return;
+    }
+
+    memset(&SrvAddr, 0, sizeof(SrvAddr));
+    SrvAddr.sun_family = AF_UNIX;
+    strcpy(SrvAddr.sun_path, SocketPath);
+
+    // NOTE(koekeishiya): We already own the loopback port, so the socket file is left over from a previous instance.
+    unlink(SocketPath);
+
+    if ((bind(DaemonLocalSockFD, (struct sockaddr *) &SrvAddr, sizeof(SrvAddr)) == -1) ||
+        (chmod(SocketPath, 0600) == -1) ||
+        (listen(DaemonLocalSockFD, SOMAXCONN) == -1)) {
+        printf("Could not listen on socket '%s'!\n", SocketPath);
+        close(DaemonLocalSockFD);
+        DaemonLocalSockFD = -1;
+        return;
+    }
+
+    SetNonBlocking(DaemonLocalSockFD, true);
+
+    strcpy(DaemonLocalPath, SocketPath);
+}
+
+bool StartDaemon(const char *SocketPath, int Port, daemon_callback *Callback)
 {
     ConnectionCallback = Callback;
 
     struct sockaddr_in SrvAddr;
     int _True = 1;
 
+    if (pthread_mutex_init(&RequestLock, NULL) != 0) {
+        return false;
+    }
+
+    if (pthread_mutex_init(&StatusLock, NULL) != 0) {
+        return false;
+    }
+
+    if (pthread_cond_init(&RequestCondition, NULL) != 0) {
+        return false;
+    }
+
+    if (pipe(DaemonWakeFD) == -1) {
+        return false;
+    }
+
+    SetNonBlocking(DaemonWakeFD[0], true);
+
     if ((DaemonSockFD = socket(PF_INET, SOCK_STREAM, 0)) == -1) {
         return false;
     }
@@ -112,12 +920,16 @@ bool StartDaemon(int Port, daemon_callback *Callback)
         return false;
     }
 
-    if (listen(DaemonSockFD, 10) == -1) {
+    if (listen(DaemonSockFD, SOMAXCONN) == -1) {
         return false;
     }
 
+    SetNonBlocking(DaemonSockFD, true);
+    StartLocalDaemon(SocketPath);
+
     IsRunning = true;
-    pthread_create(&Thread, NULL, &HandleConnection, NULL);
+    pthread_create(&DispatchThread, NULL, &HandleRequests, NULL);
+    pthread_create(&Thread, NULL, &HandleConnections, NULL);
     return true;
 }
 
@@ -125,7 +937,21 @@ void StopDaemon()
 {
     if (IsRunning) {
         IsRunning = false;
+        write(DaemonWakeFD[1], "", 1);
+        pthread_join(Thread, NULL);
+
+        pthread_mutex_lock(&RequestLock);
+        pthread_cond_signal(&RequestCondition);
+        pthread_mutex_unlock(&RequestLock);
+        pthread_join(DispatchThread, NULL);
+
         CloseSocket(DaemonSockFD);
-        DaemonSockFD = 0;
+        DaemonSockFD = -1;
+
+        if (DaemonLocalSockFD != -1) {
+            CloseSocket(DaemonLocalSockFD);
+            unlink(DaemonLocalPath);
+            DaemonLocalSockFD = -1;
+        }
     }
 }
@@ -1,13 +1,57 @@
 #ifndef CHUNKWM_COMMON_DAEMON_H
 #define CHUNKWM_COMMON_DAEMON_H
 
+#include <stdint.h>
+#include <stddef.h>
+
 #define DAEMON_CALLBACK(name) void name(const char *Message, int SockFD)
 typedef DAEMON_CALLBACK(daemon_callback);
 
+/*
+ * NOTE(koekeishiya): Framed protocol used by chunkc.
+ *
+ * A request is a 4-byte big-endian length followed by that many bytes of message.
+ * Because the length is limited to DAEMON_MAX_REQUEST, the first byte of a framed
+ * connection is always zero, which is how we tell it apart from the old protocol,
+ * where the client sends a single line of text and the connection is closed after
+ * the response.
+ *
+ * A connection may carry any number of requests. Responses are sent in order; each
+ * response is the text written by the handler, followed by DAEMON_RESPONSE_END and
+ * a single status byte. The handler sets the status with SetSocketStatus before it
+ * closes the socket; a response is successful unless stated otherwise. A handler that
+ * keeps its socket open for a long time can use IsSocketAbandoned to find out that the
+ * client has gone away.
+ *
+ * The message given to the callback is not a copy; it remains valid until the callback
+ * has returned and the socket it was given has been closed, whichever happens last.
+ */
+#define DAEMON_FRAME_HEADER_SIZE    4
+#define DAEMON_MAX_REQUEST          (1 << 24)
+#define DAEMON_RESPONSE_END         '\0'
+#define DAEMON_STATUS_SUCCESS       0
+#define DAEMON_STATUS_FAILURE       1
+
+#define DAEMON_SOCKET_PATH_FMT      "/tmp/chunkwm_%s.socket"
+
+/*
+ * NOTE(koekeishiya): A task runs on the thread that runs the callback, in order with the
+ * requests that were received before it was submitted. It is meant for work that must
+ * not race with commands from clients, but that originates within the process itself.
+ */
+#define DAEMON_TASK(name) void name(void *Context)
+typedef DAEMON_TASK(daemon_task);
+
 bool ConnectToDaemon(int *SockFD, int Port);
-bool StartDaemon(int Port, daemon_callback Callback);
+bool ConnectToDaemonSocket(int *SockFD, const char *Path);
+bool StartDaemon(const char *SocketPath, int Port, daemon_callback Callback);
 void StopDaemon();
+bool SubmitDaemonTask(daemon_task *Task, void *Context);
+bool DaemonSocketPath(char *Buffer, size_t Size);
 
+bool WriteRequestToSocket(const char *Message, size_t Length, int SockFD);
+void SetSocketStatus(int SockFD, int Status);
+bool IsSocketAbandoned(int SockFD);
 void WriteToSocket(const char *Message, int SockFD);
 char *ReadFromSocket(int SockFD);
 void CloseSocket(int SockFD);
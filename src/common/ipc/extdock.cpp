@@ -0,0 +1,289 @@
+#include "extdock.h"
+#include "daemon.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define internal static
+
+#ifdef MSG_NOSIGNAL
+#define EXTENDED_DOCK_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define EXTENDED_DOCK_SEND_FLAGS 0
+#endif
+
+#define EXTENDED_DOCK_BUFFER_SIZE   4096
+#define EXTENDED_DOCK_COMMAND_SIZE  256
+
+enum extended_dock_protocol
+{
+    ExtendedDock_Protocol_Unknown,
+    ExtendedDock_Protocol_Single,
+    ExtendedDock_Protocol_Batch,
+};
+
+struct extended_dock
+{
+    int Port;
+    int SockFD;
+    time_t RetryAt;
+    extended_dock_protocol Protocol;
+
+    char *Buffer;
+    size_t Length;
+    size_t Capacity;
+
+    pthread_mutex_t Lock;
+};
+
+internal extended_dock ExtendedDock = { 0, -1 };
+
+internal void
+ExtendedDockDisconnect()
+{
+    if (ExtendedDock.SockFD != -1) {
+        close(ExtendedDock.SockFD);
+        ExtendedDock.SockFD = -1;
+    }
+}
+
+// NOTE(koekeishiya): The Dock could not be reached; forget what it supports, it may have been updated.
+internal void
+ExtendedDockUnavailable()
+{
+    ExtendedDockDisconnect();
+    ExtendedDock.Protocol = ExtendedDock_Protocol_Unknown;
+    ExtendedDock.RetryAt = time(NULL) + EXTENDED_DOCK_RETRY_SEC;
+}
+
+/*
+ * NOTE(koekeishiya): Once the hello has been answered, the Dock never writes to us, so a
+ * readable socket means that it has closed the connection, most likely because the Dock
+ * was restarted.
+ */
+internal bool
+ExtendedDockIsConnected()
+{
+    if (ExtendedDock.SockFD == -1) {
+        return false;
+    }
+
+    struct pollfd PollFD = { ExtendedDock.SockFD, POLLIN, 0 };
+    if (poll(&PollFD, 1, 0) == 0) {
+        return true;
+    }
+
+    char Discard[64];
+    if ((PollFD.revents & POLLIN) && recv(ExtendedDock.SockFD, Discard, sizeof(Discard), MSG_DONTWAIT) > 0) {
+        return true;
+    }
+
+    ExtendedDockDisconnect();
+    return false;
+}
+
+internal bool
+ExtendedDockOpen(int *SockFD)
+{
+    if (!ConnectToDaemon(SockFD, ExtendedDock.Port)) {
+        if (*SockFD != -1) close(*SockFD);
+        *SockFD = -1;
+        return false;
+    }
+
+#ifdef SO_NOSIGPIPE
+    int _True = 1;
+    setsockopt(*SockFD, SOL_SOCKET, SO_NOSIGPIPE, &_True, sizeof(int));
+#endif
+
+    return true;
+}
+
+internal bool
+ExtendedDockSend(int SockFD, const char *Data, size_t Length)
+{
+    size_t Sent = 0;
+    while (Sent < Length) {
+        ssize_t Result = send(SockFD, Data + Sent, Length - Sent, EXTENDED_DOCK_SEND_FLAGS);
+        if (Result == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        Sent += Result;
+    }
+
+    return true;
+}
+
+/*
+ * NOTE(koekeishiya): A scripting addition that only knows the old protocol treats the hello
+ * as an unknown command and closes the connection, which we see as the end of the stream.
+ */
+internal extended_dock_protocol
+ExtendedDockNegotiate(int SockFD)
+{
+    size_t HelloLength = strlen(EXTENDED_DOCK_HELLO);
+    if (!ExtendedDockSend(SockFD, EXTENDED_DOCK_HELLO, HelloLength)) {
+        return ExtendedDock_Protocol_Single;
+    }
+
+    char Reply[sizeof(EXTENDED_DOCK_HELLO)];
+    size_t Received = 0;
+    while (Received < HelloLength) {
+        struct pollfd PollFD = { SockFD, POLLIN, 0 };
+        int Ready = poll(&PollFD, 1, EXTENDED_DOCK_HELLO_MSEC);
+        if (Ready == -1 && errno == EINTR) continue;
+        if (Ready <= 0) break;
+
+        ssize_t Result = recv(SockFD, Reply + Received, HelloLength - Received, 0);
+        if (Result == -1 && errno == EINTR) continue;
+        if (Result <= 0) break;
+
+        Received += Result;
+    }
+
+    bool Batch = (Received == HelloLength) && (memcmp(Reply, EXTENDED_DOCK_HELLO, HelloLength) == 0);
+    return Batch ? ExtendedDock_Protocol_Batch : ExtendedDock_Protocol_Single;
+}
+
+internal bool
+ExtendedDockConnect()
+{
+    if (ExtendedDock.Protocol == ExtendedDock_Protocol_Single) {
+        return true;
+    }
+
+    if (ExtendedDockIsConnected()) {
+        return true;
+    }
+
+    if (time(NULL) < ExtendedDock.RetryAt) {
+        return false;
+    }
+
+    if (!ExtendedDockOpen(&ExtendedDock.SockFD)) {
+        ExtendedDockUnavailable();
+        return false;
+    }
+
+    ExtendedDock.Protocol = ExtendedDockNegotiate(ExtendedDock.SockFD);
+    if (ExtendedDock.Protocol == ExtendedDock_Protocol_Single) {
+        ExtendedDockDisconnect();
+    }
+
+    return true;
+}
+
+// NOTE(koekeishiya): The old protocol; one connection per command, without the newline.
+internal bool
+ExtendedDockSendSingle()
+{
+    char *Command = ExtendedDock.Buffer;
+    char *End = ExtendedDock.Buffer + ExtendedDock.Length;
+
+    while (Command < End) {
+        char *Newline = (char *) memchr(Command, '\n', End - Command);
+
+        int SockFD;
+        if (!ExtendedDockOpen(&SockFD)) {
+            ExtendedDockUnavailable();
+            return false;
+        }
+
+        ExtendedDockSend(SockFD, Command, Newline - Command);
+        close(SockFD);
+
+        Command = Newline + 1;
+    }
+
+    return true;
+}
+
+bool BeginExtendedDock(int Port)
+{
+    ExtendedDock.Port = Port;
+    ExtendedDock.SockFD = -1;
+    ExtendedDock.RetryAt = 0;
+    ExtendedDock.Protocol = ExtendedDock_Protocol_Unknown;
+    ExtendedDock.Length = 0;
+    ExtendedDock.Capacity = EXTENDED_DOCK_BUFFER_SIZE;
+    ExtendedDock.Buffer = (char *) malloc(ExtendedDock.Capacity);
+    return pthread_mutex_init(&ExtendedDock.Lock, NULL) == 0;
+}
+
+void EndExtendedDock()
+{
+    ExtendedDockFlush();
+
+    pthread_mutex_lock(&ExtendedDock.Lock);
+    ExtendedDockDisconnect();
+    free(ExtendedDock.Buffer);
+    ExtendedDock.Buffer = NULL;
+    ExtendedDock.Length = ExtendedDock.Capacity = 0;
+    pthread_mutex_unlock(&ExtendedDock.Lock);
+}
+
+void ExtendedDockCommand(const char *Format, ...)
+{
+    char Command[EXTENDED_DOCK_COMMAND_SIZE];
+
+    va_list Args;
+    va_start(Args, Format);
+    int Length = vsnprintf(Command, sizeof(Command) - 1, Format, Args);
+    va_end(Args);
+
+    if (Length < 0 || Length >= (int) sizeof(Command) - 1) {
+        return;
+    }
+    Command[Length++] = '\n';
+
+    pthread_mutex_lock(&ExtendedDock.Lock);
+    if (ExtendedDock.Buffer) {
+        if (ExtendedDock.Length + Length > ExtendedDock.Capacity) {
+            while (ExtendedDock.Length + Length > ExtendedDock.Capacity) {
+                ExtendedDock.Capacity *= 2;
+            }
+            ExtendedDock.Buffer = (char *) realloc(ExtendedDock.Buffer, ExtendedDock.Capacity);
+        }
+
+        memcpy(ExtendedDock.Buffer + ExtendedDock.Length, Command, Length);
+        ExtendedDock.Length += Length;
+    }
+    pthread_mutex_unlock(&ExtendedDock.Lock);
+}
+
+/*
+ * NOTE(koekeishiya): Commands that could not be sent are dropped rather than kept for the
+ * next flush; they describe the state at the time of the event, which is outdated by then.
+ */
+bool ExtendedDockFlush()
+{
+    bool Result = true;
+
+    pthread_mutex_lock(&ExtendedDock.Lock);
+    if (ExtendedDock.Length > 0) {
+        if (!ExtendedDockConnect()) {
+            Result = false;
+        } else if (ExtendedDock.Protocol == ExtendedDock_Protocol_Batch) {
+            if (!(Result = ExtendedDockSend(ExtendedDock.SockFD, ExtendedDock.Buffer, ExtendedDock.Length))) {
+                ExtendedDockDisconnect();
+                ExtendedDock.Protocol = ExtendedDock_Protocol_Unknown;
+            }
+        } else {
+            Result = ExtendedDockSendSingle();
+        }
+        ExtendedDock.Length = 0;
+    }
+    pthread_mutex_unlock(&ExtendedDock.Lock);
+
+    return Result;
+}
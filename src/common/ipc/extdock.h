@@ -0,0 +1,38 @@
+#ifndef CHUNKWM_COMMON_EXTDOCK_H
+#define CHUNKWM_COMMON_EXTDOCK_H
+
+#define EXTENDED_DOCK_PORT          5050
+#define EXTENDED_DOCK_RETRY_SEC     1
+#define EXTENDED_DOCK_HELLO_MSEC    50
+#define EXTENDED_DOCK_HELLO         "protocol 2\n"
+
+/*
+ * NOTE(koekeishiya): Client for the scripting addition that is loaded into the Dock.
+ * Commands are plain text:
+ *
+ *     window_alpha_fade <window id> <alpha> <duration>
+ *     window_move <window id> <x> <y>
+ *
+ * Commands are not sent immediately; they are collected until ExtendedDockFlush is
+ * called, typically once per event. The connection is only made when there is something
+ * to send. If it cannot be made, we do not try again for EXTENDED_DOCK_RETRY_SEC, and
+ * commands issued in the meantime are dropped, as the extended dock is most likely not
+ * installed.
+ *
+ * The scripting addition that is shipped today reads a single command and closes the
+ * connection. A newer one may accept many newline-terminated commands on a connection
+ * that is kept open. Every new connection starts with EXTENDED_DOCK_HELLO; a scripting
+ * addition that supports batching echoes it back, and the whole batch is then written
+ * in a single send. Without a reply within EXTENDED_DOCK_HELLO_MSEC, every command is
+ * sent on a connection of its own, as before. The outcome is remembered until the Dock
+ * goes away, so the negotiation only costs a round-trip once.
+ *
+ * All functions are safe to call from any thread.
+ */
+bool BeginExtendedDock(int Port);
+void EndExtendedDock();
+
+void ExtendedDockCommand(const char *Format, ...);
+bool ExtendedDockFlush();
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef CHUNKWM_COMMON_STATEPAGE_H
+#define CHUNKWM_COMMON_STATEPAGE_H
+
+#include <stdint.h>
+
+/*
+ * NOTE(koekeishiya): chunkwm publishes a small block of state in a POSIX shared-memory
+ * object named after the current user, so that status bars and similar tools can read
+ * it without a round-trip through the daemon. This header is shared between chunkwm
+ * and the reader library in 'src/chunkstate', and must remain valid C.
+ *
+ * The block is protected by a sequence lock. The writer makes Sequence odd before it
+ * changes anything, and even again when it is done. A reader copies the block and
+ * retries if Sequence was odd, or changed while it was copying.
+ *
+ * Magic, Version and Size are written once, before the first update, and do not change
+ * for the lifetime of the object. STATE_PAGE_VERSION is increased whenever the layout
+ * changes; fields are never reordered within a version.
+ */
+#define STATE_PAGE_NAME_FMT         "/chunkwm.%s"
+#define STATE_PAGE_MAGIC            0x6368776d
+#define STATE_PAGE_VERSION          1
+
+#define STATE_PAGE_MAX_DESKTOPS     64
+#define STATE_PAGE_OWNER_SIZE       128
+#define STATE_PAGE_NAME_SIZE        256
+#define STATE_PAGE_MODE_SIZE        16
+
+/*
+ * NOTE(koekeishiya): Desktops are indexed by their mission-control index minus one.
+ * The window count and mode are provided by the tiling plugin, and are updated when
+ * the desktop is visible. Monitor is the arrangement index plus one.
+ */
+struct state_page_desktop
+{
+    uint32_t Monitor;
+    uint32_t WindowCount;
+    char Mode[STATE_PAGE_MODE_SIZE];
+};
+
+struct state_page
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Size;
+    uint32_t Sequence;
+
+    uint32_t ActiveDesktop;
+    uint32_t ActiveMonitor;
+
+    uint32_t FocusedWindow;
+    int32_t FocusedPID;
+    char FocusedOwner[STATE_PAGE_OWNER_SIZE];
+    char FocusedName[STATE_PAGE_NAME_SIZE];
+
+    uint32_t DesktopCount;
+    struct state_page_desktop Desktops[STATE_PAGE_MAX_DESKTOPS];
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "json.h"
+#include "../ipc/daemon.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <inttypes.h>
+
+#define internal static
+
+internal void
+JsonFlush(json_writer *Writer)
+{
+    if (Writer->Length > 0) {
+        Writer->Data[Writer->Length] = '\0';
+        WriteToSocket(Writer->Data, Writer->SockFD);
+        Writer->Length = 0;
+    }
+}
+
+// NOTE(koekeishiya): Always leaves room for the null-terminator.
+internal void
+JsonReserve(json_writer *Writer, size_t Length)
+{
+    if (Writer->Length + Length + 1 > Writer->Capacity) {
+        while (Writer->Length + Length + 1 > Writer->Capacity) {
+            Writer->Capacity *= 2;
+        }
+        Writer->Data = (char *) realloc(Writer->Data, Writer->Capacity);
+    }
+}
+
+internal void
+JsonAppend(json_writer *Writer, const char *Text, size_t Length)
+{
+    JsonReserve(Writer, Length);
+    memcpy(Writer->Data + Writer->Length, Text, Length);
+    Writer->Length += Length;
+    Writer->Data[Writer->Length] = '\0';
+}
+
+internal void
+JsonAppendString(json_writer *Writer, const char *Text)
+{
+    static const char Hex[] = "0123456789abcdef";
+
+    JsonAppend(Writer, "\"", 1);
+    for (const char *At = Text; *At; ++At) {
+        const char *Run = At;
+        while (*At && *At != '"' && *At != '\\' && (unsigned char) *At >= 0x20) {
+            ++At;
+        }
+
+        JsonAppend(Writer, Run, At - Run);
+        if (!*At) break;
+
+        switch (*At) {
+        case '"':  JsonAppend(Writer, "\\\"", 2); break;
+        case '\\': JsonAppend(Writer, "\\\\", 2); break;
+        case '\n': JsonAppend(Writer, "\\n", 2);  break;
+        case '\r': JsonAppend(Writer, "\\r", 2);  break;
+        case '\t': JsonAppend(Writer, "\\t", 2);  break;
+        default: {
+            char Escape[6] = { '\\', 'u', '0', '0', Hex[(*At >> 4) & 0xf], Hex[*At & 0xf] };
+            JsonAppend(Writer, Escape, sizeof(Escape));
+        } break;
+        }
+    }
+    JsonAppend(Writer, "\"", 1);
+}
+
+internal void
+JsonBeginValue(json_writer *Writer, const char *Key)
+{
+    if (Writer->NeedComma) {
+        JsonAppend(Writer, ",", 1);
+    }
+
+    if (Key) {
+        JsonAppendString(Writer, Key);
+        JsonAppend(Writer, ":", 1);
+    }
+
+    Writer->NeedComma = true;
+}
+
+// NOTE(koekeishiya): Only flush between values, so that a value is never split across writes.
+internal void
+JsonEndValue(json_writer *Writer)
+{
+    if ((Writer->SockFD != -1) &&
+        (Writer->Length >= JSON_WRITER_FLUSH_SIZE)) {
+        JsonFlush(Writer);
+    }
+}
+
+void BeginJsonWriter(json_writer *Writer, int SockFD)
+{
+    Writer->Capacity = JSON_WRITER_INITIAL_SIZE;
+    Writer->Data = (char *) malloc(Writer->Capacity);
+    Writer->Data[0] = '\0';
+    Writer->Length = 0;
+    Writer->SockFD = SockFD;
+    Writer->NeedComma = false;
+}
+
+// NOTE(koekeishiya): If the writer has no socket, the caller must be done with Data before this call.
+void EndJsonWriter(json_writer *Writer)
+{
+    if (Writer->SockFD != -1) {
+        JsonFlush(Writer);
+    }
+
+    free(Writer->Data);
+    Writer->Data = NULL;
+    Writer->Length = Writer->Capacity = 0;
+}
+
+void JsonBeginObject(json_writer *Writer, const char *Key)
+{
+    JsonBeginValue(Writer, Key);
+    JsonAppend(Writer, "{", 1);
+    Writer->NeedComma = false;
+}
+
+void JsonEndObject(json_writer *Writer)
+{
+    JsonAppend(Writer, "}", 1);
+    Writer->NeedComma = true;
+    JsonEndValue(Writer);
+}
+
+void JsonBeginArray(json_writer *Writer, const char *Key)
+{
+    JsonBeginValue(Writer, Key);
+    JsonAppend(Writer, "[", 1);
+    Writer->NeedComma = false;
+}
+
+void JsonEndArray(json_writer *Writer)
+{
+    JsonAppend(Writer, "]", 1);
+    Writer->NeedComma = true;
+    JsonEndValue(Writer);
+}
+
+void JsonString(json_writer *Writer, const char *Key, const char *Value)
+{
+    JsonBeginValue(Writer, Key);
+    if (Value) {
+        JsonAppendString(Writer, Value);
+    } else {
+        JsonAppend(Writer, "null", 4);
+    }
+    JsonEndValue(Writer);
+}
+
+void JsonInteger(json_writer *Writer, const char *Key, int64_t Value)
+{
+    char Buffer[32];
+    int Length = snprintf(Buffer, sizeof(Buffer), "%" PRId64, Value);
+
+    JsonBeginValue(Writer, Key);
+    JsonAppend(Writer, Buffer, Length);
+    JsonEndValue(Writer);
+}
+
+// NOTE(koekeishiya): JSON has no representation for nan and infinity.
+void JsonNumber(json_writer *Writer, const char *Key, double Value)
+{
+    char Buffer[32];
+    int Length = isfinite(Value) ? snprintf(Buffer, sizeof(Buffer), "%.9g", Value)
+                                 : snprintf(Buffer, sizeof(Buffer), "null");
+
+    JsonBeginValue(Writer, Key);
+    JsonAppend(Writer, Buffer, Length);
+    JsonEndValue(Writer);
+}
+
+void JsonBool(json_writer *Writer, const char *Key, bool Value)
+{
+    JsonBeginValue(Writer, Key);
+    if (Value) {
+        JsonAppend(Writer, "true", 4);
+    } else {
+        JsonAppend(Writer, "false", 5);
+    }
+    JsonEndValue(Writer);
+}
+
+void JsonNull(json_writer *Writer, const char *Key)
+{
+    JsonBeginValue(Writer, Key);
+    JsonAppend(Writer, "null", 4);
+    JsonEndValue(Writer);
+}
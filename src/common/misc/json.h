@@ -0,0 +1,48 @@
+#ifndef CHUNKWM_COMMON_JSON_H
+#define CHUNKWM_COMMON_JSON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_WRITER_INITIAL_SIZE    4096
+#define JSON_WRITER_FLUSH_SIZE      (64 * 1024)
+
+/*
+ * NOTE(koekeishiya): Writes a JSON document into a buffer that grows as needed. If the
+ * writer is given a socket, the buffer is flushed to it whenever it grows beyond
+ * JSON_WRITER_FLUSH_SIZE, so that large documents are streamed to the client instead
+ * of being built in memory first. Keys are only given for members of an object, and
+ * must be NULL for elements of an array.
+ *
+ *     json_writer Writer;
+ *     BeginJsonWriter(&Writer, SockFD);
+ *     JsonBeginObject(&Writer, NULL);
+ *     JsonInteger(&Writer, "id", 1);
+ *     JsonEndObject(&Writer);
+ *     EndJsonWriter(&Writer);
+ */
+struct json_writer
+{
+    char *Data;
+    size_t Length;
+    size_t Capacity;
+
+    int SockFD;
+    bool NeedComma;
+};
+
+void BeginJsonWriter(json_writer *Writer, int SockFD);
+void EndJsonWriter(json_writer *Writer);
+
+void JsonBeginObject(json_writer *Writer, const char *Key);
+void JsonEndObject(json_writer *Writer);
+void JsonBeginArray(json_writer *Writer, const char *Key);
+void JsonEndArray(json_writer *Writer);
+
+void JsonString(json_writer *Writer, const char *Key, const char *Value);
+void JsonInteger(json_writer *Writer, const char *Key, int64_t Value);
+void JsonNumber(json_writer *Writer, const char *Key, double Value);
+void JsonBool(json_writer *Writer, const char *Key, bool Value);
+void JsonNull(json_writer *Writer, const char *Key);
+
+#endif
@@ -3,15 +3,22 @@
 #include "wqueue.h"
 #include "state.h"
 #include "clog.h"
+#include "cvar.h"
+#include "subscription.h"
+#include "statepage.h"
+#include "constants.h"
 
 #include "dispatch/carbon.h"
 #include "dispatch/workspace.h"
 #include "dispatch/event.h"
 
+#include "../common/accessibility/application.h"
 #include "../common/accessibility/window.h"
+#include "../common/accessibility/display.h"
 #include "../common/misc/assert.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <pthread.h>
 
 #define internal static
@@ -21,45 +28,120 @@
     for (plugin_list_iter It = List->begin();              \
          It != List->end();                                \
          ++It) {                                           \
-        plugin *Plugin = It->first;                        \
-        Plugin->Run(#plugin_export,                        \
-                    (void *) Context);                     \
+        loaded_plugin *LoadedPlugin = It->second;          \
+        PluginQueueRun(&LoadedPlugin->Queue,               \
+                       #plugin_export,                     \
+                       (void *) Context);                  \
     }                                                      \
     EndPluginList(plugin_export)
 
 #define ProcessPluginListThreaded(plugin_export, Context)  \
-    plugin_list *List = BeginPluginList(plugin_export);    \
-    plugin_work WorkArray[List->size()];                   \
-    int WorkCount = 0;                                     \
-    for (plugin_list_iter It = List->begin();              \
-         It != List->end();                                \
-         ++It) {                                           \
-        plugin_work *Work = WorkArray + WorkCount++;       \
-        Work->Plugin = It->first;                          \
-        Work->Export = (char *) #plugin_export;            \
-        Work->Data = (void *) Context;                     \
-        AddWorkQueueEntry(&Queue,                          \
-                          &PluginWorkCallback,             \
-                          Work);                           \
-    }                                                      \
-    EndPluginList(plugin_export);                          \
-    CompleteWorkQueue(&Queue)                              \
+    QueuePluginList(plugin_export, (void *) Context, NULL, NULL, false)
 
-struct plugin_work
-{
-    plugin *Plugin;
-    char *Export;
-    void *Data;
-};
+#define ProcessPluginListThreadedRelease(plugin_export, Context, Release, ReleaseContext) \
+    QueuePluginList(plugin_export, (void *) Context, Release, (void *) ReleaseContext, true)
+
+#define ProcessPluginListThreadedSnapshot(plugin_export, Snapshot) \
+    QueuePluginList(plugin_export, (void *) Snapshot, ReleaseMemory, NULL, false)
 
 internal work_queue Queue;
 
+/*
+ * NOTE(koekeishiya): Queue an event for every plugin that subscribes to it, without waiting
+ * for the plugins to process it. If given, 'Release' is called once every plugin is done with
+ * the event, and is where we free memory that the plugins may still be reading.
+ *
+ * A plugin that does not subscribe to the event may still hold on to the same window through
+ * an earlier event in its queue. When 'Shared' is set, every other plugin is given an entry
+ * that only holds a reference, so that the release happens after every plugin has caught up
+ * to this point. Memory that only the subscribers can see does not need this.
+ */
+internal void
+QueuePluginList(chunkwm_plugin_export Export, void *Data,
+                plugin_payload_release *Release, void *Context, bool Shared)
+{
+    plugin_payload *Payload = BeginPluginPayload(Data, Release, Context);
+    TrackEventCompletion(Payload);
+
+    plugin_list *List = BeginPluginList(Export);
+    if (Shared) {
+        loaded_plugin_list *LoadedList = BeginLoadedPluginList();
+        for (loaded_plugin_list_iter It = LoadedList->begin();
+             It != LoadedList->end();
+             ++It) {
+            loaded_plugin *LoadedPlugin = It->second;
+            bool Subscribed = List->find(LoadedPlugin->Plugin) != List->end();
+            PluginQueueAdd(&Queue, &LoadedPlugin->Queue,
+                           Subscribed ? chunkwm_plugin_export_str[Export] : NULL,
+                           Payload);
+        }
+        EndLoadedPluginList();
+    } else {
+        for (plugin_list_iter It = List->begin();
+             It != List->end();
+             ++It) {
+            loaded_plugin *LoadedPlugin = It->second;
+            PluginQueueAdd(&Queue, &LoadedPlugin->Queue,
+                           chunkwm_plugin_export_str[Export],
+                           Payload);
+        }
+    }
+    EndPluginList(Export);
+
+    ReleasePluginPayload(Payload);
+}
+
+internal
+PLUGIN_PAYLOAD_RELEASE(ReleaseMemory)
+{
+    free(Data);
+}
+
+internal
+PLUGIN_PAYLOAD_RELEASE(ReleaseWindow)
+{
+    AXLibDestroyWindow((macos_window *) Data);
+}
+
+internal
+PLUGIN_PAYLOAD_RELEASE(ReleaseApplication)
+{
+    AXLibDestroyApplication((macos_application *) Data);
+}
+
+// NOTE(koekeishiya): Free the title that was replaced by a 'ChunkWM_WindowTitleChanged' event.
 internal
-WORK_QUEUE_CALLBACK(PluginWorkCallback)
+PLUGIN_PAYLOAD_RELEASE(ReleaseWindowTitle)
+{
+    if (Context) {
+        free(Context);
+    }
+}
+
+// NOTE(koekeishiya): Release the roles that were replaced by a 'ChunkWM_WindowDeminimized' event.
+internal
+PLUGIN_PAYLOAD_RELEASE(ReleaseWindowRoles)
+{
+    CFTypeRef *Roles = (CFTypeRef *) Context;
+    if (Roles) {
+        if (Roles[0]) CFRelease(Roles[0]);
+        if (Roles[1]) CFRelease(Roles[1]);
+        free(Roles);
+    }
+}
+
+/*
+ * NOTE(koekeishiya): The window is read by plugins on their own threads while we keep
+ * updating it, so moved and resized events carry a private copy with the geometry that
+ * belongs to the event. The copy borrows every reference from the window, which is only
+ * destroyed after each plugin has processed the events queued before it.
+ */
+internal macos_window *
+WindowSnapshot(macos_window *Window)
 {
-    plugin_work *Work = (plugin_work *) Data;
-    Work->Plugin->Run(Work->Export,
-                      Work->Data);
+    macos_window *Snapshot = (macos_window *) malloc(sizeof(macos_window));
+    memcpy(Snapshot, Window, sizeof(macos_window));
+    return Snapshot;
 }
 
 // NOTE(koekeishiya): We pass a pointer to this function to every plugin as they are loaded.
@@ -89,6 +171,19 @@ void ChunkwmBroadcast(const char *PluginName, const char *EventName,
     ConstructEvent(ChunkWM_PluginBroadcast, Context);
 }
 
+internal
+PLUGIN_PAYLOAD_RELEASE(ReleaseBroadcast)
+{
+    void **Broadcast = (void **) Context;
+
+    if (Broadcast[1]) {
+        free(Broadcast[1]);
+    }
+
+    free(Broadcast[0]);
+    free(Broadcast);
+}
+
 CHUNKWM_CALLBACK(Callback_ChunkWM_PluginBroadcast)
 {
     void **Context = (void **) Event->Context;
@@ -96,11 +191,10 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_PluginBroadcast)
     char *PluginEvent = (char *) Context[0];
     void *EventData = (void *) Context[1];
 
+    plugin_payload *Payload = BeginPluginPayload(EventData, ReleaseBroadcast, Context);
+    TrackEventCompletion(Payload);
     loaded_plugin_list *List = BeginLoadedPluginList();
 
-    plugin_work WorkArray[List->size()];
-    int WorkCount = 0;
-
     for (loaded_plugin_list_iter It = List->begin();
          It != List->end();
          ++It) {
@@ -108,57 +202,124 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_PluginBroadcast)
         if (strncmp(LoadedPlugin->Info->PluginName,
                     PluginEvent,
                     strlen(LoadedPlugin->Info->PluginName)) != 0) {
-            plugin_work *Work = WorkArray + WorkCount++;
-            Work->Plugin = LoadedPlugin->Plugin;
-            Work->Export = PluginEvent;
-            Work->Data = EventData;
-            AddWorkQueueEntry(&Queue, &PluginWorkCallback, Work);
+            PluginQueueAdd(&Queue, &LoadedPlugin->Queue, PluginEvent, Payload);
         }
     }
 
     EndLoadedPluginList();
-    CompleteWorkQueue(&Queue);
+    ReleasePluginPayload(Payload);
+}
 
-    if (EventData) {
-        free(EventData);
+internal
+PLUGIN_PAYLOAD_RELEASE(ReleaseCVarName)
+{
+    free(Data);
+}
+
+/*
+ * NOTE(koekeishiya): The notification is queued behind the events that the plugin has yet
+ * to process, so a plugin can update configuration that it has cached without locking.
+ * Only the name is passed along; the plugin reads the current value through the cvar API.
+ */
+CHUNKWM_CALLBACK(Callback_ChunkWM_CVarChanged)
+{
+    char *Name = (char *) Event->Context;
+
+    plugin_payload *Payload = BeginPluginPayload(Name, ReleaseCVarName, NULL);
+    TrackEventCompletion(Payload);
+    loaded_plugin_list *List = BeginLoadedPluginList();
+
+    for (loaded_plugin_list_iter It = List->begin();
+         It != List->end();
+         ++It) {
+        loaded_plugin *LoadedPlugin = It->second;
+        if (IsCVarWatchedBy(LoadedPlugin->Info->PluginName, Name)) {
+            PluginQueueAdd(&Queue, &LoadedPlugin->Queue, "chunkwm_cvar_changed", Payload);
+        }
     }
 
-    free(PluginEvent);
-    free(Context);
+    EndLoadedPluginList();
+    ReleasePluginPayload(Payload);
 }
 
-bool BeginCallbackThreads(int Count)
+// NOTE(koekeishiya): A thread count of 0 spawns one worker per online core.
+bool BeginCallbackThreads()
 {
-    if ((Queue.Semaphore = sem_open("work_queue_semaphore", O_CREAT, 0644, 0)) == SEM_FAILED) {
-        return false;
-    }
+    CreateCVar(CVAR_THREAD_COUNT, 0);
+    CreateCVar(CVAR_PLUGIN_BUDGET, PLUGIN_BUDGET_DEFAULT);
+    return BeginWorkQueue(&Queue, CVarIntegerValue(CVAR_THREAD_COUNT));
+}
+
+void ResizeCallbackThreads(int Count)
+{
+    UpdateCVar(CVAR_THREAD_COUNT, Count);
+    ResizeWorkQueue(&Queue, Count > 0 ? Count : 0);
+}
 
-    pthread_t Thread[Count];
-    for (int Index = 0; Index < Count; ++Index) {
-        pthread_create(&Thread[Index], NULL, &WorkQueueThreadProc, &Queue);
+internal
+PLUGIN_PAYLOAD_RELEASE(ReleaseDelegate)
+{
+    chunkwm_delegate *Delegate = (chunkwm_delegate *) Context;
+
+    if (Failed) {
+        SetSocketStatus(Delegate->SockFD, DAEMON_STATUS_FAILURE);
     }
 
-    return true;
+    CloseSocket(Delegate->SockFD);
+    free(Delegate->Target);
+    free(Delegate->Command);
+    free(Delegate);
+    free(Data);
 }
 
+/*
+ * NOTE(koekeishiya): Commands are queued behind the events that the plugin has yet to
+ * process, so that a plugin is never run on two threads at once. The socket is closed
+ * when the plugin is done with the command, and the response fails if the plugin is not
+ * loaded or did not handle the command.
+ */
 CHUNKWM_CALLBACK(Callback_ChunkWM_PluginCommand)
 {
     chunkwm_delegate *Delegate = (chunkwm_delegate *) Event->Context;
     ASSERT(Delegate);
 
-    plugin *Plugin = GetPluginFromFilename(Delegate->Target);
-    if (Plugin) {
-        chunkwm_payload Payload = { Delegate->SockFD, Delegate->Command, Delegate->Message };
-        Plugin->Run("chunkwm_daemon_command", (void *) &Payload);
+    chunkwm_payload *Command = (chunkwm_payload *) malloc(sizeof(chunkwm_payload));
+    Command->SockFD = Delegate->SockFD;
+    Command->Command = Delegate->Command;
+    Command->Message = Delegate->Message;
+
+    plugin_payload *Payload = BeginPluginPayload(Command, ReleaseDelegate, Delegate);
+    TrackEventCompletion(Payload);
+
+    BeginLoadedPluginList();
+    loaded_plugin *LoadedPlugin = GetLoadedPluginFromFilename(Delegate->Target);
+    if (LoadedPlugin) {
+        PluginQueueAdd(&Queue, &LoadedPlugin->Queue, "chunkwm_daemon_command", Payload);
     } else {
         c_log(C_LOG_LEVEL_WARN, "chunkwm: plugin '%s' is not loaded.\n", Delegate->Target);
+        Payload->Failed = true;
     }
+    EndLoadedPluginList();
 
-    CloseSocket(Delegate->SockFD);
-    free(Delegate->Target);
-    free(Delegate->Command);
-    free((char *)(Delegate->Message));
-    free(Delegate);
+    ReleasePluginPayload(Payload);
+}
+
+// NOTE(koekeishiya): Looking up the active desktop is not free, so only do it if anyone is interested.
+internal void
+PublishDesktopChanged()
+{
+    macos_space *Space;
+    if (!AXLibActiveSpace(&Space)) {
+        return;
+    }
+
+    unsigned Arrangement, DesktopId;
+    if (AXLibCGSSpaceIDToDesktopID(Space->Id, &Arrangement, &DesktopId)) {
+        StatePageSetActiveDesktop(DesktopId, Arrangement + 1);
+        PublishEvent(Subscription_Desktop, "desktop_changed", true, "%u %u", DesktopId, Arrangement);
+    }
+
+    AXLibDestroySpace(Space);
 }
 
 // NOTE(koekeishiya): Application-related callbacks.
@@ -193,12 +354,13 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_ApplicationTerminated)
     macos_application *Application = GetApplicationFromPID(Info->PID);
     if (Application) {
         c_log(C_LOG_LEVEL_DEBUG, "%d:%s terminated\n", Info->PID, Info->ProcessName);
+        RemoveApplication(Application);
 #if 0
         ProcessPluginList(chunkwm_export_application_terminated, Application);
+        AXLibDestroyApplication(Application);
 #else
-        ProcessPluginListThreaded(chunkwm_export_application_terminated, Application);
+        ProcessPluginListThreadedRelease(chunkwm_export_application_terminated, Application, ReleaseApplication, NULL);
 #endif
-        RemoveAndDestroyApplication(Application);
     }
 
     EndCarbonApplicationDetails(Info);
@@ -212,6 +374,7 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_ApplicationActivated)
     macos_application *Application = GetApplicationFromPID(Info->PID);
     if (Application) {
         c_log(C_LOG_LEVEL_DEBUG, "%d:%s activated\n", Info->PID, Info->ProcessName);
+        PublishEvent(Subscription_Focus, "application_activated", true, "%d %s", Application->PID, Application->Name);
 #if 0
         ProcessPluginList(chunkwm_export_application_activated, Application);
 #else
@@ -287,6 +450,7 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_SpaceChanged)
      * every space change. Windows that are already tracked is NOT added multiple times.
      */
     UpdateWindowCollection();
+    PublishDesktopChanged();
 
 #if 0
     ProcessPluginList(chunkwm_export_space_changed, NULL);
@@ -304,11 +468,10 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_DisplayAdded)
     c_log(C_LOG_LEVEL_DEBUG, "%d: display added\n", *DisplayId);
 #if 0
     ProcessPluginList(chunkwm_export_display_added, DisplayId);
+    free(DisplayId);
 #else
-    ProcessPluginListThreaded(chunkwm_export_display_added, DisplayId);
+    ProcessPluginListThreadedRelease(chunkwm_export_display_added, DisplayId, ReleaseMemory, NULL);
 #endif
-
-    free(DisplayId);
 }
 
 CHUNKWM_CALLBACK(Callback_ChunkWM_DisplayRemoved)
@@ -319,11 +482,10 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_DisplayRemoved)
     c_log(C_LOG_LEVEL_DEBUG, "%d: display removed\n", *DisplayId);
 #if 0
     ProcessPluginList(chunkwm_export_display_removed, DisplayId);
+    free(DisplayId);
 #else
-    ProcessPluginListThreaded(chunkwm_export_display_removed, DisplayId);
+    ProcessPluginListThreadedRelease(chunkwm_export_display_removed, DisplayId, ReleaseMemory, NULL);
 #endif
-
-    free(DisplayId);
 }
 
 CHUNKWM_CALLBACK(Callback_ChunkWM_DisplayMoved)
@@ -334,11 +496,10 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_DisplayMoved)
     c_log(C_LOG_LEVEL_DEBUG, "%d: display moved\n", *DisplayId);
 #if 0
     ProcessPluginList(chunkwm_export_display_moved, DisplayId);
+    free(DisplayId);
 #else
-    ProcessPluginListThreaded(chunkwm_export_display_moved, DisplayId);
+    ProcessPluginListThreadedRelease(chunkwm_export_display_moved, DisplayId, ReleaseMemory, NULL);
 #endif
-
-    free(DisplayId);
 }
 
 CHUNKWM_CALLBACK(Callback_ChunkWM_DisplayResized)
@@ -349,11 +510,10 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_DisplayResized)
     c_log(C_LOG_LEVEL_DEBUG, "%d: display resolution changed\n", *DisplayId);
 #if 0
     ProcessPluginList(chunkwm_export_display_resized, DisplayId);
+    free(DisplayId);
 #else
-    ProcessPluginListThreaded(chunkwm_export_display_resized, DisplayId);
+    ProcessPluginListThreadedRelease(chunkwm_export_display_resized, DisplayId, ReleaseMemory, NULL);
 #endif
-
-    free(DisplayId);
 }
 
 CHUNKWM_CALLBACK(Callback_ChunkWM_DisplayChanged)
@@ -367,6 +527,7 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_DisplayChanged)
      * every space change. Windows that are already tracked is NOT added multiple times.
      */
     UpdateWindowCollection();
+    PublishDesktopChanged();
 
 #if 0
     ProcessPluginList(chunkwm_export_space_changed, NULL);
@@ -383,6 +544,7 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_WindowCreated)
 
     if (AddWindowToCollection(Window)) {
         c_log(C_LOG_LEVEL_DEBUG, "%s:%s%d window created\n", Window->Owner->Name, Window->Name, Window->Id);
+        PublishEvent(Subscription_Window, "window_created", false, "%u %d %s", Window->Id, Window->Owner->PID, Window->Owner->Name);
 #if 0
         ProcessPluginList(chunkwm_export_window_created, Window);
 #else
@@ -407,12 +569,14 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_WindowDestroyed)
     ASSERT(Window);
 
     c_log(C_LOG_LEVEL_DEBUG, "%s:%s:%d window destroyed\n", Window->Owner->Name, Window->Name, Window->Id);
+    PublishEvent(Subscription_Window, "window_destroyed", false, "%u %d %s", Window->Id, Window->Owner->PID, Window->Owner->Name);
+    StatePageClearFocus(Window->Id);
 #if 0
     ProcessPluginList(chunkwm_export_window_destroyed, Window);
+    AXLibDestroyWindow(Window);
 #else
-    ProcessPluginListThreaded(chunkwm_export_window_destroyed, Window);
+    ProcessPluginListThreadedRelease(chunkwm_export_window_destroyed, Window, ReleaseWindow, NULL);
 #endif
-    AXLibDestroyWindow(Window);
 }
 
 CHUNKWM_CALLBACK(Callback_ChunkWM_WindowFocused)
@@ -430,6 +594,8 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_WindowFocused)
          */
         if (!AXLibHasFlags(Window, Window_Minimized)) {
             c_log(C_LOG_LEVEL_DEBUG, "%s:%s:%d window focused\n", Window->Owner->Name, Window->Name, Window->Id);
+            PublishEvent(Subscription_Focus, "window_focused", true, "%u %d %s", Window->Id, Window->Owner->PID, Window->Owner->Name);
+            StatePageSetFocus(Window);
 #if 0
             ProcessPluginList(chunkwm_export_window_focused, Window);
 #else
@@ -449,13 +615,13 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_WindowMoved)
     uint32_t Flags = Window->Flags;
     bool Result = __sync_bool_compare_and_swap(&Window->Flags, Flags, Flags);
     if (Result && !AXLibHasFlags(Window, Window_Invalid)) {
-        Window->Position = AXLibGetWindowPosition(Window->Ref);
+        AXLibStoreWindowPosition(Window, AXLibGetWindowPosition(Window->Ref));
 
         c_log(C_LOG_LEVEL_DEBUG, "%s:%s:%d window moved\n", Window->Owner->Name, Window->Name, Window->Id);
 #if 0
         ProcessPluginList(chunkwm_export_window_moved, Window);
 #else
-        ProcessPluginListThreaded(chunkwm_export_window_moved, Window);
+        ProcessPluginListThreadedSnapshot(chunkwm_export_window_moved, WindowSnapshot(Window));
 #endif
     } else {
         c_log(C_LOG_LEVEL_DEBUG, "chunkwm:%s: __sync_bool_compare_and_swap failed\n", __FUNCTION__);
@@ -470,14 +636,14 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_WindowResized)
     uint32_t Flags = Window->Flags;
     bool Result = __sync_bool_compare_and_swap(&Window->Flags, Flags, Flags);
     if (Result && !AXLibHasFlags(Window, Window_Invalid)) {
-        Window->Position = AXLibGetWindowPosition(Window->Ref);
-        Window->Size = AXLibGetWindowSize(Window->Ref);
+        AXLibStoreWindowPosition(Window, AXLibGetWindowPosition(Window->Ref));
+        AXLibStoreWindowSize(Window, AXLibGetWindowSize(Window->Ref));
 
         c_log(C_LOG_LEVEL_DEBUG, "%s:%s:%d window resized\n", Window->Owner->Name, Window->Name, Window->Id);
 #if 0
         ProcessPluginList(chunkwm_export_window_resized, Window);
 #else
-        ProcessPluginListThreaded(chunkwm_export_window_resized, Window);
+        ProcessPluginListThreadedSnapshot(chunkwm_export_window_resized, WindowSnapshot(Window));
 #endif
     } else {
         c_log(C_LOG_LEVEL_DEBUG, "chunkwm:%s: __sync_bool_compare_and_swap failed\n", __FUNCTION__);
@@ -513,15 +679,26 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_WindowDeminimized)
     uint32_t Flags = Window->Flags;
     bool Result = __sync_bool_compare_and_swap(&Window->Flags, Flags, Flags);
     if (Result && !AXLibHasFlags(Window, Window_Invalid)) {
+        /*
+         * NOTE(koekeishiya): Plugins may still be reading the old roles while processing
+         * earlier events, so they are released once every plugin has seen this event.
+         */
+        CFTypeRef *PreviousRoles = NULL;
         if (AXLibHasFlags(Window, Window_Init_Minimized)) {
+            PreviousRoles = (CFTypeRef *) calloc(2, sizeof(CFTypeRef));
+
             if (Window->Mainrole) {
-                CFRelease(Window->Mainrole);
-                AXLibGetWindowRole(Window->Ref, &Window->Mainrole);
+                CFStringRef Mainrole = NULL;
+                AXLibGetWindowRole(Window->Ref, &Mainrole);
+                PreviousRoles[0] = Window->Mainrole;
+                Window->Mainrole = Mainrole;
             }
 
             if (Window->Subrole) {
-                CFRelease(Window->Subrole);
-                AXLibGetWindowSubrole(Window->Ref, &Window->Subrole);
+                CFStringRef Subrole = NULL;
+                AXLibGetWindowSubrole(Window->Ref, &Subrole);
+                PreviousRoles[1] = Window->Subrole;
+                Window->Subrole = Subrole;
             }
             AXLibClearFlags(Window, Window_Init_Minimized);
         }
@@ -531,8 +708,9 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_WindowDeminimized)
         AXLibClearFlags(Window, Window_Minimized);
 #if 0
         ProcessPluginList(chunkwm_export_window_deminimized, Window);
+        ReleaseWindowRoles(Window, PreviousRoles, false);
 #else
-        ProcessPluginListThreaded(chunkwm_export_window_deminimized, Window);
+        ProcessPluginListThreadedRelease(chunkwm_export_window_deminimized, Window, ReleaseWindowRoles, PreviousRoles);
 #endif
 
         /*
@@ -559,13 +737,15 @@ CHUNKWM_CALLBACK(Callback_ChunkWM_WindowTitleChanged)
     uint32_t Flags = Window->Flags;
     bool Result = __sync_bool_compare_and_swap(&Window->Flags, Flags, Flags);
     if (Result && !AXLibHasFlags(Window, Window_Invalid)) {
-        UpdateWindowTitle(Window);
+        char *PreviousTitle = UpdateWindowTitle(Window);
+        StatePageUpdateTitle(Window);
 
         c_log(C_LOG_LEVEL_DEBUG, "%s:%s:%d window title changed\n", Window->Owner->Name, Window->Name, Window->Id);
 #if 0
         ProcessPluginList(chunkwm_export_window_title_changed, Window);
+        if (PreviousTitle) free(PreviousTitle);
 #else
-        ProcessPluginListThreaded(chunkwm_export_window_title_changed, Window);
+        ProcessPluginListThreadedRelease(chunkwm_export_window_title_changed, Window, ReleaseWindowTitle, PreviousTitle);
 #endif
     } else {
         c_log(C_LOG_LEVEL_DEBUG, "chunkwm:%s: __sync_bool_compare_and_swap failed\n", __FUNCTION__);
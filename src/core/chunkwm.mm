@@ -13,12 +13,15 @@
 #include "dispatch/carbon.h"
 #include "dispatch/workspace.h"
 #include "dispatch/display.h"
+#include "dispatch/timer.h"
 #include "dispatch/event.h"
 
 #include "hotloader.h"
 #include "state.h"
 #include "plugin.h"
 #include "wqueue.h"
+#include "subscription.h"
+#include "statepage.h"
 #include "cvar.h"
 #include "constants.h"
 
@@ -32,6 +35,7 @@
 #include "../common/accessibility/application.cpp"
 #include "../common/accessibility/window.cpp"
 #include "../common/accessibility/element.cpp"
+#include "../common/accessibility/display.mm"
 
 #include "../common/ipc/daemon.cpp"
 #include "../common/config/tokenize.cpp"
@@ -41,12 +45,20 @@
 #include "dispatch/workspace.mm"
 #include "dispatch/event.cpp"
 #include "dispatch/display.cpp"
+#include "dispatch/timer.cpp"
 
 #include "hotloader.cpp"
 #include "state.cpp"
 #include "callback.cpp"
 #include "plugin.cpp"
 #include "wqueue.cpp"
+#include "pqueue.cpp"
+#include "twheel.cpp"
+#include "histogram.cpp"
+#include "trace.cpp"
+#include "replay.cpp"
+#include "subscription.cpp"
+#include "statepage.cpp"
 #include "config.cpp"
 #include "cvar.cpp"
 
@@ -191,7 +203,12 @@ int main(int Count, char **Args)
         Fail("chunkwm: failed to initialize cvars! abort..\n");
     }
 
-    if (!StartDaemon(CHUNKWM_PORT, DaemonCallback)) {
+    char SocketPath[MAX_LEN];
+    if (!DaemonSocketPath(SocketPath, sizeof(SocketPath))) {
+        SocketPath[0] = '\0';
+    }
+
+    if (!StartDaemon(SocketPath[0] ? SocketPath : NULL, CHUNKWM_PORT, DaemonCallback)) {
         Fail("chunkwm: failed to initialize daemon! abort..\n");
     }
 
@@ -211,6 +228,10 @@ int main(int Count, char **Args)
     NSApplicationLoad();
     AXUIElementSetMessagingTimeout(SystemWideElement(), 1.0);
 
+    if (!BeginTimerHandler()) {
+        Fail("chunkwm: failed to initialize timer handler! abort..\n");
+    }
+
     carbon_event_handler Carbon = {};
     if (!BeginCarbonEventHandler(&Carbon)) {
         Fail("chunkwm: failed to install carbon eventhandler! abort..\n");
@@ -224,8 +245,16 @@ int main(int Count, char **Args)
         c_log(C_LOG_LEVEL_WARN, "chunkwm: could not register for display notifications..\n");
     }
 
-    if (!BeginCallbackThreads(CHUNKWM_THREAD_COUNT)) {
-        c_log(C_LOG_LEVEL_WARN, "chunkwm: could not get semaphore, callback multi-threading disabled..\n");
+    if (!BeginCallbackThreads()) {
+        Fail("chunkwm: failed to start plugin worker threads! abort..\n");
+    }
+
+    if (!BeginSubscriptions()) {
+        Fail("chunkwm: failed to initialize critical mutex! abort..\n");
+    }
+
+    if (!BeginStatePage()) {
+        c_log(C_LOG_LEVEL_WARN, "chunkwm: could not create shared state page..\n");
     }
 
     BeginSharedWorkspace();
@@ -0,0 +1,64 @@
+#ifndef CHUNKWM_CORE_CLOCK_H
+#define CHUNKWM_CORE_CLOCK_H
+
+#include <stdint.h>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#include <mach/mach.h>
+#else
+#include <time.h>
+#endif
+
+#ifndef NSEC_PER_MSEC
+#define NSEC_PER_MSEC 1000000ULL
+#endif
+
+#ifndef NSEC_PER_USEC
+#define NSEC_PER_USEC 1000ULL
+#endif
+
+// NOTE(koekeishiya): Monotonic timestamp in nanoseconds, cheap enough to call per event.
+inline uint64_t
+GetMonotonicTime()
+{
+#ifdef __APPLE__
+    static mach_timebase_info_data_t Timebase;
+    if (Timebase.denom == 0) {
+        mach_timebase_info(&Timebase);
+    }
+
+    return (mach_absolute_time() * Timebase.numer) / Timebase.denom;
+#else
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return (uint64_t) Time.tv_sec * 1000000000ULL + (uint64_t) Time.tv_nsec;
+#endif
+}
+
+// NOTE(koekeishiya): CPU time consumed by the calling thread in nanoseconds, microsecond resolution on macOS.
+inline uint64_t
+GetThreadCPUTime()
+{
+#ifdef __APPLE__
+    thread_basic_info_data_t Info;
+    mach_msg_type_number_t Count = THREAD_BASIC_INFO_COUNT;
+    mach_port_t Thread = mach_thread_self();
+    kern_return_t Result = thread_info(Thread, THREAD_BASIC_INFO, (thread_info_t) &Info, &Count);
+    mach_port_deallocate(mach_task_self(), Thread);
+
+    if (Result != KERN_SUCCESS) {
+        return 0;
+    }
+
+    uint64_t Seconds = Info.user_time.seconds + Info.system_time.seconds;
+    uint64_t Microseconds = Info.user_time.microseconds + Info.system_time.microseconds;
+    return Seconds * 1000000000ULL + Microseconds * NSEC_PER_USEC;
+#else
+    struct timespec Time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &Time);
+    return (uint64_t) Time.tv_sec * 1000000000ULL + (uint64_t) Time.tv_nsec;
+#endif
+}
+
+#endif
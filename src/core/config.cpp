@@ -9,6 +9,9 @@
 #include "dispatch/event.h"
 
 #include "constants.h"
+#include "clock.h"
+#include "trace.h"
+#include "subscription.h"
 #include "cvar.h"
 
 #include <stdio.h>
@@ -77,21 +80,20 @@ PluginAbsolutepathFromDirectory(char *Filename, char *Directory)
 }
 
 internal bool
-PopulatePluginPath(const char **Message, plugin_fs *PluginFs)
+PopulatePluginPath(const char *Name, plugin_fs *PluginFs)
 {
     char *Absolutepath, *Filename;
-    token Token = GetToken(Message);
     char *Directory = CVarStringValue(CVAR_PLUGIN_DIR);
 
     if (Directory) {
-        Filename = TokenToString(Token);
+        Filename = strdup(Name);
         Absolutepath = PluginAbsolutepathFromDirectory(Filename, Directory);
         if (!Absolutepath) {
             free(Filename);
             return false;
         }
     } else {
-        Absolutepath = TokenToString(Token);
+        Absolutepath = strdup(Name);
         Filename = PluginFilenameFromAbsolutepath(Absolutepath);
         if (!Filename) {
             free(Absolutepath);
@@ -104,42 +106,236 @@ PopulatePluginPath(const char **Message, plugin_fs *PluginFs)
     return true;
 }
 
+// NOTE(koekeishiya): Name is a filename if the plugin directory is set, and an absolute path otherwise.
+internal bool
+LoadPluginByName(const char *Name)
+{
+    plugin_fs PluginFS;
+    if (!PopulatePluginPath(Name, &PluginFS)) {
+        return false;
+    }
+
+    bool Success;
+    struct stat Buffer;
+    if (lstat(PluginFS.Absolutepath, &Buffer) == 0) {
+        if (S_ISLNK(Buffer.st_mode)) {
+            char *ResolvedPath = (char *) malloc(PATH_MAX);
+            realpath(PluginFS.Absolutepath, ResolvedPath);
+            Success = LoadPlugin(ResolvedPath, PluginFS.Filename);
+            free(ResolvedPath);
+        } else {
+            Success = LoadPlugin(PluginFS.Absolutepath, PluginFS.Filename);
+        }
+    } else {
+        c_log(C_LOG_LEVEL_WARN, "chunkwm: plugin '%s' not found..\n", PluginFS.Absolutepath);
+        Success = false;
+    }
+
+    DestroyPluginFS(&PluginFS);
+    return Success;
+}
+
+internal bool
+UnloadPluginByName(const char *Name)
+{
+    plugin_fs PluginFS;
+    if (!PopulatePluginPath(Name, &PluginFS)) {
+        return false;
+    }
+
+    bool Success = UnloadPlugin(PluginFS.Absolutepath, PluginFS.Filename);
+    DestroyPluginFS(&PluginFS);
+    return Success;
+}
+
+/*
+ * NOTE(koekeishiya): The identifier has the form 'target::command' and is split in place.
+ * The remainder of the message is not copied; it stays valid until the socket is closed.
+ */
 internal bool
 ChunkwmDaemonDelegate(const char *Message, chunkwm_delegate *Delegate)
 {
-    bool Success = false;
     token IdentifierToken = GetToken(&Message);
 
-    if (IdentifierToken.Length > 0) {
-        char *Identifier = TokenToString(IdentifierToken);
-        char Target[64];
-        char Command[64];
+    token Target = { IdentifierToken.Text, 0 };
+    while (Target.Length < IdentifierToken.Length && Target.Text[Target.Length] != ':') {
+        ++Target.Length;
+    }
 
-        Success = (sscanf(Identifier, "%[^:]%*[:]%s", Target, Command) == 2);
-        if (Success) {
-            Delegate->Target = strdup(Target);
-            Delegate->Command = strdup(Command);
-            Delegate->Message = strdup(Message);
-        }
+    token Command = { Target.Text + Target.Length, IdentifierToken.Length - Target.Length };
+    while (Command.Length > 0 && *Command.Text == ':') {
+        ++Command.Text;
+        --Command.Length;
+    }
 
-        free(Identifier);
+    bool Success = ((Target.Length > 0) &&
+                    (Target.Length < IdentifierToken.Length) &&
+                    (Command.Length > 0));
+    if (Success) {
+        Delegate->Target = TokenToString(Target);
+        Delegate->Command = TokenToString(Command);
+        Delegate->Message = Message;
     }
 
     return Success;
 }
 
+internal inline bool
+ValidToken(token *Token)
+{
+    bool Result = Token->Length > 0;
+    return Result;
+}
+
+internal void
+WriteEventLoopStats(int SockFD)
+{
+    char Buffer[256];
+    const char *LaneName[Event_Lane_Count] = { "high", "normal" };
+
+    for (int Lane = 0; Lane < Event_Lane_Count; ++Lane) {
+        event_lane_stats Stats;
+        EventLoopLaneStats((event_lane) Lane, &Stats);
+
+        double AverageWait = Stats.Count ? (double) Stats.TotalWait / Stats.Count : 0.0;
+        snprintf(Buffer, sizeof(Buffer),
+                 "lane %-6s depth %u max_depth %u events %llu avg_wait %.3fms max_wait %.3fms\n",
+                 LaneName[Lane], Stats.Depth, Stats.MaxDepth,
+                 (unsigned long long) Stats.Count,
+                 AverageWait / NSEC_PER_MSEC,
+                 (double) Stats.MaxWait / NSEC_PER_MSEC);
+        WriteToSocket(Buffer, SockFD);
+    }
+
+    loaded_plugin_list *List = BeginLoadedPluginList();
+    for (loaded_plugin_list_iter It = List->begin(); It != List->end(); ++It) {
+        loaded_plugin *LoadedPlugin = It->second;
+
+        plugin_queue_stats Stats;
+        PluginQueueStats(&LoadedPlugin->Queue, &Stats);
+        snprintf(Buffer, sizeof(Buffer),
+                 "plugin %-16s depth %u max_depth %u processed %llu\n",
+                 LoadedPlugin->Info->PluginName, Stats.Depth, Stats.MaxDepth,
+                 (unsigned long long) Stats.Processed);
+        WriteToSocket(Buffer, SockFD);
+    }
+    EndLoadedPluginList();
+
+    uint64_t Dispatched;
+    double Throughput = EventLoopThroughput(&Dispatched);
+    snprintf(Buffer, sizeof(Buffer), "dispatched %llu events, %.2f events/s\n",
+             (unsigned long long) Dispatched, Throughput);
+    WriteToSocket(Buffer, SockFD);
+
+    for (int Type = 0; Type < ChunkWM_EventTypeCount; ++Type) {
+        event_type_stats *Stats = EventLoopTypeStats((event_type) Type);
+        uint64_t Merged = EventLoopMergedCount((event_type) Type);
+        if (!Stats->Queue.Count && !Merged) continue;
+
+        snprintf(Buffer, sizeof(Buffer), "%-24s count %llu merged %llu\n",
+                 EventTypeName((event_type) Type),
+                 (unsigned long long) Stats->Queue.Count,
+                 (unsigned long long) Merged);
+        WriteToSocket(Buffer, SockFD);
+
+        histogram *Histograms[2] = { &Stats->Queue, &Stats->Run };
+        const char *Names[2] = { "queue", "run" };
+
+        for (int Index = 0; Index < 2; ++Index) {
+            histogram *Histogram = Histograms[Index];
+            snprintf(Buffer, sizeof(Buffer),
+                     "    %-5s p50 %.3fms p90 %.3fms p99 %.3fms max %.3fms\n",
+                     Names[Index],
+                     HistogramPercentile(Histogram, 50.0) / 1000.0,
+                     HistogramPercentile(Histogram, 90.0) / 1000.0,
+                     HistogramPercentile(Histogram, 99.0) / 1000.0,
+                     Histogram->Max / 1000.0);
+            WriteToSocket(Buffer, SockFD);
+        }
+    }
+}
+
+internal void
+WritePluginProfile(int SockFD)
+{
+    char Buffer[256];
+
+    loaded_plugin_list *List = BeginLoadedPluginList();
+    for (loaded_plugin_list_iter It = List->begin(); It != List->end(); ++It) {
+        loaded_plugin *LoadedPlugin = It->second;
+        plugin_queue *Queue = &LoadedPlugin->Queue;
+
+        plugin_profile_map *Profiles = BeginPluginProfile(Queue);
+        snprintf(Buffer, sizeof(Buffer), "plugin %s over_budget %llu%s\n",
+                 LoadedPlugin->Info->PluginName,
+                 (unsigned long long) Queue->OverBudget,
+                 Queue->OverBudget ? " [!]" : "");
+        WriteToSocket(Buffer, SockFD);
+
+        for (plugin_profile_map_iter PIt = Profiles->begin(); PIt != Profiles->end(); ++PIt) {
+            plugin_profile *Profile = PIt->second;
+            snprintf(Buffer, sizeof(Buffer), "    %-40s count %llu over_budget %llu\n",
+                     PIt->first, (unsigned long long) Profile->Count,
+                     (unsigned long long) Profile->OverBudget);
+            WriteToSocket(Buffer, SockFD);
+
+            histogram *Histograms[2] = { &Profile->Wall, &Profile->CPU };
+            uint64_t Totals[2] = { Profile->WallTotal, Profile->CPUTotal };
+            const char *Names[2] = { "wall", "cpu" };
+
+            for (int Index = 0; Index < 2; ++Index) {
+                histogram *Histogram = Histograms[Index];
+                snprintf(Buffer, sizeof(Buffer),
+                         "        %-4s total %.3fms p50 %.3fms p99 %.3fms max %.3fms\n",
+                         Names[Index],
+                         Totals[Index] / 1000.0,
+                         HistogramPercentile(Histogram, 50.0) / 1000.0,
+                         HistogramPercentile(Histogram, 99.0) / 1000.0,
+                         Histogram->Max / 1000.0);
+                WriteToSocket(Buffer, SockFD);
+            }
+        }
+        EndPluginProfile(Queue);
+    }
+    EndLoadedPluginList();
+}
+
 internal void
 HandleCore(chunkwm_delegate *Delegate)
 {
+    bool Success = true;
+
     if (StringEquals(Delegate->Command, CVAR_PLUGIN_DIR)) {
         token Token = GetToken(&Delegate->Message);
-        char *Directory = TokenToString(Token);
-        UpdateCVar(CVAR_PLUGIN_DIR, Directory);
-        free(Directory);
+        if ((Success = ValidToken(&Token))) {
+            char *Directory = TokenToString(Token);
+            UpdateCVar(CVAR_PLUGIN_DIR, Directory);
+            free(Directory);
+        }
     } else if (StringEquals(Delegate->Command, CVAR_PLUGIN_HOTLOAD)) {
         token Token = GetToken(&Delegate->Message);
-        int Status = TokenToInt(Token);
-        UpdateCVar(CVAR_PLUGIN_HOTLOAD, Status);
+        if ((Success = ValidToken(&Token))) {
+            int Status = TokenToInt(Token);
+            UpdateCVar(CVAR_PLUGIN_HOTLOAD, Status);
+        }
+    } else if (StringEquals(Delegate->Command, CVAR_EVENT_DEBOUNCE)) {
+        token Token = GetToken(&Delegate->Message);
+        if ((Success = ValidToken(&Token))) {
+            int Milliseconds = TokenToInt(Token);
+            UpdateCVar(CVAR_EVENT_DEBOUNCE, Milliseconds);
+        }
+    } else if (StringEquals(Delegate->Command, CVAR_THREAD_COUNT)) {
+        token Token = GetToken(&Delegate->Message);
+        if ((Success = ValidToken(&Token))) {
+            int Count = TokenToInt(Token);
+            ResizeCallbackThreads(Count);
+        }
+    } else if (StringEquals(Delegate->Command, CVAR_PLUGIN_BUDGET)) {
+        token Token = GetToken(&Delegate->Message);
+        if ((Success = ValidToken(&Token))) {
+            int Milliseconds = TokenToInt(Token);
+            UpdateCVar(CVAR_PLUGIN_BUDGET, Milliseconds);
+        }
     } else if (StringEquals(Delegate->Command, CVAR_LOG_LEVEL)) {
         token Token = GetToken(&Delegate->Message);
         if (TokenEquals(Token, "none")) {
@@ -150,97 +346,185 @@ HandleCore(chunkwm_delegate *Delegate)
             c_log_active_level = C_LOG_LEVEL_WARN;
         } else if (TokenEquals(Token, "error")) {
             c_log_active_level = C_LOG_LEVEL_ERROR;
+        } else {
+            c_log(C_LOG_LEVEL_WARN, "chunkwm: invalid log-level '%.*s'\n", Token.Length, Token.Text);
+            Success = false;
         }
     } else if (StringEquals(Delegate->Command, "load")) {
-        plugin_fs PluginFS;
-        if (PopulatePluginPath(&Delegate->Message, &PluginFS)) {
-            struct stat Buffer;
-            if (lstat(PluginFS.Absolutepath, &Buffer) == 0) {
-                if (S_ISLNK(Buffer.st_mode)) {
-                    char *ResolvedPath = (char *) malloc(PATH_MAX);
-                    realpath(PluginFS.Absolutepath, ResolvedPath);
-                    LoadPlugin(ResolvedPath, PluginFS.Filename);
-                    free(ResolvedPath);
-                } else {
-                    LoadPlugin(PluginFS.Absolutepath, PluginFS.Filename);
-                }
-            } else {
-                c_log(C_LOG_LEVEL_WARN, "chunkwm: plugin '%s' not found..\n", PluginFS.Absolutepath);
-            }
-            DestroyPluginFS(&PluginFS);
-        }
+        token Token = GetToken(&Delegate->Message);
+        char *Name = TokenToString(Token);
+        Success = LoadPluginByName(Name);
+        free(Name);
     } else if (StringEquals(Delegate->Command, "unload")) {
-        plugin_fs PluginFS;
-        if (PopulatePluginPath(&Delegate->Message, &PluginFS)) {
-            UnloadPlugin(PluginFS.Absolutepath, PluginFS.Filename);
-            DestroyPluginFS(&PluginFS);
+        token Token = GetToken(&Delegate->Message);
+        char *Name = TokenToString(Token);
+        Success = UnloadPluginByName(Name);
+        free(Name);
+    } else if (StringEquals(Delegate->Command, "event_priority")) {
+        token TypeToken = GetToken(&Delegate->Message);
+        token LaneToken = GetToken(&Delegate->Message);
+        char *Name = TokenToString(TypeToken);
+
+        event_type Type;
+        if (!EventTypeFromName(Name, &Type)) {
+            c_log(C_LOG_LEVEL_WARN, "chunkwm: invalid event '%s'\n", Name);
+            Success = false;
+        } else if (TokenEquals(LaneToken, "high")) {
+            SetEventLane(Type, Event_Lane_High);
+        } else if (TokenEquals(LaneToken, "normal")) {
+            SetEventLane(Type, Event_Lane_Normal);
+        } else {
+            c_log(C_LOG_LEVEL_WARN, "chunkwm: invalid priority '%.*s'\n", LaneToken.Length, LaneToken.Text);
+            Success = false;
+        }
+
+        free(Name);
+    } else if (StringEquals(Delegate->Command, "pause")) {
+        PauseEventLoop();
+    } else if (StringEquals(Delegate->Command, "resume")) {
+        ResumeEventLoop();
+    } else if (StringEquals(Delegate->Command, "trace")) {
+        token Token = GetToken(&Delegate->Message);
+        if (TokenEquals(Token, "off")) {
+            EndTraceRecording();
+        } else if ((Success = ValidToken(&Token))) {
+            char *Path = TokenToString(Token);
+            Success = BeginTraceRecording(Path);
+            free(Path);
+        }
+    } else if (StringEquals(Delegate->Command, "replay")) {
+        token Token = GetToken(&Delegate->Message);
+        if ((Success = ValidToken(&Token))) {
+            token Mode = GetToken(&Delegate->Message);
+            char *Path = TokenToString(Token);
+            Success = ReplayTrace(Path, !TokenEquals(Mode, "fast"));
+            free(Path);
+        }
+    } else if (StringEquals(Delegate->Command, "profile")) {
+        WritePluginProfile(Delegate->SockFD);
+    } else if (StringEquals(Delegate->Command, "stats")) {
+        WriteEventLoopStats(Delegate->SockFD);
+    } else if (StringEquals(Delegate->Command, "subscribe")) {
+        // NOTE(koekeishiya): The socket now belongs to the subscriber, and stays open until the client goes away.
+        if ((Success = AddSubscriber(Delegate->SockFD, Delegate->Message))) {
+            Delegate->SockFD = -1;
         }
     } else {
         c_log(C_LOG_LEVEL_WARN, "chunkwm: invalid command '%s::%s'\n", Delegate->Target, Delegate->Command);
+        Success = false;
+    }
+
+    if (Delegate->SockFD != -1) {
+        if (!Success) {
+            SetSocketStatus(Delegate->SockFD, DAEMON_STATUS_FAILURE);
+        }
+
+        CloseSocket(Delegate->SockFD);
     }
 
-    CloseSocket(Delegate->SockFD);
     free(Delegate->Target);
     free(Delegate->Command);
     free(Delegate);
 }
 
-internal inline bool
-ValidToken(token *Token)
-{
-    bool Result = Token->Length > 0;
-    return Result;
-}
-
-internal void
+internal bool
 SetCVar(const char **Message)
 {
     token NameToken = GetToken(Message);
-    if (ValidToken(&NameToken)) {
-        token ValueToken = GetToken(Message);
-        if (ValidToken(&ValueToken)) {
-            char *Name = TokenToString(NameToken);
-            char *Value = TokenToString(ValueToken);
-            UpdateCVar(Name, Value);
-            free(Name);
-            free(Value);
-        } else {
-            c_log(C_LOG_LEVEL_WARN, "chunkwm: missing value for cvar '%.*s'.\n", NameToken.Length, NameToken.Length);
-        }
-    } else {
+    if (!ValidToken(&NameToken)) {
         c_log(C_LOG_LEVEL_WARN, "chunkwm: missing cvar name.\n");
+        return false;
+    }
+
+    token ValueToken = GetToken(Message);
+    if (!ValidToken(&ValueToken)) {
+        c_log(C_LOG_LEVEL_WARN, "chunkwm: missing value for cvar '%.*s'.\n", NameToken.Length, NameToken.Text);
+        return false;
     }
+
+    char *Name = TokenToString(NameToken);
+    char *Value = TokenToString(ValueToken);
+    UpdateCVar(Name, Value);
+    free(Name);
+    free(Value);
+    return true;
 }
 
-internal void
+internal bool
 GetCVar(const char **Message, int SockFD)
 {
     token NameToken = GetToken(Message);
-    if (ValidToken(&NameToken)) {
-        char *Name = TokenToString(NameToken);
-        char *Value = CVarStringValue(Name);
+    if (!ValidToken(&NameToken)) {
+        c_log(C_LOG_LEVEL_WARN, "chunkwm: missing cvar name.\n");
+        return false;
+    }
+
+    char *Name = TokenToString(NameToken);
+    char *Value = CVarStringValue(Name);
+    if (Value) {
         WriteToSocket(Value, SockFD);
-        free(Name);
     } else {
-        c_log(C_LOG_LEVEL_WARN, "chunkwm: missing cvar name.\n");
+        c_log(C_LOG_LEVEL_WARN, "chunkwm: cvar '%s' does not exist.\n", Name);
     }
+    free(Name);
+    return Value != NULL;
 }
 
 internal void
 HandleCVar(chunkwm_delegate *Delegate, const char **Message)
 {
+    bool Success;
     token Type = GetToken(Message);
     if (TokenEquals(Type, "set")) {
-        SetCVar(Message);
+        Success = SetCVar(Message);
     } else if (TokenEquals(Type, "get")) {
-        GetCVar(Message, Delegate->SockFD);
+        Success = GetCVar(Message, Delegate->SockFD);
     } else {
         c_log(C_LOG_LEVEL_WARN, "chunkwm: invalid command '%.*s %s'\n", Type.Length, Type.Text, *Message);
+        Success = false;
     }
+
+    if (!Success) {
+        SetSocketStatus(Delegate->SockFD, DAEMON_STATUS_FAILURE);
+    }
+
     CloseSocket(Delegate->SockFD);
     free(Delegate);
 }
 
+internal
+DAEMON_TASK(ExecuteCoreCommand)
+{
+    core_command *Command = (core_command *) Context;
+
+    switch (Command->Type) {
+    case Core_Command_LoadPlugin: {
+        LoadPluginByName(Command->Argument);
+    } break;
+    case Core_Command_UnloadPlugin: {
+        UnloadPluginByName(Command->Argument);
+    } break;
+    }
+
+    free(Command->Argument);
+    free(Command);
+}
+
+bool SubmitCoreCommand(core_command_type Type, const char *Argument)
+{
+    core_command *Command = (core_command *) malloc(sizeof(core_command));
+    Command->Type = Type;
+    Command->Argument = strdup(Argument);
+
+    if (!SubmitDaemonTask(ExecuteCoreCommand, Command)) {
+        free(Command->Argument);
+        free(Command);
+        return false;
+    }
+
+    return true;
+}
+
 DAEMON_CALLBACK(DaemonCallback)
 {
     chunkwm_delegate *Delegate = (chunkwm_delegate *) malloc(sizeof(chunkwm_delegate));
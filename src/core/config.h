@@ -1,6 +1,7 @@
 #ifndef CHUNKWM_CORE_CONFIG_H
 #define CHUNKWM_CORE_CONFIG_H
 
+// NOTE(koekeishiya): Message points into the request buffer of the daemon, and is only valid until SockFD is closed.
 struct chunkwm_delegate
 {
     int SockFD;
@@ -9,4 +10,24 @@ struct chunkwm_delegate
     const char *Message;
 };
 
+enum core_command_type
+{
+    Core_Command_LoadPlugin,
+    Core_Command_UnloadPlugin,
+};
+
+struct core_command
+{
+    core_command_type Type;
+    char *Argument;
+};
+
+/*
+ * NOTE(koekeishiya): Runs a core command on behalf of chunkwm itself. The command is queued
+ * behind the commands received by the daemon, exactly as if it had been sent by chunkc, but
+ * does not go through a socket and is not parsed from text. Returns false if the daemon is
+ * not running.
+ */
+bool SubmitCoreCommand(core_command_type Type, const char *Argument);
+
 #endif
@@ -7,13 +7,14 @@
 #define CHUNKWM_MINOR           2
 #define CHUNKWM_PATCH           36
 
-#define CHUNKWM_THREAD_COUNT    4
-
 #define CHUNKWM_CONFIG          ".chunkwmrc"
 #define CHUNKWM_PORT            3920
 
 #define CVAR_PLUGIN_DIR         "plugin_dir"
 #define CVAR_PLUGIN_HOTLOAD     "hotload"
 #define CVAR_LOG_LEVEL          "log_level"
+#define CVAR_EVENT_DEBOUNCE     "event_debounce"
+#define CVAR_THREAD_COUNT       "thread_count"
+#define CVAR_PLUGIN_BUDGET      "plugin_budget"
 
 #endif
@@ -1,6 +1,10 @@
 #include "cvar.h"
+#include "dispatch/event.h"
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
 #include <pthread.h>
 
 #include "../common/misc/assert.h"
@@ -9,61 +13,294 @@
 
 extern chunkwm_api API;
 
-internal cvar_map CVars;
+internal cvar_table *CVars;
+internal std::vector<cvar_watch> CVarWatches;
+internal uint64_t CVarsGeneration;
 internal pthread_mutex_t CVarsLock;
 
+// NOTE(koekeishiya): FNV-1a
+internal uint32_t
+HashCVarName(const char *Name)
+{
+    uint32_t Hash = 2166136261u;
+    while (*Name) {
+        Hash ^= (unsigned char) *Name++;
+        Hash *= 16777619u;
+    }
+    return Hash;
+}
+
+internal cvar_table *
+CreateCVarTable(uint32_t Capacity)
+{
+    cvar_table *Table = (cvar_table *) malloc(sizeof(cvar_table));
+    Table->Capacity = Capacity;
+    Table->Count = 0;
+    Table->Entries = (cvar **) calloc(Capacity, sizeof(cvar *));
+    Table->Retired = NULL;
+    return Table;
+}
+
+internal void
+InsertCVar(cvar_table *Table, cvar *Var)
+{
+    uint32_t Mask = Table->Capacity - 1;
+    uint32_t Index = HashCVarName(Var->Name) & Mask;
+    while (Table->Entries[Index]) {
+        Index = (Index + 1) & Mask;
+    }
+
+    __atomic_store_n(&Table->Entries[Index], Var, __ATOMIC_RELEASE);
+    ++Table->Count;
+}
+
+// NOTE(koekeishiya): Caller must hold CVarsLock.
+internal void
+GrowCVarTable()
+{
+    cvar_table *Table = CreateCVarTable(CVars->Capacity * 2);
+    for (uint32_t Index = 0; Index < CVars->Capacity; ++Index) {
+        if (CVars->Entries[Index]) {
+            InsertCVar(Table, CVars->Entries[Index]);
+        }
+    }
+
+    Table->Retired = CVars;
+    __atomic_store_n(&CVars, Table, __ATOMIC_RELEASE);
+}
+
+// NOTE(koekeishiya): Does not require CVarsLock.
 internal cvar *
 _FindCVar(const char *Name)
 {
-    cvar_map_it It = CVars.find(Name);
-    return It != CVars.end() ? It->second : NULL;
+    cvar_table *Table = __atomic_load_n(&CVars, __ATOMIC_ACQUIRE);
+    uint32_t Mask = Table->Capacity - 1;
+    uint32_t Index = HashCVarName(Name) & Mask;
+
+    cvar *Var;
+    while ((Var = __atomic_load_n(&Table->Entries[Index], __ATOMIC_ACQUIRE))) {
+        if (strcmp(Var->Name, Name) == 0) {
+            return Var;
+        }
+        Index = (Index + 1) & Mask;
+    }
+
+    return NULL;
+}
+
+internal uint64_t
+ParseCVarValue(cvar_type Type, const char *String)
+{
+    cvar_value Value = {};
+    switch (Type) {
+    case CVar_Integer:       { sscanf(String, "%d", &Value.Integer);       } break;
+    case CVar_Unsigned:      { sscanf(String, "%x", &Value.Unsigned);      } break;
+    case CVar_FloatingPoint: { sscanf(String, "%f", &Value.FloatingPoint); } break;
+    case CVar_String:        {                                             } break;
+    }
+
+    uint32_t Bits;
+    memcpy(&Bits, &Value, sizeof(Bits));
+    return ((uint64_t) Type << 32) | Bits;
+}
+
+internal inline cvar_type
+TypedCVarType(uint64_t Typed)
+{
+    return (cvar_type) (Typed >> 32);
 }
 
+internal inline cvar_value
+TypedCVarValue(uint64_t Typed)
+{
+    cvar_value Value;
+    uint32_t Bits = (uint32_t) Typed;
+    memcpy(&Value, &Bits, sizeof(Bits));
+    return Value;
+}
+
+/*
+ * NOTE(koekeishiya): Caller must hold CVarsLock. Assigning the value and type that a cvar
+ * already has is not a change, and does not invalidate anything built from a snapshot.
+ */
+internal void
+_SetCVarValue(cvar *Var, cvar_type Type, char *Value)
+{
+    bool Changed = false;
+    if ((Var->Value != Value) && (strcmp(Var->Value, Value) != 0)) {
+        free(Var->Value);
+        Var->Value = strdup(Value);
+        Changed = true;
+    }
+
+    uint64_t Typed = ParseCVarValue(Type, Var->Value);
+    if (Typed != Var->Typed) {
+        __atomic_store_n(&Var->Typed, Typed, __ATOMIC_RELEASE);
+        Changed = true;
+    }
+
+    if (Changed) {
+        __atomic_add_fetch(&CVarsGeneration, 1, __ATOMIC_RELEASE);
+    }
+}
+
+// NOTE(koekeishiya): Caller must hold CVarsLock.
 internal cvar *
-_CreateCVar(const char *Name, char *Value)
+_CreateCVar(const char *Name, cvar_type Type, char *Value)
 {
     cvar *Var = (cvar *) malloc(sizeof(cvar));
 
     Var->Name = strdup(Name);
     Var->Value = strdup(Value);
+    Var->Typed = ParseCVarValue(Type, Var->Value);
 
+    if ((CVars->Count + 1) * 2 > CVars->Capacity) {
+        GrowCVarTable();
+    }
+
+    InsertCVar(CVars, Var);
+    __atomic_add_fetch(&CVarsGeneration, 1, __ATOMIC_RELEASE);
     return Var;
 }
 
+// NOTE(koekeishiya): A '#' in the name of a watch matches one or more digits, as in '#_desktop_mode'.
+internal bool
+CVarWatchMatches(cvar_watch *Watch, const char *Name)
+{
+    const char *Pattern = Watch->Name;
+    while (*Pattern) {
+        if (*Pattern == '#') {
+            if (!isdigit((unsigned char) *Name)) return false;
+            while (isdigit((unsigned char) *Name)) ++Name;
+        } else if (*Pattern != *Name++) {
+            return false;
+        }
+        ++Pattern;
+    }
+
+    return Watch->Prefix || *Name == '\0';
+}
+
+// NOTE(koekeishiya): Caller must hold CVarsLock.
+internal bool
+_IsCVarWatched(const char *Plugin, const char *Name)
+{
+    for (size_t Index = 0; Index < CVarWatches.size(); ++Index) {
+        cvar_watch *Watch = &CVarWatches[Index];
+        if ((Plugin) && (strcmp(Watch->Plugin, Plugin) != 0)) {
+            continue;
+        }
+
+        if (CVarWatchMatches(Watch, Name)) return true;
+    }
+
+    return false;
+}
+
+internal inline char *
+CopyToSnapshot(char **At, const char *String)
+{
+    char *Result = *At;
+    size_t Length = strlen(String) + 1;
+    memcpy(Result, String, Length);
+    *At += Length;
+    return Result;
+}
+
+// NOTE(koekeishiya): Caller must hold CVarsLock. Vars[Index] is NULL if Names[Index] does not exist.
+internal void
+_BuildCVarSnapshot(cvar **Vars, const char **Names, unsigned Count, cvar_snapshot *Snapshot)
+{
+    size_t Size = Count * sizeof(cvar_snapshot_entry);
+    for (unsigned Index = 0; Index < Count; ++Index) {
+        Size += strlen(Names[Index]) + 1;
+        if (Vars[Index]) Size += strlen(Vars[Index]->Value) + 1;
+    }
+
+    char *Memory = (char *) malloc(Size);
+    char *At = Memory + Count * sizeof(cvar_snapshot_entry);
+
+    Snapshot->Entries = (cvar_snapshot_entry *) Memory;
+    Snapshot->Count = Count;
+    Snapshot->Generation = CVarsGeneration;
+
+    for (unsigned Index = 0; Index < Count; ++Index) {
+        cvar_snapshot_entry *Entry = &Snapshot->Entries[Index];
+        cvar *Var = Vars[Index];
+
+        Entry->Name = CopyToSnapshot(&At, Names[Index]);
+        if (Var) {
+            Entry->String = CopyToSnapshot(&At, Var->Value);
+            Entry->Type = TypedCVarType(Var->Typed);
+            Entry->Value = TypedCVarValue(Var->Typed);
+        } else {
+            Entry->String = NULL;
+            Entry->Type = CVar_String;
+            Entry->Value = TypedCVarValue(0);
+        }
+    }
+}
+
+// NOTE(koekeishiya): The event owns the copy of the name.
+internal void
+NotifyCVarChanged(const char *Name)
+{
+    ConstructEvent(ChunkWM_CVarChanged, strdup(Name));
+}
+
 bool BeginCVars()
 {
+    CVars = CreateCVarTable(CVAR_TABLE_INITIAL_CAPACITY);
     BeginCVars(&API);
     return pthread_mutex_init(&CVarsLock, NULL) == 0;
 }
 
 void EndCVars()
 {
-    for (cvar_map_it It = CVars.begin(); It != CVars.end(); ++It) {
-        cvar *Var = It->second;
+    for (uint32_t Index = 0; Index < CVars->Capacity; ++Index) {
+        cvar *Var = CVars->Entries[Index];
+        if (!Var) continue;
 
         free((char *) Var->Name);
         free(Var->Value);
         free(Var);
     }
 
-    CVars.clear();
+    while (CVars) {
+        cvar_table *Table = CVars;
+        CVars = Table->Retired;
+        free(Table->Entries);
+        free(Table);
+    }
+
+    for (size_t Index = 0; Index < CVarWatches.size(); ++Index) {
+        free(CVarWatches[Index].Plugin);
+        free(CVarWatches[Index].Name);
+    }
+
+    CVarWatches.clear();
+
     pthread_mutex_destroy(&CVarsLock);
 }
 
 // NOTE(koekeishiya): API - Exposed to plugins through pointer
 void UpdateCVarAPI(const char *Name, char *Value)
 {
+    bool Changed = true;
+
     pthread_mutex_lock(&CVarsLock);
     cvar *Var = _FindCVar(Name);
     if (Var) {
         ASSERT(Var->Value);
-        free(Var->Value);
-        Var->Value = strdup(Value);
+        Changed = strcmp(Var->Value, Value) != 0;
+        _SetCVarValue(Var, TypedCVarType(Var->Typed), Value);
     } else {
-        cvar *Var = _CreateCVar(Name, Value);
-        CVars[Var->Name] = Var;
+        _CreateCVar(Name, CVar_String, Value);
     }
+    bool Notify = Changed && _IsCVarWatched(NULL, Name);
     pthread_mutex_unlock(&CVarsLock);
+
+    if (Notify) NotifyCVarChanged(Name);
 }
 
 // NOTE(koekeishiya): API - Exposed to plugins through pointer
@@ -79,8 +316,133 @@ char *AcquireCVarAPI(const char *Name)
 // NOTE(koekeishiya): API - Exposed to plugins through pointer
 bool FindCVarAPI(const char *Name)
 {
+    return _FindCVar(Name) != NULL;
+}
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+void DeclareCVarAPI(const char *Name, cvar_type Type, char *Value)
+{
+    bool Created = false;
+
     pthread_mutex_lock(&CVarsLock);
-    cvar *CVar = _FindCVar(Name);
+    cvar *Var = _FindCVar(Name);
+    if (Var) {
+        _SetCVarValue(Var, Type, Var->Value);
+    } else {
+        _CreateCVar(Name, Type, Value);
+        Created = true;
+    }
+    bool Notify = Created && _IsCVarWatched(NULL, Name);
     pthread_mutex_unlock(&CVarsLock);
-    return CVar != NULL;
+
+    if (Notify) NotifyCVarChanged(Name);
+}
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+cvar_handle ResolveCVarAPI(const char *Name)
+{
+    return _FindCVar(Name);
+}
+
+/*
+ * NOTE(koekeishiya): API - Exposed to plugins through pointer
+ * A cvar that was declared with a different type, or that has not been declared at all,
+ * is parsed from its string value, the same way it was before cvars had types.
+ */
+bool AcquireCVarHandleValueAPI(cvar_handle Handle, cvar_type Type, cvar_value *Value)
+{
+    if (!Handle) return false;
+
+    uint64_t Typed = __atomic_load_n(&Handle->Typed, __ATOMIC_ACQUIRE);
+    if (TypedCVarType(Typed) == Type) {
+        *Value = TypedCVarValue(Typed);
+    } else {
+        pthread_mutex_lock(&CVarsLock);
+        *Value = TypedCVarValue(ParseCVarValue(Type, Handle->Value));
+        pthread_mutex_unlock(&CVarsLock);
+    }
+
+    return true;
+}
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+bool AcquireCVarValueAPI(const char *Name, cvar_type Type, cvar_value *Value)
+{
+    return AcquireCVarHandleValueAPI(_FindCVar(Name), Type, Value);
+}
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+void WatchCVarAPI(const char *Plugin, const char *Name, bool Prefix)
+{
+    if (!Plugin || !Name) {
+        return;
+    }
+
+    cvar_watch Watch = { strdup(Plugin), strdup(Name), Prefix };
+
+    pthread_mutex_lock(&CVarsLock);
+    CVarWatches.push_back(Watch);
+    pthread_mutex_unlock(&CVarsLock);
+}
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+void AcquireCVarSnapshotAPI(const char **Names, unsigned Count, cvar_snapshot *Snapshot)
+{
+    std::vector<cvar *> Vars(Count);
+
+    pthread_mutex_lock(&CVarsLock);
+    for (unsigned Index = 0; Index < Count; ++Index) {
+        Vars[Index] = _FindCVar(Names[Index]);
+    }
+    _BuildCVarSnapshot(Vars.data(), Names, Count, Snapshot);
+    pthread_mutex_unlock(&CVarsLock);
+}
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+void AcquireCVarPrefixSnapshotAPI(const char *Prefix, cvar_snapshot *Snapshot)
+{
+    std::vector<cvar *> Vars;
+    std::vector<const char *> Names;
+    size_t PrefixLength = strlen(Prefix);
+
+    pthread_mutex_lock(&CVarsLock);
+    for (uint32_t Index = 0; Index < CVars->Capacity; ++Index) {
+        cvar *Var = CVars->Entries[Index];
+        if ((Var) && (strncmp(Var->Name, Prefix, PrefixLength) == 0)) {
+            Vars.push_back(Var);
+            Names.push_back(Var->Name);
+        }
+    }
+    _BuildCVarSnapshot(Vars.data(), Names.data(), Vars.size(), Snapshot);
+    pthread_mutex_unlock(&CVarsLock);
+}
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+uint64_t CVarGenerationAPI()
+{
+    return __atomic_load_n(&CVarsGeneration, __ATOMIC_ACQUIRE);
+}
+
+void UnwatchCVars(const char *Plugin)
+{
+    pthread_mutex_lock(&CVarsLock);
+    for (size_t Index = 0; Index < CVarWatches.size();) {
+        cvar_watch *Watch = &CVarWatches[Index];
+        if (strcmp(Watch->Plugin, Plugin) == 0) {
+            free(Watch->Plugin);
+            free(Watch->Name);
+            CVarWatches.erase(CVarWatches.begin() + Index);
+        } else {
+            ++Index;
+        }
+    }
+    pthread_mutex_unlock(&CVarsLock);
+}
+
+bool IsCVarWatchedBy(const char *Plugin, const char *Name)
+{
+    pthread_mutex_lock(&CVarsLock);
+    bool Result = _IsCVarWatched(Plugin, Name);
+    pthread_mutex_unlock(&CVarsLock);
+    return Result;
 }
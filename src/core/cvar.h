@@ -1,13 +1,33 @@
 #ifndef CHUNKWM_CORE_CVAR_H
 #define CHUNKWM_CORE_CVAR_H
 
-#include <map>
+#include <stdint.h>
+#include <vector>
 
 #include "../common/config/cvar.h"
-#include "../common/misc/string.h"
 
-typedef std::map<const char *, cvar *, string_comparator> cvar_map;
-typedef cvar_map::iterator cvar_map_it;
+#define CVAR_TABLE_INITIAL_CAPACITY 128
+
+/*
+ * NOTE(koekeishiya): Open-addressed hash table of cvars. Entries are only ever added, and
+ * the load factor is kept below one half, so a lookup always terminates at an empty slot.
+ * When the table grows, the new table is published with a single atomic store, and the old
+ * one is kept alive in the Retired list until EndCVars, as readers may still be using it.
+ */
+struct cvar_table
+{
+    uint32_t Capacity;
+    uint32_t Count;
+    cvar **Entries;
+    cvar_table *Retired;
+};
+
+struct cvar_watch
+{
+    char *Plugin;
+    char *Name;
+    bool Prefix;
+};
 
 bool BeginCVars();
 void EndCVars();
@@ -21,4 +41,31 @@ char *AcquireCVarAPI(const char *Name);
 // NOTE(koekeishiya): API - Exposed to plugins through pointer
 bool FindCVarAPI(const char *Name);
 
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+void DeclareCVarAPI(const char *Name, cvar_type Type, char *Value);
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+bool AcquireCVarValueAPI(const char *Name, cvar_type Type, cvar_value *Value);
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+cvar_handle ResolveCVarAPI(const char *Name);
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+bool AcquireCVarHandleValueAPI(cvar_handle Handle, cvar_type Type, cvar_value *Value);
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+void WatchCVarAPI(const char *Plugin, const char *Name, bool Prefix);
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+void AcquireCVarSnapshotAPI(const char **Names, unsigned Count, cvar_snapshot *Snapshot);
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+void AcquireCVarPrefixSnapshotAPI(const char *Prefix, cvar_snapshot *Snapshot);
+
+// NOTE(koekeishiya): API - Exposed to plugins through pointer
+uint64_t CVarGenerationAPI();
+
+void UnwatchCVars(const char *Plugin);
+bool IsCVarWatchedBy(const char *Plugin, const char *Name);
+
 #endif
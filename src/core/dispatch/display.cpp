@@ -5,10 +5,27 @@
 
 #define internal static
 
-/* NOTE(koekeishiya): Get notified about display changes. */
+internal bool DisplayReconfiguring;
+
+/*
+ * NOTE(koekeishiya): Get notified about display changes.
+ *
+ * Before a reconfiguration, this callback runs once for every online display with
+ * the 'kCGDisplayBeginConfigurationFlag' set. Windows are moved and resized while
+ * the displays are reconfigured, so we pause the event-loop until the first callback
+ * that reports the result, and let the event-loop replay everything as one batch.
+ */
 internal void
 DisplayCallback(CGDirectDisplayID DisplayId, CGDisplayChangeSummaryFlags Flags, void *Reference)
 {
+    if (Flags & kCGDisplayBeginConfigurationFlag) {
+        if (!DisplayReconfiguring) {
+            DisplayReconfiguring = true;
+            PauseEventLoop();
+        }
+        return;
+    }
+
     CGDirectDisplayID *Context = (CGDirectDisplayID *) malloc(sizeof(CGDirectDisplayID));
     *Context = DisplayId;
 
@@ -23,6 +40,11 @@ DisplayCallback(CGDirectDisplayID DisplayId, CGDisplayChangeSummaryFlags Flags,
     } else {
         free(Context);
     }
+
+    if (DisplayReconfiguring) {
+        DisplayReconfiguring = false;
+        ResumeEventLoop();
+    }
 }
 
 bool BeginDisplayHandler()
@@ -1,95 +1,778 @@
 #include "event.h"
+#include "workspace.h"
+#include "../../common/misc/carbon.h"
 #include "../clog.h"
+#include "../clock.h"
+#include "../trace.h"
+#include "../pqueue.h"
+#include "../constants.h"
+#include "../../common/config/cvar.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
 
 #define internal static
 
 internal event_loop EventLoop = {};
 
+internal const char *EventTypeStr[ChunkWM_EventTypeCount] =
+{
+    "application_launched",
+    "application_terminated",
+    "application_activated",
+    "application_deactivated",
+    "application_visible",
+    "application_hidden",
+
+    "display_added",
+    "display_removed",
+    "display_moved",
+    "display_resized",
+    "display_changed",
+    "space_changed",
+
+    "window_created",
+    "window_destroyed",
+    "window_focused",
+    "window_moved",
+    "window_resized",
+    "window_minimized",
+    "window_deminimized",
+    "window_title_changed",
+
+    "plugin_command",
+    "plugin_broadcast",
+    "cvar_changed",
+};
+
+internal event_coalesce_policy CoalescePolicy[ChunkWM_EventTypeCount] =
+{
+    Coalesce_None,      // ChunkWM_ApplicationLaunched
+    Coalesce_None,      // ChunkWM_ApplicationTerminated
+    Coalesce_None,      // ChunkWM_ApplicationActivated
+    Coalesce_None,      // ChunkWM_ApplicationDeactivated
+    Coalesce_None,      // ChunkWM_ApplicationVisible
+    Coalesce_None,      // ChunkWM_ApplicationHidden
+
+    Coalesce_Display,   // ChunkWM_DisplayAdded
+    Coalesce_Display,   // ChunkWM_DisplayRemoved
+    Coalesce_Display,   // ChunkWM_DisplayMoved
+    Coalesce_Display,   // ChunkWM_DisplayResized
+    Coalesce_Display,   // ChunkWM_DisplayChanged
+    Coalesce_None,      // ChunkWM_SpaceChanged
+
+    Coalesce_None,      // ChunkWM_WindowCreated
+    Coalesce_None,      // ChunkWM_WindowDestroyed
+    Coalesce_None,      // ChunkWM_WindowFocused
+    Coalesce_Window,    // ChunkWM_WindowMoved
+    Coalesce_Window,    // ChunkWM_WindowResized
+    Coalesce_None,      // ChunkWM_WindowMinimized
+    Coalesce_None,      // ChunkWM_WindowDeminimized
+    Coalesce_Window,    // ChunkWM_WindowTitleChanged
+
+    Coalesce_None,      // ChunkWM_PluginCommand
+    Coalesce_None,      // ChunkWM_PluginBroadcast
+    Coalesce_None,      // ChunkWM_CVarChanged
+};
+
+const char *EventTypeName(event_type Type)
+{
+    return EventTypeStr[Type];
+}
+
+bool EventTypeFromName(const char *Name, event_type *Type)
+{
+    for (int Index = 0; Index < ChunkWM_EventTypeCount; ++Index) {
+        if (strcmp(EventTypeStr[Index], Name) == 0) {
+            *Type = (event_type) Index;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint64_t EventLoopMergedCount(event_type Type)
+{
+    return __atomic_load_n(&EventLoop.Merged[Type], __ATOMIC_RELAXED);
+}
+
+void SetEventLane(event_type Type, event_lane Lane)
+{
+    __atomic_store_n(&EventLoop.LaneForType[Type], Lane, __ATOMIC_RELAXED);
+}
+
+event_type_stats *EventLoopTypeStats(event_type Type)
+{
+    return &EventLoop.TypeStats[Type];
+}
+
+// NOTE(koekeishiya): Average number of events dispatched per second since the event-loop started.
+double EventLoopThroughput(uint64_t *Dispatched)
+{
+    *Dispatched = EventLoop.Dispatched;
+
+    uint64_t Elapsed = GetMonotonicTime() - EventLoop.StartTime;
+    return Elapsed ? (double) *Dispatched * 1e9 / Elapsed : 0.0;
+}
+
+/*
+ * NOTE(koekeishiya): The counters are written by the event-loop thread only.
+ * Readers may observe a slightly stale snapshot, which is fine for reporting.
+ */
+void EventLoopLaneStats(event_lane Lane, event_lane_stats *Stats)
+{
+    event_queue *Queue = &EventLoop.Lanes[Lane];
+    *Stats = EventLoop.LaneStats[Lane];
+    Stats->Depth = __atomic_load_n(&Queue->Head, __ATOMIC_RELAXED) -
+                   __atomic_load_n(&Queue->Tail, __ATOMIC_RELAXED);
+}
+
+internal void
+EventQueueInit(event_queue *Queue)
+{
+    for (uint32_t Index = 0; Index < EVENT_QUEUE_SIZE; ++Index) {
+        Queue->Cells[Index].Sequence = Index;
+    }
+
+    Queue->Head = 0;
+    Queue->Tail = 0;
+}
+
+/* NOTE(koekeishiya): Must be thread-safe! Returns false if the ring is full. */
+internal bool
+EventQueuePush(event_queue *Queue, chunk_event *Event)
+{
+    uint32_t Head = __atomic_load_n(&Queue->Head, __ATOMIC_RELAXED);
+    for (;;) {
+        event_queue_cell *Cell = Queue->Cells + (Head & (EVENT_QUEUE_SIZE - 1));
+        uint32_t Sequence = __atomic_load_n(&Cell->Sequence, __ATOMIC_ACQUIRE);
+        int32_t Difference = (int32_t) Sequence - (int32_t) Head;
+
+        if (Difference == 0) {
+            if (__atomic_compare_exchange_n(&Queue->Head, &Head, Head + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                Cell->Event = *Event;
+                __atomic_store_n(&Cell->Sequence, Head + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+        } else if (Difference < 0) {
+            return false;
+        } else {
+            Head = __atomic_load_n(&Queue->Head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/* NOTE(koekeishiya): Must only be called from the event-loop thread. */
+internal bool
+EventQueuePop(event_queue *Queue, chunk_event *Event)
+{
+    uint32_t Tail = Queue->Tail;
+    event_queue_cell *Cell = Queue->Cells + (Tail & (EVENT_QUEUE_SIZE - 1));
+    uint32_t Sequence = __atomic_load_n(&Cell->Sequence, __ATOMIC_ACQUIRE);
+
+    if (Sequence != Tail + 1) {
+        return false;
+    }
+
+    *Event = Cell->Event;
+    __atomic_store_n(&Cell->Sequence, Tail + EVENT_QUEUE_SIZE, __ATOMIC_RELEASE);
+    __atomic_store_n(&Queue->Tail, Tail + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+internal inline bool
+EventQueueEmpty(event_queue *Queue)
+{
+    uint32_t Tail = Queue->Tail;
+    event_queue_cell *Cell = Queue->Cells + (Tail & (EVENT_QUEUE_SIZE - 1));
+    return __atomic_load_n(&Cell->Sequence, __ATOMIC_ACQUIRE) != Tail + 1;
+}
+
+/*
+ * NOTE(koekeishiya): The ring is full. We can not block the producer, because
+ * plugins broadcast events from worker threads that the event-loop may be waiting
+ * on. Once an event has spilled, producers keep spilling until the consumer has
+ * drained the overflow, so that events from a single producer stay in order.
+ */
+internal void
+SpillEvent(chunk_event *Event)
+{
+    pthread_mutex_lock(&EventLoop.Lock);
+    if (!EventLoop.Spilled) {
+        c_log(C_LOG_LEVEL_WARN, "chunkwm: event queue is full, spilling events..\n");
+    }
+    __atomic_store_n(&EventLoop.Spilled, 1, __ATOMIC_RELEASE);
+    EventLoop.Overflow.push(*Event);
+    pthread_mutex_unlock(&EventLoop.Lock);
+}
+
+/*
+ * NOTE(koekeishiya): Paired with the fence in 'WaitForEvents'. Either we observe
+ * that the consumer is sleeping, or the consumer observes our event before it sleeps.
+ */
+internal inline void
+WakeEventLoop()
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&EventLoop.Sleeping, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&EventLoop.Lock);
+        pthread_cond_signal(&EventLoop.Condition);
+        pthread_mutex_unlock(&EventLoop.Lock);
+    }
+}
+
+internal inline bool
+IsWindowEvent(event_type Type)
+{
+    return ((Type >= ChunkWM_WindowCreated) &&
+            (Type <= ChunkWM_WindowTitleChanged));
+}
+
+internal inline bool
+IsApplicationEvent(event_type Type)
+{
+    return ((Type >= ChunkWM_ApplicationLaunched) &&
+            (Type <= ChunkWM_ApplicationHidden));
+}
+
+/*
+ * NOTE(koekeishiya): Launched and terminated carry the carbon details of the
+ * process, the remaining application events carry the workspace details.
+ */
+internal inline pid_t
+ApplicationEventPID(chunk_event *Event)
+{
+    if ((Event->Type == ChunkWM_ApplicationLaunched) ||
+        (Event->Type == ChunkWM_ApplicationTerminated)) {
+        return ((carbon_application_details *) Event->Context)->PID;
+    }
+
+    return ((workspace_application_details *) Event->Context)->PID;
+}
+
+/*
+ * NOTE(koekeishiya): Window events are ordered per window, application events
+ * are ordered per process. Returns NULL for events that are never reordered.
+ */
+internal inline uint32_t volatile *
+PendingSlot(chunk_event *Event)
+{
+    uintptr_t Key;
+    if (IsWindowEvent(Event->Type)) {
+        Key = (uintptr_t) Event->Context >> 4;
+    } else if ((IsApplicationEvent(Event->Type)) && (Event->Context)) {
+        Key = (uintptr_t) ApplicationEventPID(Event);
+    } else {
+        return NULL;
+    }
+
+    return EventLoop.Pending + (Key & (EVENT_LANE_SLOTS - 1));
+}
+
+internal event_lane
+SelectEventLane(chunk_event *Event)
+{
+    event_lane Lane = __atomic_load_n(&EventLoop.LaneForType[Event->Type], __ATOMIC_RELAXED);
+    uint32_t volatile *Pending = PendingSlot(Event);
+    if (Pending) {
+        if ((Lane == Event_Lane_High) &&
+            (__atomic_load_n(Pending, __ATOMIC_ACQUIRE) != 0)) {
+            Lane = Event_Lane_Normal;
+        }
+
+        if (Lane == Event_Lane_Normal) {
+            __atomic_add_fetch(Pending, 1, __ATOMIC_ACQ_REL);
+        }
+    }
+
+    return Lane;
+}
+
 /* NOTE(koekeishiya): Must be thread-safe! Called through ConstructEvent macro */
 void AddEvent(chunk_event Event)
 {
     if (EventLoop.Running && Event.Handle) {
+        Event.Timestamp = GetMonotonicTime();
+        Event.Lane = SelectEventLane(&Event);
+
+        if ((__atomic_load_n(&EventLoop.Spilled, __ATOMIC_ACQUIRE)) ||
+            (!EventQueuePush(&EventLoop.Lanes[Event.Lane], &Event))) {
+            SpillEvent(&Event);
+        }
+        WakeEventLoop();
+    }
+}
+
+internal void
+RetireEvent(chunk_event *Event, uint32_t Depth)
+{
+    if (Event->Lane == Event_Lane_Normal) {
+        uint32_t volatile *Pending = PendingSlot(Event);
+        if (Pending) __atomic_sub_fetch(Pending, 1, __ATOMIC_ACQ_REL);
+    }
+
+    event_lane_stats *Stats = &EventLoop.LaneStats[Event->Lane];
+    if (Depth > Stats->MaxDepth) Stats->MaxDepth = Depth;
+}
+
+internal bool
+NextEvent(chunk_event *Event)
+{
+    for (int Lane = 0; Lane < Event_Lane_Count; ++Lane) {
+        event_queue *Queue = &EventLoop.Lanes[Lane];
+        uint32_t Depth = __atomic_load_n(&Queue->Head, __ATOMIC_RELAXED) - Queue->Tail;
+        if (EventQueuePop(Queue, Event)) {
+            RetireEvent(Event, Depth);
+            return true;
+        }
+    }
+
+    bool Result = false;
+    if (__atomic_load_n(&EventLoop.Spilled, __ATOMIC_ACQUIRE)) {
         pthread_mutex_lock(&EventLoop.Lock);
-        EventLoop.Queue.push(Event);
+        uint32_t Depth = EventLoop.Overflow.size();
+        if (!EventLoop.Overflow.empty()) {
+            *Event = EventLoop.Overflow.front();
+            EventLoop.Overflow.pop();
+            Result = true;
+        }
+
+        if (EventLoop.Overflow.empty()) {
+            __atomic_store_n(&EventLoop.Spilled, 0, __ATOMIC_RELEASE);
+        }
         pthread_mutex_unlock(&EventLoop.Lock);
-        sem_post(EventLoop.Semaphore);
+
+        if (Result) {
+            RetireEvent(Event, Depth);
+        }
     }
+
+    return Result;
+}
+
+internal inline bool
+EventLoopEmpty()
+{
+    for (int Lane = 0; Lane < Event_Lane_Count; ++Lane) {
+        if (!EventQueueEmpty(&EventLoop.Lanes[Lane])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+internal inline bool
+EventLoopPaused()
+{
+    return __atomic_load_n(&EventLoop.PauseDepth, __ATOMIC_ACQUIRE) != 0;
+}
+
+// NOTE(koekeishiya): The event-loop has been resumed and has held events to replay.
+internal inline bool
+HeldEventsReady()
+{
+    return ((!EventLoopPaused()) && (!EventLoop.Held.empty()));
+}
+
+/*
+ * NOTE(koekeishiya): Sleep until an event arrives. If 'Deadline' is non-zero we also
+ * wake up once the monotonic clock passes it, so that debounced events are flushed.
+ */
+internal void
+WaitForEvents(uint64_t Deadline)
+{
+    struct timespec Timeout;
+    if (Deadline) {
+        uint64_t Now = GetMonotonicTime();
+        uint64_t Remaining = Deadline > Now ? Deadline - Now : 0;
+
+        struct timeval Time;
+        gettimeofday(&Time, NULL);
+        uint64_t Absolute = (uint64_t) Time.tv_sec * 1000000000ULL + (uint64_t) Time.tv_usec * 1000ULL + Remaining;
+        Timeout.tv_sec = Absolute / 1000000000ULL;
+        Timeout.tv_nsec = Absolute % 1000000000ULL;
+    }
+
+    pthread_mutex_lock(&EventLoop.Lock);
+    __atomic_store_n(&EventLoop.Sleeping, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    while ((EventLoop.Running) &&
+           (!EventLoop.Spilled) &&
+           (!HeldEventsReady()) &&
+           (EventLoopEmpty())) {
+        if (Deadline) {
+            if (pthread_cond_timedwait(&EventLoop.Condition, &EventLoop.Lock, &Timeout) == ETIMEDOUT) {
+                break;
+            }
+        } else {
+            pthread_cond_wait(&EventLoop.Condition, &EventLoop.Lock);
+        }
+    }
+
+    __atomic_store_n(&EventLoop.Sleeping, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&EventLoop.Lock);
+}
+
+internal inline uint32_t
+DisplayEventKey(chunk_event *Event)
+{
+    return Event->Context ? *(uint32_t *) Event->Context : 0;
+}
+
+internal inline void
+MergeEvent(chunk_event *Event)
+{
+    if (CoalescePolicy[Event->Type] == Coalesce_Display && Event->Context) {
+        free(Event->Context);
+    }
+
+    __atomic_add_fetch(&EventLoop.Merged[Event->Type], 1, __ATOMIC_RELAXED);
+    Event->Handle = NULL;
+}
+
+/*
+ * NOTE(koekeishiya): Walk the batch backwards and drop every window event that is
+ * followed by an event of the same type for the same window. The callbacks re-read
+ * position, size and title from the window, so only the latest event carries any
+ * information. A batch is at most EVENT_BATCH_SIZE events, the quadratic scan is fine.
+ */
+internal void
+CoalesceBatch(chunk_event *Batch, int Count)
+{
+    for (int Index = Count - 2; Index >= 0; --Index) {
+        chunk_event *Event = Batch + Index;
+        if (CoalescePolicy[Event->Type] != Coalesce_Window) continue;
+
+        for (int Next = Index + 1; Next < Count; ++Next) {
+            chunk_event *Later = Batch + Next;
+            if ((Later->Handle) &&
+                (Later->Type == Event->Type) &&
+                (Later->Context == Event->Context)) {
+                MergeEvent(Event);
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * NOTE(koekeishiya): Display events arrive in bursts when a monitor is connected or
+ * reconfigured. Hold them back until the burst has settled, replacing any pending
+ * event of the same type for the same display.
+ */
+internal void
+DeferDisplayEvent(chunk_event *Event)
+{
+    for (size_t Index = 0; Index < EventLoop.Deferred.size(); ++Index) {
+        chunk_event *Pending = &EventLoop.Deferred[Index];
+        if ((Pending->Type == Event->Type) &&
+            (DisplayEventKey(Pending) == DisplayEventKey(Event))) {
+            MergeEvent(Pending);
+            EventLoop.Deferred.erase(EventLoop.Deferred.begin() + Index);
+            break;
+        }
+    }
+
+    EventLoop.Deferred.push_back(*Event);
+
+    int Debounce = CVarIntegerValue(CVAR_EVENT_DEBOUNCE);
+    EventLoop.DeferredDeadline = GetMonotonicTime() + (uint64_t) Debounce * NSEC_PER_MSEC;
+}
+
+internal void
+DispatchEvent(chunk_event *Event)
+{
+    if (IsTraceRecording()) {
+        TraceEvent(Event);
+    }
+
+    uint64_t Start = GetMonotonicTime();
+    EventLoop.Dispatching = Event;
+    EventLoop.DispatchStart = Start;
+    EventLoop.Completion = NULL;
+
+    (*Event->Handle)(Event);
+
+    EventLoop.Dispatching = NULL;
+
+    /*
+     * NOTE(koekeishiya): Wait is measured up to dispatch, so that it includes the time an
+     * event spent in a batch, deferred for merging, or held while the event-loop was paused.
+     */
+    uint64_t Wait = Start - Event->Timestamp;
+    event_lane_stats *LaneStats = &EventLoop.LaneStats[Event->Lane];
+    ++LaneStats->Count;
+    LaneStats->TotalWait += Wait;
+    if (Wait > LaneStats->MaxWait) LaneStats->MaxWait = Wait;
+
+    event_type_stats *Stats = &EventLoop.TypeStats[Event->Type];
+    HistogramRecord(&Stats->Queue, Wait / NSEC_PER_USEC);
+    if (EventLoop.Completion) {
+        ReleasePluginPayload(EventLoop.Completion);
+    } else {
+        HistogramRecordShared(&Stats->Run, (GetMonotonicTime() - Start) / NSEC_PER_USEC);
+    }
+    ++EventLoop.Dispatched;
+}
+
+/*
+ * NOTE(koekeishiya): Must only be called from a callback on the event-loop thread. The
+ * event that is being dispatched is complete once every plugin that received the payload
+ * has returned, so we keep a reference until the callback returns and let the payload
+ * record the run time of the event when its last reference is dropped.
+ */
+void TrackEventCompletion(plugin_payload *Payload)
+{
+    chunk_event *Event = EventLoop.Dispatching;
+    if ((Event) && (!EventLoop.Completion)) {
+        RetainPluginPayload(Payload);
+        Payload->Latency = &EventLoop.TypeStats[Event->Type].Run;
+        Payload->Start = EventLoop.DispatchStart;
+        EventLoop.Completion = Payload;
+    }
+}
+
+internal void
+FlushDeferredEvents()
+{
+    std::vector<chunk_event> Deferred;
+    Deferred.swap(EventLoop.Deferred);
+    EventLoop.DeferredDeadline = 0;
+
+    for (size_t Index = 0; Index < Deferred.size(); ++Index) {
+        DispatchEvent(&Deferred[Index]);
+    }
+}
+
+internal void
+DispatchBatch(chunk_event *Batch, int Count)
+{
+    CoalesceBatch(Batch, Count);
+
+    for (int Index = 0; Index < Count; ++Index) {
+        chunk_event *Event = Batch + Index;
+        if (!Event->Handle) continue;
+
+        if (CoalescePolicy[Event->Type] == Coalesce_Display) {
+            DeferDisplayEvent(Event);
+        } else {
+            DispatchEvent(Event);
+        }
+    }
+}
+
+/*
+ * NOTE(koekeishiya): Only window, application, space and display events are held back
+ * while the event-loop is paused. Plugin commands, broadcasts and cvar notifications
+ * are dispatched immediately, because the caller that paused the event-loop is usually
+ * waiting on them (e.g. 'chunkc core::pause; chunkc tiling::...; chunkc core::resume').
+ */
+internal inline bool
+IsHeldWhilePaused(event_type Type)
+{
+    return Type < ChunkWM_PluginCommand;
+}
+
+/*
+ * NOTE(koekeishiya): While the event-loop is paused, events are held back and merged
+ * as they arrive: window and display events replace an earlier event of the same
+ * type for the same window or display, and events without a context replace an
+ * earlier event of the same type. Everything else is kept in order.
+ */
+internal void
+HoldEvent(chunk_event *Event)
+{
+    event_coalesce_policy Policy = CoalescePolicy[Event->Type];
+    bool Mergeable = ((Policy != Coalesce_None) || (Event->Context == NULL));
+
+    if (Mergeable) {
+        for (size_t Index = 0; Index < EventLoop.Held.size(); ++Index) {
+            chunk_event *Held = &EventLoop.Held[Index];
+            if (Held->Type != Event->Type) continue;
+
+            bool Match = (Policy == Coalesce_Display)
+                       ? (DisplayEventKey(Held) == DisplayEventKey(Event))
+                       : (Held->Context == Event->Context);
+            if (Match) {
+                MergeEvent(Held);
+                EventLoop.Held.erase(EventLoop.Held.begin() + Index);
+                break;
+            }
+        }
+    }
+
+    EventLoop.Held.push_back(*Event);
+}
+
+internal void
+ReplayHeldEvents()
+{
+    std::vector<chunk_event> Held;
+    Held.swap(EventLoop.Held);
+
+    c_log(C_LOG_LEVEL_DEBUG, "chunkwm: replaying %zu held events\n", Held.size());
+    DispatchBatch(Held.data(), Held.size());
+}
+
+/*
+ * NOTE(koekeishiya): A caller that never resumes the event-loop, or a burst that
+ * exceeds our limit, must not stall event processing or grow memory without bound.
+ */
+internal void
+ForceResumeEventLoop(const char *Reason)
+{
+    pthread_mutex_lock(&EventLoop.Lock);
+    if (EventLoop.PauseDepth) {
+        c_log(C_LOG_LEVEL_WARN, "chunkwm: %s, resuming event-loop!\n", Reason);
+        __atomic_store_n(&EventLoop.PauseDepth, 0, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&EventLoop.Lock);
 }
 
 internal void *
 ProcessEventQueue(void *)
 {
     while (EventLoop.Running) {
-        pthread_mutex_lock(&EventLoop.Lock);
-        bool HasWork = !EventLoop.Queue.empty();
-        pthread_mutex_unlock(&EventLoop.Lock);
+        if ((EventLoopPaused()) &&
+            (GetMonotonicTime() >= EventLoop.PauseDeadline)) {
+            ForceResumeEventLoop("pause timed out");
+        }
+
+        int Count = 0;
+        while ((Count < EVENT_BATCH_SIZE) &&
+               (NextEvent(EventLoop.Batch + Count))) {
+            ++Count;
+        }
 
-        while (HasWork) {
-            pthread_mutex_lock(&EventLoop.Lock);
-            chunk_event Event = EventLoop.Queue.front();
-            EventLoop.Queue.pop();
+        if (EventLoopPaused()) {
+            for (int Index = 0; Index < Count; ++Index) {
+                chunk_event *Event = EventLoop.Batch + Index;
+                if (IsHeldWhilePaused(Event->Type)) {
+                    HoldEvent(Event);
+                } else {
+                    DispatchEvent(Event);
+                }
+            }
 
-            HasWork = !EventLoop.Queue.empty();
-            pthread_mutex_unlock(&EventLoop.Lock);
+            if (EventLoop.Held.size() >= EVENT_PAUSE_LIMIT) {
+                ForceResumeEventLoop("too many events held");
+            }
+        } else if (!EventLoop.Held.empty()) {
+            for (int Index = 0; Index < Count; ++Index) {
+                HoldEvent(EventLoop.Batch + Index);
+            }
 
-            (*Event.Handle)(&Event);
+            ReplayHeldEvents();
+        } else if (Count) {
+            DispatchBatch(EventLoop.Batch, Count);
         }
 
-        int Result = sem_wait(EventLoop.Semaphore);
-        if (Result) {
-            uint64_t ID;
-            pthread_threadid_np(NULL, &ID);
-            c_log(C_LOG_LEVEL_DEBUG, "%lld: sem_wait(..) failed\n", ID);
+        uint64_t Deadline;
+        if (EventLoopPaused()) {
+            Deadline = EventLoop.PauseDeadline;
+        } else {
+            if ((EventLoop.DeferredDeadline) &&
+                (GetMonotonicTime() >= EventLoop.DeferredDeadline)) {
+                FlushDeferredEvents();
+            }
+
+            Deadline = EventLoop.DeferredDeadline;
+        }
+
+        if (Count < EVENT_BATCH_SIZE) {
+            WaitForEvents(Deadline);
         }
     }
 
     return NULL;
 }
 
-/* NOTE(koekeishiya): Initialize required mutexes and semaphore for the eventloop */
+/* NOTE(koekeishiya): Initialize required mutex and condition for the eventloop */
 internal bool
 BeginEventLoop()
 {
     bool Result = true;
 
-    if ((EventLoop.Semaphore = sem_open("eventloop_semaphore", O_CREAT, 0644, 0)) == SEM_FAILED) {
-        c_log(C_LOG_LEVEL_ERROR, "chunkwm: could not initialize semaphore!");
-        goto sem_err;
-    }
-
     if (pthread_mutex_init(&EventLoop.Lock, NULL) != 0) {
         c_log(C_LOG_LEVEL_ERROR, "chunkwm: could not initialize work mutex!");
-        goto work_err;
+        goto mutex_err;
+    }
+
+    if (pthread_cond_init(&EventLoop.Condition, NULL) != 0) {
+        c_log(C_LOG_LEVEL_ERROR, "chunkwm: could not initialize work condition!");
+        goto cond_err;
+    }
+
+    for (int Lane = 0; Lane < Event_Lane_Count; ++Lane) {
+        EventQueueInit(&EventLoop.Lanes[Lane]);
+    }
+
+    for (int Type = 0; Type < ChunkWM_EventTypeCount; ++Type) {
+        EventLoop.LaneForType[Type] = Event_Lane_Normal;
     }
 
+    EventLoop.LaneForType[ChunkWM_ApplicationActivated] = Event_Lane_High;
+    EventLoop.LaneForType[ChunkWM_WindowFocused] = Event_Lane_High;
+
+    CreateCVar(CVAR_EVENT_DEBOUNCE, EVENT_DEBOUNCE_DEFAULT);
+    EventLoop.DeferredDeadline = 0;
+    EventLoop.PauseDepth = 0;
+    EventLoop.StartTime = GetMonotonicTime();
+    EventLoop.Sleeping = 0;
+    EventLoop.Spilled = 0;
     goto out;
 
-work_err:
-    sem_destroy(EventLoop.Semaphore);
+cond_err:
+    pthread_mutex_destroy(&EventLoop.Lock);
 
-sem_err:
+mutex_err:
     Result = false;
 
 out:
     return Result;
 }
 
-/* NOTE(koekeishiya): Destroy mutexes and condition used by the event-loop */
+/* NOTE(koekeishiya): Destroy mutex and condition used by the event-loop */
 internal void
 EndEventLoop()
 {
+    pthread_cond_destroy(&EventLoop.Condition);
     pthread_mutex_destroy(&EventLoop.Lock);
-    sem_destroy(EventLoop.Semaphore);
 }
 
+/*
+ * NOTE(koekeishiya): Pause and resume nest. Events that arrive while the event-loop
+ * is paused are held back and replayed as a single merged batch once the last caller
+ * resumes, so that work done during a reconfiguration is not thrown away immediately.
+ */
 void PauseEventLoop()
 {
-    // TODO(koekeishiya): Probably want a proper way to temporarily ignore all events
+    if (!EventLoop.Running) return;
+
+    pthread_mutex_lock(&EventLoop.Lock);
+    if (EventLoop.PauseDepth == 0) {
+        EventLoop.PauseDeadline = GetMonotonicTime() + EVENT_PAUSE_TIMEOUT * NSEC_PER_MSEC;
+    }
+    __atomic_add_fetch(&EventLoop.PauseDepth, 1, __ATOMIC_ACQ_REL);
+    pthread_mutex_unlock(&EventLoop.Lock);
 }
 
 void ResumeEventLoop()
 {
-    // TODO(koekeishiya): NYI
+    if (!EventLoop.Running) return;
+
+    pthread_mutex_lock(&EventLoop.Lock);
+    if ((EventLoop.PauseDepth) &&
+        (__atomic_sub_fetch(&EventLoop.PauseDepth, 1, __ATOMIC_ACQ_REL) == 0)) {
+        pthread_cond_signal(&EventLoop.Condition);
+    }
+    pthread_mutex_unlock(&EventLoop.Lock);
 }
 
 bool StartEventLoop()
@@ -107,6 +790,11 @@ void StopEventLoop()
 {
     if (EventLoop.Running) {
         EventLoop.Running = false;
+
+        pthread_mutex_lock(&EventLoop.Lock);
+        pthread_cond_signal(&EventLoop.Condition);
+        pthread_mutex_unlock(&EventLoop.Lock);
+
         pthread_join(EventLoop.Thread, NULL);
         EndEventLoop();
     }
@@ -1,11 +1,15 @@
 #ifndef CHUNKWM_OSX_EVENT_H
 #define CHUNKWM_OSX_EVENT_H
 
+#include <stdint.h>
 #include <pthread.h>
-#include <semaphore.h>
 #include <queue>
+#include <vector>
+
+#include "../histogram.h"
 
 struct chunk_event;
+struct plugin_payload;
 #define CHUNKWM_CALLBACK(name) void name(chunk_event *Event)
 typedef CHUNKWM_CALLBACK(chunkwm_callback);
 
@@ -37,6 +41,7 @@ extern CHUNKWM_CALLBACK(Callback_ChunkWM_WindowTitleChanged);
 // NOTE(koekeishiya): This property is not exposed to plugins
 extern CHUNKWM_CALLBACK(Callback_ChunkWM_PluginCommand);
 extern CHUNKWM_CALLBACK(Callback_ChunkWM_PluginBroadcast);
+extern CHUNKWM_CALLBACK(Callback_ChunkWM_CVarChanged);
 
 enum event_type
 {
@@ -68,21 +73,146 @@ enum event_type
     // NOTE(koekeishiya): This property is not exposed to plugins
     ChunkWM_PluginCommand,
     ChunkWM_PluginBroadcast,
+    ChunkWM_CVarChanged,
+
+    ChunkWM_EventTypeCount
+};
+
+/*
+ * NOTE(koekeishiya): Events in the high priority lane are always dispatched before
+ * events in the normal lane. A window or application event is only put in the high
+ * priority lane if no event for the same window or process is waiting in the normal
+ * lane, such that events for a single window or process are never reordered.
+ */
+enum event_lane
+{
+    Event_Lane_High,
+    Event_Lane_Normal,
+
+    Event_Lane_Count
 };
 
 struct chunk_event
 {
     chunkwm_callback *Handle;
     void *Context;
+    event_type Type;
+    event_lane Lane;
+    uint64_t Timestamp;
+};
+
+/*
+ * NOTE(koekeishiya): How the event-loop may merge events of a given type before dispatch.
+ *
+ * Coalesce_Window   -> Only the latest event for a given window is kept in a batch.
+ *                      The context is a 'macos_window *' and is never freed here.
+ *
+ * Coalesce_Display  -> Held back until no display event has arrived for 'event_debounce'
+ *                      milliseconds. Only the latest event per display is kept.
+ *                      The context is an owned 'CGDirectDisplayID *', or NULL.
+ */
+enum event_coalesce_policy
+{
+    Coalesce_None,
+    Coalesce_Window,
+    Coalesce_Display,
 };
 
+#define EVENT_BATCH_SIZE 256
+#define EVENT_DEBOUNCE_DEFAULT 100
+
+#define EVENT_PAUSE_LIMIT 1024
+#define EVENT_PAUSE_TIMEOUT 5000
+
+/*
+ * NOTE(koekeishiya): Bounded multi-producer / single-consumer ring buffer.
+ * Every cell carries a sequence number that tells producers and the consumer
+ * whose turn it is to touch the slot, so pushing an event is a single CAS on
+ * 'Head'. 'Head' and 'Tail' live on separate cache lines to avoid producers
+ * and the consumer invalidating each other on every operation.
+ */
+#define EVENT_QUEUE_SIZE 4096
+#define EVENT_LANE_SLOTS 256
+#define CACHE_LINE_SIZE  64
+
+struct event_queue_cell
+{
+    uint32_t volatile Sequence;
+    chunk_event Event;
+};
+
+struct event_queue
+{
+    uint32_t volatile Head __attribute__((aligned(CACHE_LINE_SIZE)));
+    uint32_t volatile Tail __attribute__((aligned(CACHE_LINE_SIZE)));
+    event_queue_cell Cells[EVENT_QUEUE_SIZE] __attribute__((aligned(CACHE_LINE_SIZE)));
+};
+
+/*
+ * NOTE(koekeishiya): Wait is in nanoseconds, from the moment an event was added until it was
+ * dispatched; merged events are not counted. Depth is the number of events in the ring.
+ */
+struct event_lane_stats
+{
+    uint64_t Count;
+    uint64_t TotalWait;
+    uint64_t MaxWait;
+    uint32_t Depth;
+    uint32_t MaxDepth;
+};
+
+/*
+ * NOTE(koekeishiya): Latency in microseconds from the moment an event was added, until
+ * its callback starts (Queue), and from then until the callback and every plugin that
+ * received the event have returned (Run). Plugins run asynchronously, so 'Run' is
+ * recorded by whichever thread drops the last reference to the event's payload.
+ */
+struct event_type_stats
+{
+    histogram Queue;
+    histogram Run;
+};
+
+/*
+ * NOTE(koekeishiya): 'Lock' and 'Condition' are only touched when the consumer
+ * has gone to sleep, or when the ring is full and events spill into 'Overflow'.
+ *
+ * 'Pending' counts window and application events waiting in the normal lane, hashed
+ * by window and by pid. A collision only means that an event is not promoted to the
+ * high priority lane.
+ */
 struct event_loop
 {
-    bool Running;
+    event_queue Lanes[Event_Lane_Count];
+    uint32_t volatile Pending[EVENT_LANE_SLOTS];
+    event_lane volatile LaneForType[ChunkWM_EventTypeCount];
+    event_lane_stats LaneStats[Event_Lane_Count];
+
+    bool volatile Running;
     pthread_t Thread;
-    sem_t *Semaphore;
+
+    chunk_event Batch[EVENT_BATCH_SIZE];
+    std::vector<chunk_event> Deferred;
+    uint64_t DeferredDeadline;
+    uint64_t volatile Merged[ChunkWM_EventTypeCount];
+
+    uint64_t StartTime;
+    uint64_t Dispatched;
+    event_type_stats TypeStats[ChunkWM_EventTypeCount];
+
+    chunk_event *Dispatching;
+    uint64_t DispatchStart;
+    plugin_payload *Completion;
+
+    uint32_t volatile PauseDepth;
+    uint64_t PauseDeadline;
+    std::vector<chunk_event> Held;
+
+    uint32_t volatile Sleeping;
+    uint32_t volatile Spilled;
     pthread_mutex_t Lock;
-    std::queue<chunk_event> Queue;
+    pthread_cond_t Condition;
+    std::queue<chunk_event> Overflow;
 };
 
 bool StartEventLoop();
@@ -93,11 +223,23 @@ void ResumeEventLoop();
 
 void AddEvent(chunk_event Event);
 
+const char *EventTypeName(event_type Type);
+bool EventTypeFromName(const char *Name, event_type *Type);
+uint64_t EventLoopMergedCount(event_type Type);
+
+void SetEventLane(event_type Type, event_lane Lane);
+void EventLoopLaneStats(event_lane Lane, event_lane_stats *Stats);
+
+event_type_stats *EventLoopTypeStats(event_type Type);
+void TrackEventCompletion(plugin_payload *Payload);
+double EventLoopThroughput(uint64_t *Dispatched);
+
 /* NOTE(koekeishiya): Construct a chunk_event with the appropriate callback through macro expansion. */
 #define ConstructEvent(EventType, EventContext) \
     do { chunk_event Event = {}; \
          Event.Context = EventContext; \
          Event.Handle = &Callback_##EventType; \
+         Event.Type = EventType; \
          AddEvent(Event); \
        } while(0)
 
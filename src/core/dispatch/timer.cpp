@@ -0,0 +1,126 @@
+#include "timer.h"
+#include "../clock.h"
+
+#include <Carbon/Carbon.h>
+#include <pthread.h>
+
+#define internal static
+
+/*
+ * NOTE(koekeishiya): All delayed work in the core is driven by a single timer wheel,
+ * instead of one dispatch_after block per retry. A single run loop timer on the main
+ * thread advances the wheel while there are pending timers, and is parked otherwise.
+ * Callbacks run on the main thread, outside of the lock, so they are free to schedule
+ * or cancel timers, including the one that fired.
+ */
+internal timer_wheel Wheel;
+internal pthread_mutex_t TimerLock;
+internal CFRunLoopTimerRef RunLoopTimer;
+
+#define TIMER_PARKED 1.0e10
+
+internal inline uint64_t
+CurrentTick()
+{
+    return GetMonotonicTime() / (TIMER_TICK_MSEC * NSEC_PER_MSEC);
+}
+
+internal void
+TimerHandlerCallback(CFRunLoopTimerRef, void *)
+{
+    pthread_mutex_lock(&TimerLock);
+    TimerWheelAdvance(&Wheel, CurrentTick());
+
+    timer *Timer;
+    while ((Timer = TimerWheelPopExpired(&Wheel))) {
+        timer_callback *Callback = Timer->Callback;
+        void *Data = Timer->Data;
+
+        pthread_mutex_unlock(&TimerLock);
+        (*Callback)(Timer, Data);
+        pthread_mutex_lock(&TimerLock);
+    }
+
+    if (Wheel.Count == 0) {
+        CFRunLoopTimerSetNextFireDate(RunLoopTimer, CFAbsoluteTimeGetCurrent() + TIMER_PARKED);
+    }
+    pthread_mutex_unlock(&TimerLock);
+}
+
+void ScheduleTimer(timer *Timer, uint32_t Delay, timer_callback *Callback, void *Data)
+{
+    uint64_t Ticks = (Delay + TIMER_TICK_MSEC - 1) / TIMER_TICK_MSEC;
+
+    pthread_mutex_lock(&TimerLock);
+    bool Parked = Wheel.Count == 0;
+
+    /*
+     * NOTE(koekeishiya): The wheel is not advanced while it is empty, so we have to
+     * catch up to the current tick before computing the expiry of the new timer.
+     * This is O(1) for an empty wheel.
+     */
+    uint64_t Now = CurrentTick();
+    if (Parked) {
+        TimerWheelAdvance(&Wheel, Now);
+    }
+
+    Timer->Callback = Callback;
+    Timer->Data = Data;
+    TimerWheelSchedule(&Wheel, Timer, Now + Ticks);
+
+    if (Parked) {
+        CFRunLoopTimerSetNextFireDate(RunLoopTimer, CFAbsoluteTimeGetCurrent() + (TIMER_TICK_MSEC / 1000.0));
+    }
+    pthread_mutex_unlock(&TimerLock);
+}
+
+void CancelTimer(timer *Timer)
+{
+    pthread_mutex_lock(&TimerLock);
+    TimerWheelCancel(&Wheel, Timer);
+    pthread_mutex_unlock(&TimerLock);
+}
+
+uint32_t BackoffDelay(backoff *Backoff, uint32_t Attempt)
+{
+    uint64_t Delay = Backoff->Base;
+    if (Backoff->Policy == Backoff_Exponential) {
+        Delay = Attempt < 32 ? Delay << Attempt : Backoff->Max;
+    }
+
+    return Delay < Backoff->Max ? (uint32_t) Delay : Backoff->Max;
+}
+
+bool BeginTimerHandler()
+{
+    if (pthread_mutex_init(&TimerLock, NULL) != 0) {
+        return false;
+    }
+
+    TimerWheelInit(&Wheel, CurrentTick());
+
+    CFAbsoluteTime Interval = TIMER_TICK_MSEC / 1000.0;
+    RunLoopTimer = CFRunLoopTimerCreate(NULL, CFAbsoluteTimeGetCurrent() + TIMER_PARKED,
+                                        Interval, 0, 0, TimerHandlerCallback, NULL);
+    if (!RunLoopTimer) {
+        pthread_mutex_destroy(&TimerLock);
+        return false;
+    }
+
+    CFRunLoopAddTimer(CFRunLoopGetMain(), RunLoopTimer, kCFRunLoopCommonModes);
+    return true;
+}
+
+bool EndTimerHandler()
+{
+    if (!RunLoopTimer) {
+        return false;
+    }
+
+    CFRunLoopTimerInvalidate(RunLoopTimer);
+    CFRelease(RunLoopTimer);
+    RunLoopTimer = NULL;
+
+    pthread_mutex_destroy(&TimerLock);
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef CHUNKWM_OSX_TIMER_H
+#define CHUNKWM_OSX_TIMER_H
+
+#include "../twheel.h"
+
+#define TIMER_TICK_MSEC 10
+
+enum backoff_policy
+{
+    Backoff_Fixed,
+    Backoff_Exponential,
+};
+
+// NOTE(koekeishiya): Delays are given in milliseconds.
+struct backoff
+{
+    backoff_policy Policy;
+    uint32_t Base;
+    uint32_t Max;
+};
+
+bool BeginTimerHandler();
+bool EndTimerHandler();
+
+void ScheduleTimer(timer *Timer, uint32_t Delay, timer_callback *Callback, void *Data);
+void CancelTimer(timer *Timer);
+uint32_t BackoffDelay(backoff *Backoff, uint32_t Attempt);
+
+#endif
@@ -0,0 +1,84 @@
+#include "histogram.h"
+
+#define internal static
+
+internal inline uint32_t
+HistogramBucketIndex(uint64_t Value)
+{
+    if (Value < HISTOGRAM_SUB_BUCKETS) {
+        return (uint32_t) Value;
+    }
+
+    uint32_t Exponent = 63 - __builtin_clzll(Value);
+    if (Exponent >= HISTOGRAM_MAX_EXPONENT) {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+
+    uint32_t Shift = Exponent - HISTOGRAM_SUB_BUCKET_BITS;
+    uint32_t SubBucket = (uint32_t) (Value >> Shift) - HISTOGRAM_SUB_BUCKETS;
+    return (Shift + 1) * HISTOGRAM_SUB_BUCKETS + SubBucket;
+}
+
+// NOTE(koekeishiya): Returns the midpoint of the range of values that map to the given bucket.
+internal inline uint64_t
+HistogramBucketValue(uint32_t Index)
+{
+    if (Index < HISTOGRAM_SUB_BUCKETS) {
+        return Index;
+    }
+
+    uint32_t Shift = (Index / HISTOGRAM_SUB_BUCKETS) - 1;
+    uint64_t SubBucket = (Index % HISTOGRAM_SUB_BUCKETS) + HISTOGRAM_SUB_BUCKETS;
+    uint64_t Lower = SubBucket << Shift;
+    uint64_t Width = 1ULL << Shift;
+    return Lower + Width / 2;
+}
+
+void HistogramRecord(histogram *Histogram, uint64_t Value)
+{
+    ++Histogram->Buckets[HistogramBucketIndex(Value)];
+    ++Histogram->Count;
+    Histogram->Total += Value;
+    if (Value > Histogram->Max) {
+        Histogram->Max = Value;
+    }
+}
+
+void HistogramRecordShared(histogram *Histogram, uint64_t Value)
+{
+    __atomic_add_fetch(&Histogram->Buckets[HistogramBucketIndex(Value)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&Histogram->Count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&Histogram->Total, Value, __ATOMIC_RELAXED);
+
+    uint64_t Max = __atomic_load_n(&Histogram->Max, __ATOMIC_RELAXED);
+    while ((Value > Max) &&
+           (!__atomic_compare_exchange_n(&Histogram->Max, &Max, Value, true,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED))) {
+    }
+}
+
+uint64_t HistogramPercentile(histogram *Histogram, double Percentile)
+{
+    uint64_t Count = 0;
+    for (uint32_t Index = 0; Index < HISTOGRAM_BUCKETS; ++Index) {
+        Count += Histogram->Buckets[Index];
+    }
+
+    if (Count == 0) {
+        return 0;
+    }
+
+    uint64_t Target = (uint64_t) (Percentile / 100.0 * Count + 0.5);
+    if (Target == 0) Target = 1;
+
+    uint64_t Seen = 0;
+    for (uint32_t Index = 0; Index < HISTOGRAM_BUCKETS; ++Index) {
+        Seen += Histogram->Buckets[Index];
+        if (Seen >= Target) {
+            uint64_t Value = HistogramBucketValue(Index);
+            return Value < Histogram->Max ? Value : Histogram->Max;
+        }
+    }
+
+    return Histogram->Max;
+}
@@ -0,0 +1,32 @@
+#ifndef CHUNKWM_CORE_HISTOGRAM_H
+#define CHUNKWM_CORE_HISTOGRAM_H
+
+#include <stdint.h>
+
+/*
+ * NOTE(koekeishiya): HDR-style log-linear histogram. Every power of two is split into
+ * HISTOGRAM_SUB_BUCKETS linear buckets, which bounds the relative error of a reported
+ * value to 1 / HISTOGRAM_SUB_BUCKETS. Values are unit-less; we record microseconds.
+ *
+ * Recording is a handful of instructions and never allocates. 'HistogramRecord' expects
+ * a single writer, 'HistogramRecordShared' may be called from any number of threads.
+ * Readers may observe a slightly stale copy.
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS   4
+#define HISTOGRAM_SUB_BUCKETS       (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_MAX_EXPONENT      36
+#define HISTOGRAM_BUCKETS           ((HISTOGRAM_MAX_EXPONENT - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+struct histogram
+{
+    uint64_t Count;
+    uint64_t Total;
+    uint64_t Max;
+    uint32_t Buckets[HISTOGRAM_BUCKETS];
+};
+
+void HistogramRecord(histogram *Histogram, uint64_t Value);
+void HistogramRecordShared(histogram *Histogram, uint64_t Value);
+uint64_t HistogramPercentile(histogram *Histogram, double Percentile);
+
+#endif
@@ -1,6 +1,7 @@
 #include "hotloader.h"
 
 #include "plugin.h"
+#include "config.h"
 #include "constants.h"
 #include "clog.h"
 
@@ -8,8 +9,6 @@
 #include <string.h>
 #include <vector>
 
-#include "../common/ipc/daemon.h"
-
 #define internal static
 
 #define HOTLOADER_CALLBACK(name) void name(ConstFSEventStreamRef Stream,\
@@ -23,15 +22,10 @@ internal hotloader Hotloader;
 internal std::vector<const char *> Directories;
 
 internal void
-PerformIOOperation(const char *Op, char *Filename)
+PerformIOOperation(core_command_type Type, char *Filename)
 {
-    int SockFD;
-    if (ConnectToDaemon(&SockFD, CHUNKWM_PORT)) {
-        char Message[256];
-        Message[0] = '\0';
-        snprintf(Message, sizeof(Message), "%s %s", Op, Filename);
-        WriteToSocket(Message, SockFD);
-        CloseSocket(SockFD);
+    if (!SubmitCoreCommand(Type, Filename)) {
+        c_log(C_LOG_LEVEL_WARN, "hotloader: could not submit command for plugin '%s'\n", Filename);
     }
 }
 
@@ -87,12 +81,12 @@ HOTLOADER_CALLBACK(HotloadPluginCallback)
             c_log(C_LOG_LEVEL_DEBUG, "hotloader: plugin '%s' changed!\n", Filename);
 
             c_log(C_LOG_LEVEL_DEBUG, "hotloader: unloading plugin '%s'\n", Filename);
-            PerformIOOperation("core::unload", Filename);
+            PerformIOOperation(Core_Command_UnloadPlugin, Filename);
 
             struct stat Buffer;
             if (stat(Absolutepath, &Buffer) == 0) {
                 c_log(C_LOG_LEVEL_DEBUG, "hotloader: loading plugin '%s'\n", Filename);
-                PerformIOOperation("core::load", Filename);
+                PerformIOOperation(Core_Command_LoadPlugin, Filename);
             }
         }
     }
@@ -1,5 +1,6 @@
 #include "plugin.h"
 #include "cvar.h"
+#include "statepage.h"
 #include "clog.h"
 
 #include <stdio.h>
@@ -19,7 +20,9 @@ internal pthread_mutex_t LoadedPluginLock;
 internal pthread_mutex_t Mutexes[chunkwm_export_count];
 internal plugin_list ExportedPlugins[chunkwm_export_count];
 
-internal chunkwm_api API = { UpdateCVarAPI,  AcquireCVarAPI, FindCVarAPI, ChunkwmBroadcast, (chunkwm_log*)c_log };
+internal chunkwm_api API = { UpdateCVarAPI,  AcquireCVarAPI, FindCVarAPI, ChunkwmBroadcast, (chunkwm_log*)c_log, StatePageSetDesktop,
+                             DeclareCVarAPI, AcquireCVarValueAPI, ResolveCVarAPI, AcquireCVarHandleValueAPI,
+                             WatchCVarAPI, AcquireCVarSnapshotAPI, AcquireCVarPrefixSnapshotAPI, CVarGenerationAPI };
 
 internal bool
 VerifyPluginABI(plugin_details *Info)
@@ -55,13 +58,13 @@ void EndPluginList(chunkwm_plugin_export Export)
 }
 
 internal void
-SubscribeToEvent(plugin *Plugin, chunkwm_plugin_export Export)
+SubscribeToEvent(loaded_plugin *LoadedPlugin, chunkwm_plugin_export Export)
 {
     plugin_list *List = BeginPluginList(Export);
 
-    plugin_list_iter It = List->find(Plugin);
+    plugin_list_iter It = List->find(LoadedPlugin->Plugin);
     if (It == List->end()) {
-       (*List)[Plugin] = true;
+       (*List)[LoadedPlugin->Plugin] = LoadedPlugin;
     }
 
     EndPluginList(Export);
@@ -91,7 +94,7 @@ HookPlugin(loaded_plugin *LoadedPlugin)
                   "Plugin '%s' subscribed to '%s'\n",
                   LoadedPlugin->Info->PluginName,
                   chunkwm_plugin_export_str[*Export]);
-            SubscribeToEvent(Plugin, *Export);
+            SubscribeToEvent(LoadedPlugin, *Export);
         }
     }
     Plugin->Run("chunkwm_events_subscribed", NULL);
@@ -147,26 +150,17 @@ IsPluginLoaded(const char *Filename)
     return Result;
 }
 
-plugin *GetPluginFromFilename(const char *Filename)
+// NOTE(koekeishiya): The caller must hold the lock acquired through 'BeginLoadedPluginList'.
+loaded_plugin *GetLoadedPluginFromFilename(const char *Filename)
 {
-    BeginLoadedPluginList();
-
     int Length = strlen(Filename) + 3 + 1;
     char FilenameWithExtension[Length];
     snprintf(FilenameWithExtension, Length, "%s.so", Filename);
 
-    plugin *Result;
-    if (LoadedPlugins.find(FilenameWithExtension) != LoadedPlugins.end()) {
-        Result = LoadedPlugins[FilenameWithExtension]->Plugin;
-    } else {
-        Result = NULL;
-    }
-
-    EndLoadedPluginList();
-    return Result;
+    loaded_plugin_list_iter It = LoadedPlugins.find(FilenameWithExtension);
+    return It != LoadedPlugins.end() ? It->second : NULL;
 }
 
-
 loaded_plugin_list *BeginLoadedPluginList()
 {
     pthread_mutex_lock(&LoadedPluginLock);
@@ -218,6 +212,11 @@ bool LoadPlugin(const char *Absolutepath, const char *Filename)
     LoadedPlugin->Plugin = Plugin;
     LoadedPlugin->Info = Info;
 
+    if (!BeginPluginQueue(&LoadedPlugin->Queue, Plugin, Info->PluginName)) {
+        c_log(C_LOG_LEVEL_ERROR, "chunkwm: plugin '%s' could not create queue!\n", Info->PluginName);
+        goto plugin_queue_err;
+    }
+
     if (!Plugin->Init(API)) {
         c_log(C_LOG_LEVEL_ERROR, "chunkwm: plugin '%s' init failed!\n", Info->PluginName);
         goto plugin_init_err;
@@ -230,6 +229,9 @@ bool LoadPlugin(const char *Absolutepath, const char *Filename)
     goto out;
 
 plugin_init_err:
+    EndPluginQueue(&LoadedPlugin->Queue);
+
+plugin_queue_err:
     free(LoadedPlugin);
 
 abi_err:
@@ -252,6 +254,13 @@ bool UnloadPlugin(const char *Absolutepath, const char *Filename)
     if (LoadedPlugin && LoadedPlugin->Handle) {
         UnhookPlugin(LoadedPlugin);
 
+        /*
+         * NOTE(koekeishiya): The plugin no longer receives new events, but it may still
+         * be working through its queue. Let it finish before we unload the library.
+         */
+        EndPluginQueue(&LoadedPlugin->Queue);
+        UnwatchCVars(LoadedPlugin->Info->PluginName);
+
         plugin *Plugin = LoadedPlugin->Plugin;
         Plugin->DeInit();
 
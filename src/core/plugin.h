@@ -3,6 +3,7 @@
 
 #include "../api/plugin_api.h"
 #include "../common/misc/string.h"
+#include "pqueue.h"
 
 #include <map>
 
@@ -12,9 +13,10 @@ struct loaded_plugin
     void *Handle;
     plugin *Plugin;
     plugin_details *Info;
+    plugin_queue Queue;
 };
 
-typedef std::map<plugin *, bool>  plugin_list;
+typedef std::map<plugin *, loaded_plugin *>  plugin_list;
 typedef plugin_list::iterator plugin_list_iter;
 
 bool BeginPlugins();
@@ -31,6 +33,6 @@ typedef loaded_plugin_list::iterator loaded_plugin_list_iter;
 loaded_plugin_list *BeginLoadedPluginList();
 void EndLoadedPluginList();
 
-plugin *GetPluginFromFilename(const char *Filename);
+loaded_plugin *GetLoadedPluginFromFilename(const char *Filename);
 
 #endif
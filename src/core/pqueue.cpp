@@ -0,0 +1,234 @@
+#include "pqueue.h"
+#include "clog.h"
+#include "clock.h"
+#include "constants.h"
+#include "../api/plugin_api.h"
+#include "../common/config/cvar.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define internal static
+
+// NOTE(koekeishiya): Number of entries a plugin may process before yielding its worker.
+#define PLUGIN_QUEUE_BATCH 32
+
+plugin_payload *BeginPluginPayload(void *Data, plugin_payload_release *Release, void *Context)
+{
+    plugin_payload *Payload = (plugin_payload *) malloc(sizeof(plugin_payload));
+    Payload->References = 1;
+    Payload->Failed = false;
+    Payload->Data = Data;
+    Payload->Context = Context;
+    Payload->Release = Release;
+    Payload->Latency = NULL;
+    Payload->Start = 0;
+    return Payload;
+}
+
+void RetainPluginPayload(plugin_payload *Payload)
+{
+    __atomic_add_fetch(&Payload->References, 1, __ATOMIC_RELAXED);
+}
+
+void ReleasePluginPayload(plugin_payload *Payload)
+{
+    if (__atomic_sub_fetch(&Payload->References, 1, __ATOMIC_ACQ_REL) == 0) {
+        if (Payload->Release) {
+            Payload->Release(Payload->Data, Payload->Context, Payload->Failed);
+        }
+
+        if (Payload->Latency) {
+            HistogramRecordShared(Payload->Latency, (GetMonotonicTime() - Payload->Start) / NSEC_PER_USEC);
+        }
+
+        free(Payload);
+    }
+}
+
+/*
+ * NOTE(koekeishiya): Run the plugin and account for the time it took. This is only ever
+ * called by one thread at a time for a given queue, but the profile may be read while
+ * we are running, so it is updated under the lock.
+ */
+bool PluginQueueRun(plugin_queue *Queue, const char *Export, void *Data)
+{
+    uint64_t WallStart = GetMonotonicTime();
+    uint64_t CPUStart = GetThreadCPUTime();
+
+    bool Result = Queue->Plugin->Run(Export, Data);
+
+    uint64_t Wall = (GetMonotonicTime() - WallStart) / NSEC_PER_USEC;
+    uint64_t CPU = (GetThreadCPUTime() - CPUStart) / NSEC_PER_USEC;
+    bool OverBudget = Queue->Budget && Wall > Queue->Budget * 1000ULL;
+
+    pthread_mutex_lock(&Queue->Lock);
+    plugin_profile *Profile;
+    plugin_profile_map_iter It = Queue->Profile->find(Export);
+    if (It != Queue->Profile->end()) {
+        Profile = It->second;
+    } else {
+        Profile = (plugin_profile *) calloc(1, sizeof(plugin_profile));
+        (*Queue->Profile)[strdup(Export)] = Profile;
+    }
+
+    ++Profile->Count;
+    Profile->WallTotal += Wall;
+    Profile->CPUTotal += CPU;
+    HistogramRecord(&Profile->Wall, Wall);
+    HistogramRecord(&Profile->CPU, CPU);
+
+    if (OverBudget) {
+        ++Profile->OverBudget;
+        ++Queue->OverBudget;
+    }
+    pthread_mutex_unlock(&Queue->Lock);
+
+    if (OverBudget) {
+        c_log(C_LOG_LEVEL_WARN, "chunkwm: plugin '%s' spent %.1fms (cpu %.1fms) on '%s'; budget is %ums\n",
+              Queue->Name, Wall / 1000.0, CPU / 1000.0, Export, Queue->Budget);
+    }
+
+    return Result;
+}
+
+/*
+ * NOTE(koekeishiya): Only one drain task is scheduled per plugin at any time. After a
+ * batch of entries the task is re-queued, so that a busy plugin cannot hold on to a
+ * worker thread while other plugins are waiting.
+ */
+internal
+WORK_QUEUE_CALLBACK(DrainPluginQueue)
+{
+    plugin_queue *Queue = (plugin_queue *) Data;
+
+    int Budget = CVarIntegerValue(CVAR_PLUGIN_BUDGET);
+    Queue->Budget = Budget > 0 ? Budget : 0;
+
+    for (int Count = 0; Count < PLUGIN_QUEUE_BATCH; ++Count) {
+        pthread_mutex_lock(&Queue->Lock);
+        if (Queue->Entries->empty()) {
+            Queue->Scheduled = false;
+            pthread_cond_broadcast(&Queue->Drained);
+            pthread_mutex_unlock(&Queue->Lock);
+            return;
+        }
+
+        plugin_queue_entry Entry = Queue->Entries->front();
+        Queue->Entries->pop();
+        pthread_mutex_unlock(&Queue->Lock);
+
+        if (Entry.Export) {
+            bool Result = PluginQueueRun(Queue, Entry.Export, Entry.Payload ? Entry.Payload->Data : NULL);
+            if (!Result && Entry.Payload) {
+                Entry.Payload->Failed = true;
+            }
+        }
+        if (Entry.Payload) {
+            ReleasePluginPayload(Entry.Payload);
+        }
+
+        pthread_mutex_lock(&Queue->Lock);
+        --Queue->Depth;
+        ++Queue->Processed;
+        pthread_mutex_unlock(&Queue->Lock);
+    }
+
+    AddWorkQueueEntry(Queue->WorkQueue, DrainPluginQueue, Queue);
+}
+
+void PluginQueueAdd(work_queue *WorkQueue, plugin_queue *Queue, const char *Export, plugin_payload *Payload)
+{
+    if (Payload) {
+        RetainPluginPayload(Payload);
+    }
+
+    pthread_mutex_lock(&Queue->Lock);
+    Queue->Entries->push({ Export, Payload });
+    if (++Queue->Depth > Queue->MaxDepth) {
+        Queue->MaxDepth = Queue->Depth;
+    }
+
+    bool Schedule = !Queue->Scheduled;
+    if (Schedule) {
+        Queue->Scheduled = true;
+        Queue->WorkQueue = WorkQueue;
+    }
+    pthread_mutex_unlock(&Queue->Lock);
+
+    if (Schedule) {
+        AddWorkQueueEntry(WorkQueue, DrainPluginQueue, Queue);
+    }
+}
+
+// NOTE(koekeishiya): Block until every queued entry has been processed by the plugin.
+void PluginQueueWait(plugin_queue *Queue)
+{
+    pthread_mutex_lock(&Queue->Lock);
+    while (Queue->Scheduled) {
+        pthread_cond_wait(&Queue->Drained, &Queue->Lock);
+    }
+    pthread_mutex_unlock(&Queue->Lock);
+}
+
+void PluginQueueStats(plugin_queue *Queue, plugin_queue_stats *Stats)
+{
+    pthread_mutex_lock(&Queue->Lock);
+    Stats->Depth = Queue->Depth;
+    Stats->MaxDepth = Queue->MaxDepth;
+    Stats->Processed = Queue->Processed;
+    pthread_mutex_unlock(&Queue->Lock);
+}
+
+plugin_profile_map *BeginPluginProfile(plugin_queue *Queue)
+{
+    pthread_mutex_lock(&Queue->Lock);
+    return Queue->Profile;
+}
+
+void EndPluginProfile(plugin_queue *Queue)
+{
+    pthread_mutex_unlock(&Queue->Lock);
+}
+
+bool BeginPluginQueue(plugin_queue *Queue, plugin *Plugin, const char *Name)
+{
+    if (pthread_mutex_init(&Queue->Lock, NULL) != 0) {
+        return false;
+    }
+
+    if (pthread_cond_init(&Queue->Drained, NULL) != 0) {
+        pthread_mutex_destroy(&Queue->Lock);
+        return false;
+    }
+
+    Queue->Entries = new std::queue<plugin_queue_entry>;
+    Queue->Profile = new plugin_profile_map;
+    Queue->Plugin = Plugin;
+    Queue->Name = Name;
+    Queue->WorkQueue = NULL;
+    Queue->Scheduled = false;
+    Queue->Depth = 0;
+    Queue->MaxDepth = 0;
+    Queue->Processed = 0;
+    Queue->Budget = 0;
+    Queue->OverBudget = 0;
+    return true;
+}
+
+void EndPluginQueue(plugin_queue *Queue)
+{
+    PluginQueueWait(Queue);
+
+    for (plugin_profile_map_iter It = Queue->Profile->begin();
+         It != Queue->Profile->end();
+         ++It) {
+        free((char *) It->first);
+        free(It->second);
+    }
+
+    delete Queue->Profile;
+    delete Queue->Entries;
+    pthread_cond_destroy(&Queue->Drained);
+    pthread_mutex_destroy(&Queue->Lock);
+}
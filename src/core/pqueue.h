@@ -0,0 +1,111 @@
+#ifndef CHUNKWM_CORE_PQUEUE_H
+#define CHUNKWM_CORE_PQUEUE_H
+
+#include "wqueue.h"
+#include "histogram.h"
+#include "../common/misc/string.h"
+
+#include <stdint.h>
+#include <pthread.h>
+#include <queue>
+#include <map>
+
+struct plugin;
+
+/*
+ * NOTE(koekeishiya): A payload is shared by every plugin that receives the same event.
+ * The core holds a reference while it queues the event, and every queued entry holds one.
+ * When the last reference is dropped, the release function is called, which is where the
+ * core destroys windows, applications and other data that plugins may still be reading.
+ * Failed is set if any plugin that was run with the payload returned false.
+ *
+ * If 'Latency' is set, the time from 'Start' until the last reference is dropped is
+ * recorded to it, in microseconds.
+ */
+#define PLUGIN_PAYLOAD_RELEASE(name) void name(void *Data, void *Context, bool Failed)
+typedef PLUGIN_PAYLOAD_RELEASE(plugin_payload_release);
+
+struct plugin_payload
+{
+    uint32_t volatile References;
+    bool volatile Failed;
+    void *Data;
+    void *Context;
+    plugin_payload_release *Release;
+    histogram *Latency;
+    uint64_t Start;
+};
+
+#define PLUGIN_BUDGET_DEFAULT 50
+
+// NOTE(koekeishiya): An entry without an export only holds a reference to its payload.
+struct plugin_queue_entry
+{
+    const char *Export;
+    plugin_payload *Payload;
+};
+
+/*
+ * NOTE(koekeishiya): Runtime accounting for one export of a plugin. Times are recorded
+ * in microseconds. A run is over budget if its wall time exceeds 'plugin_budget'.
+ */
+struct plugin_profile
+{
+    uint64_t Count;
+    uint64_t OverBudget;
+    uint64_t WallTotal;
+    uint64_t CPUTotal;
+    histogram Wall;
+    histogram CPU;
+};
+
+typedef std::map<const char *, plugin_profile *, string_comparator> plugin_profile_map;
+typedef plugin_profile_map::iterator plugin_profile_map_iter;
+
+/*
+ * NOTE(koekeishiya): Every plugin has its own serial queue. Events reach a plugin in the
+ * order they were queued, and a plugin is never run on more than one thread at a time,
+ * but plugins make progress independently of each other.
+ */
+struct plugin_queue
+{
+    pthread_mutex_t Lock;
+    pthread_cond_t Drained;
+    std::queue<plugin_queue_entry> *Entries;
+    plugin *Plugin;
+    const char *Name;
+    work_queue *WorkQueue;
+    bool Scheduled;
+
+    uint32_t Budget;
+    uint64_t OverBudget;
+    plugin_profile_map *Profile;
+
+    uint32_t Depth;
+    uint32_t MaxDepth;
+    uint64_t Processed;
+};
+
+struct plugin_queue_stats
+{
+    uint32_t Depth;
+    uint32_t MaxDepth;
+    uint64_t Processed;
+};
+
+plugin_payload *BeginPluginPayload(void *Data, plugin_payload_release *Release, void *Context);
+void RetainPluginPayload(plugin_payload *Payload);
+void ReleasePluginPayload(plugin_payload *Payload);
+
+bool BeginPluginQueue(plugin_queue *Queue, plugin *Plugin, const char *Name);
+void EndPluginQueue(plugin_queue *Queue);
+
+void PluginQueueAdd(work_queue *WorkQueue, plugin_queue *Queue, const char *Export, plugin_payload *Payload);
+void PluginQueueWait(plugin_queue *Queue);
+void PluginQueueStats(plugin_queue *Queue, plugin_queue_stats *Stats);
+bool PluginQueueRun(plugin_queue *Queue, const char *Export, void *Data);
+
+plugin_profile_map *BeginPluginProfile(plugin_queue *Queue);
+void EndPluginProfile(plugin_queue *Queue);
+
+#endif
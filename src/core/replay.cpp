@@ -0,0 +1,100 @@
+#include "trace.h"
+#include "clog.h"
+#include "clock.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define internal static
+
+/*
+ * NOTE(koekeishiya): The pace of a replay is relative to the first record of the current
+ * session. A session marker, or a timestamp that goes backwards in a trace recorded before
+ * we wrote session markers, starts a new session, so that a trace that was appended to
+ * across restarts does not stall the replay.
+ */
+struct trace_replay_clock
+{
+    bool Valid;
+    uint64_t Base;
+    uint64_t Start;
+    uint64_t Last;
+};
+
+internal inline void
+ResetTraceReplayClock(trace_replay_clock *Clock, uint64_t Timestamp)
+{
+    Clock->Valid = true;
+    Clock->Base = Timestamp;
+    Clock->Start = GetMonotonicTime();
+    Clock->Last = Timestamp;
+}
+
+internal void
+WaitForTraceRecord(trace_replay_clock *Clock, uint64_t Timestamp)
+{
+    uint64_t Offset = Timestamp - Clock->Base;
+    uint64_t Elapsed = GetMonotonicTime() - Clock->Start;
+    if (Offset > Elapsed) {
+        usleep((Offset - Elapsed) / NSEC_PER_USEC);
+    }
+}
+
+bool ReplayTraceFile(const char *Path, bool Realtime,
+                     trace_replay_backend *Backend, void *Context,
+                     trace_replay_result *Result)
+{
+    trace_header Header;
+    trace_record Record;
+    trace_replay_clock Clock = {};
+    bool Success = false;
+
+    memset(Result, 0, sizeof(trace_replay_result));
+
+    FILE *Handle = fopen(Path, "rb");
+    if (!Handle) {
+        c_log(C_LOG_LEVEL_WARN, "chunkwm: could not open trace '%s'\n", Path);
+        goto out;
+    }
+
+    if ((fread(&Header, sizeof(trace_header), 1, Handle) != 1) ||
+        (Header.Magic != TRACE_MAGIC) ||
+        (Header.Version != TRACE_VERSION) ||
+        (Header.RecordSize != sizeof(trace_record))) {
+        c_log(C_LOG_LEVEL_WARN, "chunkwm: '%s' is not a valid trace\n", Path);
+        goto close;
+    }
+
+    while (fread(&Record, sizeof(trace_record), 1, Handle) == 1) {
+        if (Record.Type == TRACE_SESSION) {
+            ResetTraceReplayClock(&Clock, Record.Timestamp);
+            ++Result->Sessions;
+            continue;
+        }
+
+        if ((!Clock.Valid) || (Record.Timestamp < Clock.Last)) {
+            ResetTraceReplayClock(&Clock, Record.Timestamp);
+            ++Result->Sessions;
+        }
+
+        if (Realtime) {
+            WaitForTraceRecord(&Clock, Record.Timestamp);
+        }
+        Clock.Last = Record.Timestamp;
+
+        if (Backend(&Record, Context)) {
+            ++Result->Replayed;
+        } else {
+            ++Result->Skipped;
+        }
+    }
+
+    Success = true;
+
+close:
+    fclose(Handle);
+
+out:
+    return Success;
+}
@@ -1,6 +1,7 @@
 #include "state.h"
 
 #include "dispatch/event.h"
+#include "dispatch/timer.h"
 #include "clog.h"
 
 #include "../common/accessibility/application.h"
@@ -31,8 +32,7 @@ internal pthread_mutex_t WindowsLock;
  * There is no way to do this, without caching AXUIElementRef references.
  * Here we perform a lookup of macos_window structs.
  */
-internal macos_window *
-GetWindowByID(uint32_t Id)
+macos_window *GetWindowByID(uint32_t Id)
 {
     pthread_mutex_lock(&WindowsLock);
     macos_window_map_it It = Windows.find(Id);
@@ -94,13 +94,12 @@ void RemoveWindowFromCollection(macos_window *Window)
 }
 
 // NOTE(koekeishiya): Caller is responsible for passing a valid window!
-void UpdateWindowTitle(macos_window *Window)
+// NOTE(koekeishiya): Returns the previous title, which the caller is responsible for freeing.
+char *UpdateWindowTitle(macos_window *Window)
 {
-    if (Window->Name) {
-        free(Window->Name);
-    }
-
+    char *PreviousTitle = Window->Name;
     Window->Name = AXLibGetWindowTitle(Window->Ref);
+    return PreviousTitle;
 }
 
 /*
@@ -254,64 +253,86 @@ OBSERVER_CALLBACK(ApplicationCallback)
     }
 }
 
-#define OBSERVER_RETRIES 20
-#define OBSERVER_DELAY 0.1f
-#define MICROSEC_PER_SEC 1e6
-internal void
-ConstructAndAddApplicationDispatch(macos_application *Application, carbon_application_details *Info, float Delay)
+/*
+ * NOTE(koekeishiya): Applications are often not ready to accept observers right after
+ * launch. We retry with an exponential backoff, so that most applications are registered
+ * within a few hundred milliseconds, while slow applications are still given ~4 seconds.
+ */
+#define OBSERVER_RETRIES 12
+internal backoff ObserverBackoff = { Backoff_Exponential, 25, 400 };
+
+struct application_registration
 {
-    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, Delay * NSEC_PER_SEC), dispatch_get_main_queue(),
-    ^{
-        if (Info->State == Carbon_Application_State_In_Progress) {
-            bool Success = AXLibAddApplicationObserver(Application, ApplicationCallback);
-            if (Success) {
-                c_log(C_LOG_LEVEL_DEBUG, "%d:%s successfully registered window notifications\n", Application->PID, Application->Name);
-                Info->State = Carbon_Application_State_Finished;
-                AddApplication(Application);
-                AddApplicationWindowsToCollection(Application);
-                ConstructEvent(ChunkWM_ApplicationLaunched, Info);
-            } else {
-                if (Application->Observer.Valid) {
-                    AXLibDestroyObserver(&Application->Observer);
-                }
+    timer Timer;
+    macos_application *Application;
+    carbon_application_details *Info;
+};
 
-                if (++Info->Attempts > OBSERVER_RETRIES) {
-                    if (Info->State != Carbon_Application_State_Invalid) {
-                        Info->State = Carbon_Application_State_Failed;
-                    }
-                }
+internal
+TIMER_CALLBACK(ApplicationRegistrationCallback)
+{
+    application_registration *Registration = (application_registration *) Data;
+    macos_application *Application = Registration->Application;
+    carbon_application_details *Info = Registration->Info;
+
+    if (Info->State == Carbon_Application_State_In_Progress) {
+        bool Success = AXLibAddApplicationObserver(Application, ApplicationCallback);
+        if (Success) {
+            c_log(C_LOG_LEVEL_DEBUG, "%d:%s successfully registered window notifications\n", Application->PID, Application->Name);
+            Info->State = Carbon_Application_State_Finished;
+            AddApplication(Application);
+            AddApplicationWindowsToCollection(Application);
+            ConstructEvent(ChunkWM_ApplicationLaunched, Info);
+            free(Registration);
+        } else {
+            if (Application->Observer.Valid) {
+                AXLibDestroyObserver(&Application->Observer);
+            }
 
-                ConstructAndAddApplicationDispatch(Application, Info, OBSERVER_DELAY);
+            uint32_t Delay = BackoffDelay(&ObserverBackoff, Info->Attempts);
+            if (++Info->Attempts > OBSERVER_RETRIES) {
+                if (Info->State != Carbon_Application_State_Invalid) {
+                    Info->State = Carbon_Application_State_Failed;
+                }
+                Delay = 0;
             }
-        } else if (Info->State == Carbon_Application_State_Failed) {
-            c_log(C_LOG_LEVEL_WARN, "%d:%s could not register window notifications!!!\n", Application->PID, Application->Name);
-            AXLibDestroyApplication(Application);
-        } else if (Info->State == Carbon_Application_State_Invalid) {
-            c_log(C_LOG_LEVEL_DEBUG, "%d:%s process terminated; cancel registration of window notifications!!!\n", Application->PID, Application->Name);
-            AXLibDestroyApplication(Application);
-            ConstructEvent(ChunkWM_ApplicationTerminated, Info);
+
+            ScheduleTimer(&Registration->Timer, Delay, ApplicationRegistrationCallback, Registration);
         }
-    });
+    } else if (Info->State == Carbon_Application_State_Failed) {
+        c_log(C_LOG_LEVEL_WARN, "%d:%s could not register window notifications!!!\n", Application->PID, Application->Name);
+        AXLibDestroyApplication(Application);
+        free(Registration);
+    } else if (Info->State == Carbon_Application_State_Invalid) {
+        c_log(C_LOG_LEVEL_DEBUG, "%d:%s process terminated; cancel registration of window notifications!!!\n", Application->PID, Application->Name);
+        AXLibDestroyApplication(Application);
+        ConstructEvent(ChunkWM_ApplicationTerminated, Info);
+        free(Registration);
+    }
 }
 
 void ConstructAndAddApplication(carbon_application_details *Info)
 {
-    macos_application *Application = AXLibConstructApplication(Info->PSN, Info->PID, Info->ProcessName);
+    application_registration *Registration = (application_registration *) calloc(1, sizeof(application_registration));
+    Registration->Application = AXLibConstructApplication(Info->PSN, Info->PID, Info->ProcessName);
+    Registration->Info = Info;
 
     Info->State = Carbon_Application_State_In_Progress;
     Info->Attempts = 0;
 
-    ConstructAndAddApplicationDispatch(Application, Info, 0.0f);
+    ScheduleTimer(&Registration->Timer, 0, ApplicationRegistrationCallback, Registration);
 }
 
-void RemoveAndDestroyApplication(macos_application *Application)
+/*
+ * NOTE(koekeishiya): The application is only removed from our collection. It is destroyed
+ * once every plugin has processed the 'chunkwm_export_application_terminated' event.
+ */
+void RemoveApplication(macos_application *Application)
 {
     macos_application_map_it It = Applications.find(Application->PID);
     if (It != Applications.end()) {
         Applications.erase(It);
     }
-
-    AXLibDestroyApplication(Application);
 }
 
 void UpdateWindowCollection()
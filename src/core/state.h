@@ -4,16 +4,17 @@
 #include <Carbon/Carbon.h>
 
 struct macos_window;
+macos_window *GetWindowByID(uint32_t Id);
 bool AddWindowToCollection(macos_window *Window);
 void RemoveWindowFromCollection(macos_window *Window);
 void UpdateWindowCollection();
 
-void UpdateWindowTitle(macos_window *Window);
+char *UpdateWindowTitle(macos_window *Window);
 
 struct macos_application;
 macos_application *GetApplicationFromPID(pid_t PID);
 void ConstructAndAddApplication(carbon_application_details *Info);
-void RemoveAndDestroyApplication(macos_application *Application);
+void RemoveApplication(macos_application *Application);
 
 bool InitState();
 
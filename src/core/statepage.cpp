@@ -0,0 +1,240 @@
+#include "statepage.h"
+#include "../common/ipc/statepage.h"
+#include "../common/accessibility/window.h"
+#include "../common/accessibility/application.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "clog.h"
+
+#define internal static
+
+// NOTE(koekeishiya): macOS limits the name of a shared-memory object to 31 characters.
+#define STATE_PAGE_NAME_MAX 32
+
+/*
+ * NOTE(koekeishiya): The page is updated from the event-loop thread and, through the
+ * plugin API, from plugin threads. Writers are serialized by StatePageLock; readers
+ * never take it, and only ever look at Sequence to know if their copy is consistent.
+ */
+internal pthread_mutex_t StatePageLock;
+internal state_page *Page;
+
+internal inline void
+CopyField(char *Field, size_t Size, const char *Value)
+{
+    strncpy(Field, Value ? Value : "", Size - 1);
+    Field[Size - 1] = '\0';
+}
+
+internal bool
+BeginStatePageWrite()
+{
+    if (!Page) {
+        return false;
+    }
+
+    pthread_mutex_lock(&StatePageLock);
+    __atomic_store_n(&Page->Sequence, Page->Sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return true;
+}
+
+internal void
+EndStatePageWrite()
+{
+    __atomic_store_n(&Page->Sequence, Page->Sequence + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&StatePageLock);
+}
+
+/*
+ * NOTE(koekeishiya): The name of the object is predictable, so another user could create it
+ * before we do, and read or forge everything that we publish. We only ever use an object that
+ * we created exclusively, or one that is owned by us and not accessible to anyone else.
+ */
+internal bool
+IsPrivateStatePage(int FD, struct stat *Buffer)
+{
+    bool Result = ((fstat(FD, Buffer) == 0) &&
+                   (Buffer->st_uid == geteuid()) &&
+                   ((Buffer->st_mode & (S_IRWXG | S_IRWXO)) == 0));
+    return Result;
+}
+
+internal int
+CreateStatePage(const char *Name)
+{
+    int FD = shm_open(Name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (FD == -1) {
+        return -1;
+    }
+
+    if (ftruncate(FD, sizeof(state_page)) == -1) {
+        close(FD);
+        shm_unlink(Name);
+        return -1;
+    }
+
+    return FD;
+}
+
+/*
+ * NOTE(koekeishiya): The object is not unlinked when chunkwm exits, so that readers keep
+ * a valid mapping across restarts. An object left behind by a different version is
+ * replaced, as macOS does not allow an existing object to be resized.
+ */
+internal int
+OpenStatePage(const char *Name)
+{
+    int FD = CreateStatePage(Name);
+    if ((FD != -1) || (errno != EEXIST)) {
+        return FD;
+    }
+
+    FD = shm_open(Name, O_RDWR, 0);
+    if (FD == -1) {
+        return -1;
+    }
+
+    struct stat Buffer;
+    if (!IsPrivateStatePage(FD, &Buffer)) {
+        c_log(C_LOG_LEVEL_WARN, "chunkwm: shared memory '%s' is not private to us, refusing to use it\n", Name);
+        close(FD);
+        return -1;
+    }
+
+    if (Buffer.st_size == sizeof(state_page)) {
+        return FD;
+    }
+
+    close(FD);
+    shm_unlink(Name);
+    return CreateStatePage(Name);
+}
+
+bool BeginStatePage()
+{
+    const char *User = getenv("USER");
+    if (!User) {
+        return false;
+    }
+
+    char Name[STATE_PAGE_NAME_MAX];
+    if (snprintf(Name, sizeof(Name), STATE_PAGE_NAME_FMT, User) >= (int) sizeof(Name)) {
+        return false;
+    }
+
+    if (pthread_mutex_init(&StatePageLock, NULL) != 0) {
+        return false;
+    }
+
+    int FD = OpenStatePage(Name);
+    if (FD == -1) {
+        return false;
+    }
+
+    void *Memory = mmap(NULL, sizeof(state_page), PROT_READ | PROT_WRITE, MAP_SHARED, FD, 0);
+    close(FD);
+
+    if (Memory == MAP_FAILED) {
+        return false;
+    }
+
+    /*
+     * NOTE(koekeishiya): A previous instance may have died in the middle of an update,
+     * leaving Sequence odd; make sure that our first update leaves it even again.
+     */
+    Page = (state_page *) Memory;
+    Page->Sequence &= ~1u;
+
+    BeginStatePageWrite();
+    uint32_t Sequence = Page->Sequence;
+    memset(Page, 0, sizeof(state_page));
+    Page->Magic = STATE_PAGE_MAGIC;
+    Page->Version = STATE_PAGE_VERSION;
+    Page->Size = sizeof(state_page);
+    Page->Sequence = Sequence;
+    EndStatePageWrite();
+
+    c_log(C_LOG_LEVEL_DEBUG, "chunkwm: publishing state in shared memory '%s'\n", Name);
+    return true;
+}
+
+void StatePageSetFocus(macos_window *Window)
+{
+    if (BeginStatePageWrite()) {
+        Page->FocusedWindow = Window->Id;
+        Page->FocusedPID = Window->Owner->PID;
+        CopyField(Page->FocusedOwner, sizeof(Page->FocusedOwner), Window->Owner->Name);
+        CopyField(Page->FocusedName, sizeof(Page->FocusedName), Window->Name);
+        EndStatePageWrite();
+    }
+}
+
+/*
+ * NOTE(koekeishiya): The focused window is only ever changed from the event-loop thread,
+ * which is also the only caller of the following functions, so it can be checked before
+ * we start an update that readers would otherwise have to retry for nothing.
+ */
+void StatePageClearFocus(uint32_t WindowId)
+{
+    if (Page && Page->FocusedWindow != WindowId) {
+        return;
+    }
+
+    if (BeginStatePageWrite()) {
+        Page->FocusedWindow = 0;
+        Page->FocusedPID = 0;
+        Page->FocusedOwner[0] = '\0';
+        Page->FocusedName[0] = '\0';
+        EndStatePageWrite();
+    }
+}
+
+void StatePageUpdateTitle(macos_window *Window)
+{
+    if (Page && Page->FocusedWindow != Window->Id) {
+        return;
+    }
+
+    if (BeginStatePageWrite()) {
+        CopyField(Page->FocusedName, sizeof(Page->FocusedName), Window->Name);
+        EndStatePageWrite();
+    }
+}
+
+void StatePageSetActiveDesktop(unsigned DesktopId, unsigned MonitorId)
+{
+    if (BeginStatePageWrite()) {
+        Page->ActiveDesktop = DesktopId;
+        Page->ActiveMonitor = MonitorId;
+        EndStatePageWrite();
+    }
+}
+
+CHUNKWM_API_PUBLISH_DESKTOP_FUNC(StatePageSetDesktop)
+{
+    if ((DesktopId == 0) || (DesktopId > STATE_PAGE_MAX_DESKTOPS)) {
+        return;
+    }
+
+    if (BeginStatePageWrite()) {
+        state_page_desktop *Desktop = &Page->Desktops[DesktopId - 1];
+        Desktop->Monitor = MonitorId;
+        Desktop->WindowCount = WindowCount;
+        CopyField(Desktop->Mode, sizeof(Desktop->Mode), Mode);
+
+        if (Page->DesktopCount < DesktopId) {
+            Page->DesktopCount = DesktopId;
+        }
+        EndStatePageWrite();
+    }
+}
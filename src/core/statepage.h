@@ -0,0 +1,17 @@
+#ifndef CHUNKWM_CORE_STATEPAGE_H
+#define CHUNKWM_CORE_STATEPAGE_H
+
+#include "../api/plugin_cvar.h"
+#include <stdint.h>
+
+struct macos_window;
+
+bool BeginStatePage();
+
+void StatePageSetFocus(macos_window *Window);
+void StatePageClearFocus(uint32_t WindowId);
+void StatePageUpdateTitle(macos_window *Window);
+void StatePageSetActiveDesktop(unsigned DesktopId, unsigned MonitorId);
+CHUNKWM_API_PUBLISH_DESKTOP_FUNC(StatePageSetDesktop);
+
+#endif
@@ -0,0 +1,275 @@
+#include "subscription.h"
+#include "dispatch/timer.h"
+
+#include "../common/ipc/daemon.h"
+#include "../common/config/tokenize.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include <deque>
+#include <vector>
+
+#include "clog.h"
+
+#define internal static
+
+#define SUBSCRIPTION_RECORD_SIZE 512
+
+struct subscription_record
+{
+    const char *Name;
+    char *Text;
+    size_t Length;
+};
+
+struct subscriber
+{
+    int SockFD;
+    uint32_t Topics;
+    uint32_t Dropped;
+    bool Closed;
+
+    // NOTE(koekeishiya): Number of bytes of the first pending record that have already been sent.
+    size_t Offset;
+    std::deque<subscription_record> *Pending;
+};
+
+/*
+ * NOTE(koekeishiya): Events are published from the event-loop thread, subscribers are added
+ * from the daemon, and the flush timer runs on the main thread. Sockets are non-blocking, so
+ * a subscriber never holds up the event-loop; whatever could not be sent is retried by the
+ * flush timer. The topics that anyone subscribes to are kept in a mask that is read without
+ * taking the lock, so that publishing an event without subscribers costs close to nothing.
+ */
+internal pthread_mutex_t SubscriptionLock;
+internal std::vector<subscriber *> Subscribers;
+internal uint32_t volatile SubscribedTopics;
+internal timer FlushTimer;
+internal bool FlushScheduled;
+
+internal subscription_record
+CreateRecord(const char *Name, const char *Text, size_t Length)
+{
+    subscription_record Record;
+    Record.Name = Name;
+    Record.Text = (char *) malloc(Length);
+    Record.Length = Length;
+    memcpy(Record.Text, Text, Length);
+    return Record;
+}
+
+internal void
+DestroySubscriber(subscriber *Subscriber)
+{
+    for (size_t Index = 0; Index < Subscriber->Pending->size(); ++Index) {
+        free((*Subscriber->Pending)[Index].Text);
+    }
+
+    CloseSocket(Subscriber->SockFD);
+    delete Subscriber->Pending;
+    free(Subscriber);
+}
+
+/*
+ * NOTE(koekeishiya): The first pending record may have been partially sent, and is therefore
+ * never replaced. Events that describe state (focus, desktop) can safely replace an older one
+ * of the same kind; anything else has to be dropped.
+ */
+internal void
+EnqueueRecord(subscriber *Subscriber, const char *Name, bool Coalesce, const char *Text, size_t Length)
+{
+    std::deque<subscription_record> *Pending = Subscriber->Pending;
+
+    if (Pending->size() + (Subscriber->Dropped ? 1 : 0) < SUBSCRIPTION_MAX_PENDING) {
+        if (Subscriber->Dropped) {
+            char Buffer[64];
+            int DroppedLength = snprintf(Buffer, sizeof(Buffer), "dropped %u\n", Subscriber->Dropped);
+            Pending->push_back(CreateRecord("dropped", Buffer, DroppedLength));
+            Subscriber->Dropped = 0;
+        }
+
+        Pending->push_back(CreateRecord(Name, Text, Length));
+        return;
+    }
+
+    if (Coalesce) {
+        size_t First = Subscriber->Offset ? 1 : 0;
+        for (size_t Index = Pending->size(); Index > First; --Index) {
+            subscription_record *Record = &(*Pending)[Index - 1];
+            if (strcmp(Record->Name, Name) == 0) {
+                free(Record->Text);
+                *Record = CreateRecord(Name, Text, Length);
+                return;
+            }
+        }
+    }
+
+    ++Subscriber->Dropped;
+}
+
+// NOTE(koekeishiya): Returns true if there is data left that could not be sent yet.
+internal bool
+FlushSubscriber(subscriber *Subscriber)
+{
+    if (IsSocketAbandoned(Subscriber->SockFD)) {
+        Subscriber->Closed = true;
+        return false;
+    }
+
+    std::deque<subscription_record> *Pending = Subscriber->Pending;
+    while (!Pending->empty()) {
+        subscription_record *Record = &Pending->front();
+        ssize_t Sent = send(Subscriber->SockFD,
+                            Record->Text + Subscriber->Offset,
+                            Record->Length - Subscriber->Offset, 0);
+        if (Sent > 0) {
+            Subscriber->Offset += Sent;
+            if (Subscriber->Offset == Record->Length) {
+                free(Record->Text);
+                Pending->pop_front();
+                Subscriber->Offset = 0;
+            }
+        } else if (Sent == -1 && errno == EINTR) {
+            continue;
+        } else if (Sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        } else {
+            Subscriber->Closed = true;
+            return false;
+        }
+    }
+
+    return false;
+}
+
+internal TIMER_CALLBACK(FlushSubscribers);
+
+// NOTE(koekeishiya): Caller must hold the subscription lock.
+internal void
+FlushAndRemoveSubscribers()
+{
+    bool Retry = false;
+    uint32_t Topics = 0;
+
+    for (size_t Index = 0; Index < Subscribers.size();) {
+        subscriber *Subscriber = Subscribers[Index];
+        Retry |= FlushSubscriber(Subscriber);
+
+        if (Subscriber->Closed) {
+            DestroySubscriber(Subscriber);
+            Subscribers[Index] = Subscribers.back();
+            Subscribers.pop_back();
+        } else {
+            Topics |= Subscriber->Topics;
+            Retry |= !Subscriber->Pending->empty();
+            ++Index;
+        }
+    }
+
+    __atomic_store_n(&SubscribedTopics, Topics, __ATOMIC_RELAXED);
+
+    if (Retry && !FlushScheduled) {
+        FlushScheduled = true;
+        ScheduleTimer(&FlushTimer, SUBSCRIPTION_RETRY_MSEC, FlushSubscribers, NULL);
+    }
+}
+
+internal
+TIMER_CALLBACK(FlushSubscribers)
+{
+    pthread_mutex_lock(&SubscriptionLock);
+    FlushScheduled = false;
+    FlushAndRemoveSubscribers();
+    pthread_mutex_unlock(&SubscriptionLock);
+}
+
+bool BeginSubscriptions()
+{
+    return pthread_mutex_init(&SubscriptionLock, NULL) == 0;
+}
+
+bool AddSubscriber(int SockFD, const char *Message)
+{
+    uint32_t Topics = 0;
+
+    token Token;
+    while ((Token = GetToken(&Message)).Length > 0) {
+        if (TokenEquals(Token, "focus")) {
+            Topics |= Subscription_Focus;
+        } else if (TokenEquals(Token, "desktop")) {
+            Topics |= Subscription_Desktop;
+        } else if (TokenEquals(Token, "window")) {
+            Topics |= Subscription_Window;
+        } else if (TokenEquals(Token, "all")) {
+            Topics |= Subscription_All;
+        } else {
+            c_log(C_LOG_LEVEL_WARN, "chunkwm: invalid subscription '%.*s'\n", Token.Length, Token.Text);
+            return false;
+        }
+    }
+
+    int Flags = fcntl(SockFD, F_GETFL, 0);
+    if (fcntl(SockFD, F_SETFL, Flags | O_NONBLOCK) == -1) {
+        return false;
+    }
+
+    subscriber *Subscriber = (subscriber *) malloc(sizeof(subscriber));
+    Subscriber->SockFD = SockFD;
+    Subscriber->Topics = Topics ? Topics : Subscription_All;
+    Subscriber->Dropped = 0;
+    Subscriber->Closed = false;
+    Subscriber->Offset = 0;
+    Subscriber->Pending = new std::deque<subscription_record>;
+
+    pthread_mutex_lock(&SubscriptionLock);
+    Subscribers.push_back(Subscriber);
+    __atomic_or_fetch(&SubscribedTopics, Subscriber->Topics, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&SubscriptionLock);
+
+    return true;
+}
+
+bool HasSubscribers(uint32_t Topic)
+{
+    bool Result = (__atomic_load_n(&SubscribedTopics, __ATOMIC_RELAXED) & Topic) != 0;
+    return Result;
+}
+
+void PublishEvent(uint32_t Topic, const char *Name, bool Coalesce, const char *Format, ...)
+{
+    if (!HasSubscribers(Topic)) {
+        return;
+    }
+
+    char Buffer[SUBSCRIPTION_RECORD_SIZE];
+    int Length = snprintf(Buffer, sizeof(Buffer), "%s ", Name);
+
+    va_list Args;
+    va_start(Args, Format);
+    vsnprintf(Buffer + Length, sizeof(Buffer) - Length - 1, Format, Args);
+    va_end(Args);
+
+    // NOTE(koekeishiya): Every record is exactly one line, whatever the fields contain.
+    for (Length = 0; Buffer[Length]; ++Length) {
+        if (Buffer[Length] == '\n') Buffer[Length] = ' ';
+    }
+    Buffer[Length++] = '\n';
+
+    pthread_mutex_lock(&SubscriptionLock);
+    for (size_t Index = 0; Index < Subscribers.size(); ++Index) {
+        subscriber *Subscriber = Subscribers[Index];
+        if (Subscriber->Topics & Topic) {
+            EnqueueRecord(Subscriber, Name, Coalesce, Buffer, Length);
+        }
+    }
+
+    FlushAndRemoveSubscribers();
+    pthread_mutex_unlock(&SubscriptionLock);
+}
@@ -0,0 +1,46 @@
+#ifndef CHUNKWM_CORE_SUBSCRIPTION_H
+#define CHUNKWM_CORE_SUBSCRIPTION_H
+
+#include <stdint.h>
+
+/*
+ * NOTE(koekeishiya): External clients can subscribe to a stream of events through
+ * 'chunkc core::subscribe <topics>'. Every event is sent as a single line of text;
+ * the name of the event, followed by its fields separated by spaces. The last field
+ * may itself contain spaces.
+ *
+ *     window_focused <window id> <pid> <owner>
+ *     window_created <window id> <pid> <owner>
+ *     window_destroyed <window id> <pid> <owner>
+ *     application_activated <pid> <name>
+ *     desktop_changed <desktop id> <monitor id>
+ *     dropped <count>
+ *
+ * A subscriber that does not keep up has at most SUBSCRIPTION_MAX_PENDING events
+ * buffered. Beyond that, a newer focus or desktop event replaces an older event of
+ * the same kind that has not been sent yet, and other events are dropped. The number
+ * of dropped events is reported once there is room again.
+ */
+enum subscription_topic
+{
+    Subscription_Focus   = (1 << 0),
+    Subscription_Desktop = (1 << 1),
+    Subscription_Window  = (1 << 2),
+
+    Subscription_All     = Subscription_Focus |
+                           Subscription_Desktop |
+                           Subscription_Window,
+};
+
+#define SUBSCRIPTION_MAX_PENDING  256
+#define SUBSCRIPTION_RETRY_MSEC   50
+
+bool BeginSubscriptions();
+
+// NOTE(koekeishiya): Takes ownership of the socket if successful.
+bool AddSubscriber(int SockFD, const char *Message);
+
+bool HasSubscribers(uint32_t Topic);
+void PublishEvent(uint32_t Topic, const char *Name, bool Coalesce, const char *Format, ...);
+
+#endif
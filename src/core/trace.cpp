@@ -0,0 +1,238 @@
+#include "trace.h"
+#include "state.h"
+#include "clog.h"
+#include "clock.h"
+
+#include "dispatch/event.h"
+#include "dispatch/workspace.h"
+
+#include "../common/accessibility/window.h"
+#include "../common/accessibility/application.h"
+#include "../common/accessibility/element.h"
+#include "../common/misc/carbon.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define internal static
+
+#define TRACE_BUFFER_SIZE (64 * 1024)
+
+struct trace_replay
+{
+    char *Path;
+    bool Realtime;
+};
+
+internal FILE *TraceFile;
+internal bool volatile TraceEnabled;
+internal pthread_mutex_t TraceLock = PTHREAD_MUTEX_INITIALIZER;
+
+internal void
+PopulateTraceRecord(chunk_event *Event, trace_record *Record)
+{
+    memset(Record, 0, sizeof(trace_record));
+    Record->Timestamp = Event->Timestamp;
+    Record->Type = Event->Type;
+
+    switch (Event->Type) {
+    case ChunkWM_ApplicationLaunched:
+    case ChunkWM_ApplicationTerminated: {
+        carbon_application_details *Info = (carbon_application_details *) Event->Context;
+        Record->PID = Info->PID;
+    } break;
+    case ChunkWM_ApplicationActivated:
+    case ChunkWM_ApplicationDeactivated:
+    case ChunkWM_ApplicationVisible:
+    case ChunkWM_ApplicationHidden: {
+        workspace_application_details *Info = (workspace_application_details *) Event->Context;
+        Record->PID = Info->PID;
+    } break;
+    case ChunkWM_DisplayAdded:
+    case ChunkWM_DisplayRemoved:
+    case ChunkWM_DisplayMoved:
+    case ChunkWM_DisplayResized: {
+        Record->DisplayId = *(CGDirectDisplayID *) Event->Context;
+    } break;
+    case ChunkWM_WindowCreated:
+    case ChunkWM_WindowDestroyed:
+    case ChunkWM_WindowFocused:
+    case ChunkWM_WindowMoved:
+    case ChunkWM_WindowResized:
+    case ChunkWM_WindowMinimized:
+    case ChunkWM_WindowDeminimized:
+    case ChunkWM_WindowTitleChanged: {
+        macos_window *Window = (macos_window *) Event->Context;
+        Record->WindowId = Window->Id;
+        Record->PID = Window->Owner->PID;
+        Record->Flags = Window->Flags;
+        Record->X = Window->Position.x;
+        Record->Y = Window->Position.y;
+        Record->Width = Window->Size.width;
+        Record->Height = Window->Size.height;
+    } break;
+    default: {
+        // NOTE(koekeishiya): Events without a context, or with a context we do not record.
+    } break;
+    }
+}
+
+bool IsTraceRecording()
+{
+    return __atomic_load_n(&TraceEnabled, __ATOMIC_ACQUIRE);
+}
+
+// NOTE(koekeishiya): Called by the event-loop thread before an event is dispatched.
+void TraceEvent(chunk_event *Event)
+{
+    trace_record Record;
+    PopulateTraceRecord(Event, &Record);
+
+    pthread_mutex_lock(&TraceLock);
+    if (TraceFile) {
+        fwrite(&Record, sizeof(trace_record), 1, TraceFile);
+    }
+    pthread_mutex_unlock(&TraceLock);
+}
+
+bool BeginTraceRecording(const char *Path)
+{
+    EndTraceRecording();
+
+    FILE *Handle = fopen(Path, "ab");
+    if (!Handle) {
+        c_log(C_LOG_LEVEL_WARN, "chunkwm: could not open trace '%s'\n", Path);
+        return false;
+    }
+
+    setvbuf(Handle, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+
+    fseek(Handle, 0, SEEK_END);
+    if (ftell(Handle) == 0) {
+        trace_header Header = { TRACE_MAGIC, TRACE_VERSION, sizeof(trace_record), 0 };
+        fwrite(&Header, sizeof(trace_header), 1, Handle);
+    }
+
+    trace_record Session = {};
+    Session.Timestamp = GetMonotonicTime();
+    Session.Type = TRACE_SESSION;
+    fwrite(&Session, sizeof(trace_record), 1, Handle);
+
+    pthread_mutex_lock(&TraceLock);
+    TraceFile = Handle;
+    __atomic_store_n(&TraceEnabled, true, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&TraceLock);
+
+    c_log(C_LOG_LEVEL_DEBUG, "chunkwm: recording events to '%s'\n", Path);
+    return true;
+}
+
+void EndTraceRecording()
+{
+    pthread_mutex_lock(&TraceLock);
+    __atomic_store_n(&TraceEnabled, false, __ATOMIC_RELEASE);
+    if (TraceFile) {
+        fclose(TraceFile);
+        TraceFile = NULL;
+    }
+    pthread_mutex_unlock(&TraceLock);
+}
+
+/*
+ * NOTE(koekeishiya): We can only replay events that do not create or destroy state, and
+ * whose context can be reconstructed from what is currently tracked. Window events for
+ * windows that no longer exist are skipped. This is enough to reproduce drag storms,
+ * title storms and focus churn against the current set of windows.
+ *
+ * Moves and resizes are replayed by moving the window to the recorded frame. The callback
+ * reads the frame back from the window, so the event that we post carries the recorded
+ * geometry. The notification that the move itself triggers is merged with ours when the
+ * event-loop is busy, the same as during a live drag.
+ */
+internal
+TRACE_REPLAY_BACKEND(ReplayTraceRecord)
+{
+    switch (Record->Type) {
+    case ChunkWM_SpaceChanged: {
+        ConstructEvent(ChunkWM_SpaceChanged, NULL);
+    } break;
+    case ChunkWM_DisplayChanged: {
+        ConstructEvent(ChunkWM_DisplayChanged, NULL);
+    } break;
+    case ChunkWM_DisplayMoved:
+    case ChunkWM_DisplayResized: {
+        CGDirectDisplayID *DisplayId = (CGDirectDisplayID *) malloc(sizeof(CGDirectDisplayID));
+        *DisplayId = Record->DisplayId;
+
+        if (Record->Type == ChunkWM_DisplayMoved) {
+            ConstructEvent(ChunkWM_DisplayMoved, DisplayId);
+        } else {
+            ConstructEvent(ChunkWM_DisplayResized, DisplayId);
+        }
+    } break;
+    case ChunkWM_WindowFocused:
+    case ChunkWM_WindowMoved:
+    case ChunkWM_WindowResized:
+    case ChunkWM_WindowTitleChanged: {
+        macos_window *Window = GetWindowByID(Record->WindowId);
+        if (!Window) return false;
+
+        if (Record->Type == ChunkWM_WindowFocused) {
+            ConstructEvent(ChunkWM_WindowFocused, Window);
+        } else if (Record->Type == ChunkWM_WindowMoved) {
+            AXLibSetWindowPosition(Window->Ref, Record->X, Record->Y);
+            ConstructEvent(ChunkWM_WindowMoved, Window);
+        } else if (Record->Type == ChunkWM_WindowResized) {
+            AXLibSetWindowPosition(Window->Ref, Record->X, Record->Y);
+            AXLibSetWindowSize(Window->Ref, Record->Width, Record->Height);
+            ConstructEvent(ChunkWM_WindowResized, Window);
+        } else {
+            ConstructEvent(ChunkWM_WindowTitleChanged, Window);
+        }
+    } break;
+    default: {
+        return false;
+    } break;
+    }
+
+    return true;
+}
+
+internal void *
+ReplayTraceThread(void *Data)
+{
+    trace_replay *Replay = (trace_replay *) Data;
+    trace_replay_result Result;
+
+    uint64_t StartTime = GetMonotonicTime();
+    if (ReplayTraceFile(Replay->Path, Replay->Realtime, ReplayTraceRecord, NULL, &Result)) {
+        c_log(C_LOG_LEVEL_DEBUG, "chunkwm: replayed %u events in %u session(s) from '%s', skipped %u, took %.3fms\n",
+              Result.Replayed, Result.Sessions, Replay->Path, Result.Skipped,
+              (double) (GetMonotonicTime() - StartTime) / NSEC_PER_MSEC);
+    }
+
+    free(Replay->Path);
+    free(Replay);
+    return NULL;
+}
+
+// NOTE(koekeishiya): Replays a trace on a separate thread, at the recorded pace or as fast as possible.
+bool ReplayTrace(const char *Path, bool Realtime)
+{
+    trace_replay *Replay = (trace_replay *) malloc(sizeof(trace_replay));
+    Replay->Path = strdup(Path);
+    Replay->Realtime = Realtime;
+
+    pthread_t Thread;
+    if (pthread_create(&Thread, NULL, &ReplayTraceThread, Replay) != 0) {
+        free(Replay->Path);
+        free(Replay);
+        return false;
+    }
+
+    pthread_detach(Thread);
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef CHUNKWM_CORE_TRACE_H
+#define CHUNKWM_CORE_TRACE_H
+
+#include <stdint.h>
+
+/*
+ * NOTE(koekeishiya): A trace is an append-only file that starts with a 'trace_header',
+ * followed by fixed-size 'trace_record's in dispatch order. Timestamps are the monotonic
+ * time (in nanoseconds) at which the event was added to the event-loop. Fields that do
+ * not apply to an event type are zero.
+ *
+ * Every time recording starts, a record of type TRACE_SESSION is written first. The
+ * monotonic clock restarts with the machine, so timestamps are only comparable between
+ * records of the same session.
+ */
+#define TRACE_MAGIC   0x54574d43
+#define TRACE_VERSION 1
+#define TRACE_SESSION 0xffffffff
+
+struct trace_header
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t RecordSize;
+    uint32_t Reserved;
+};
+
+struct trace_record
+{
+    uint64_t Timestamp;
+    uint32_t Type;
+    uint32_t WindowId;
+    int32_t PID;
+    uint32_t DisplayId;
+    uint32_t Flags;
+    float X, Y;
+    float Width, Height;
+    uint32_t Reserved;
+};
+
+struct chunk_event;
+
+bool BeginTraceRecording(const char *Path);
+void EndTraceRecording();
+bool IsTraceRecording();
+void TraceEvent(chunk_event *Event);
+
+bool ReplayTrace(const char *Path, bool Realtime);
+
+/*
+ * NOTE(koekeishiya): Replay reads a trace and hands every record to a backend, either at
+ * the recorded pace or as fast as possible. The core backend resolves records against the
+ * windows that currently exist and posts them to the event-loop. The driver itself does not
+ * depend on macOS, so tests can run it against a stub backend.
+ */
+#define TRACE_REPLAY_BACKEND(name) bool name(trace_record *Record, void *Context)
+typedef TRACE_REPLAY_BACKEND(trace_replay_backend);
+
+struct trace_replay_result
+{
+    unsigned Replayed;
+    unsigned Skipped;
+    unsigned Sessions;
+};
+
+bool ReplayTraceFile(const char *Path, bool Realtime,
+                     trace_replay_backend *Backend, void *Context,
+                     trace_replay_result *Result);
+
+#endif
@@ -0,0 +1,171 @@
+#include "twheel.h"
+
+#include <stddef.h>
+
+#define internal static
+
+#define TIMER_WHEEL_RANGE (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+internal inline void
+TimerListInit(timer *List)
+{
+    List->Next = List;
+    List->Prev = List;
+}
+
+internal inline void
+TimerListAppend(timer *List, timer *Timer)
+{
+    Timer->Prev = List->Prev;
+    Timer->Next = List;
+    List->Prev->Next = Timer;
+    List->Prev = Timer;
+}
+
+internal inline void
+TimerListUnlink(timer *Timer)
+{
+    Timer->Prev->Next = Timer->Next;
+    Timer->Next->Prev = Timer->Prev;
+    Timer->Next = NULL;
+    Timer->Prev = NULL;
+}
+
+internal timer *
+TimerListPop(timer *List)
+{
+    timer *Result = NULL;
+    if (List->Next != List) {
+        Result = List->Next;
+        TimerListUnlink(Result);
+    }
+
+    return Result;
+}
+
+// NOTE(koekeishiya): Move every timer from 'Source' to the end of 'Destination'.
+internal inline void
+TimerListSplice(timer *Destination, timer *Source)
+{
+    if (Source->Next != Source) {
+        Source->Next->Prev = Destination->Prev;
+        Source->Prev->Next = Destination;
+        Destination->Prev->Next = Source->Next;
+        Destination->Prev = Source->Prev;
+        TimerListInit(Source);
+    }
+}
+
+// NOTE(koekeishiya): A timer is pending if it is linked into a slot, or into a list of expired timers.
+bool TimerPending(timer *Timer)
+{
+    return Timer->Next != NULL;
+}
+
+internal void
+TimerWheelInsert(timer_wheel *Wheel, timer *Timer)
+{
+    if (Timer->Expires < Wheel->Now) {
+        Timer->Expires = Wheel->Now;
+    } else if (Timer->Expires - Wheel->Now >= TIMER_WHEEL_RANGE) {
+        Timer->Expires = Wheel->Now + TIMER_WHEEL_RANGE - 1;
+    }
+
+    uint64_t Delta = Timer->Expires - Wheel->Now;
+    int Level = 0;
+    while ((Level < TIMER_WHEEL_LEVELS - 1) &&
+           (Delta >= (1ULL << (TIMER_WHEEL_BITS * (Level + 1))))) {
+        ++Level;
+    }
+
+    uint32_t Slot = (Timer->Expires >> (TIMER_WHEEL_BITS * Level)) & TIMER_WHEEL_MASK;
+    TimerListAppend(&Wheel->Slots[Level][Slot], Timer);
+}
+
+void TimerWheelInit(timer_wheel *Wheel, uint64_t Now)
+{
+    TimerListInit(&Wheel->Expired);
+    for (int Level = 0; Level < TIMER_WHEEL_LEVELS; ++Level) {
+        for (int Slot = 0; Slot < TIMER_WHEEL_SLOTS; ++Slot) {
+            TimerListInit(&Wheel->Slots[Level][Slot]);
+        }
+    }
+
+    Wheel->Now = Now;
+    Wheel->Count = 0;
+}
+
+void TimerWheelSchedule(timer_wheel *Wheel, timer *Timer, uint64_t Expires)
+{
+    if (TimerPending(Timer)) {
+        TimerWheelCancel(Wheel, Timer);
+    }
+
+    Timer->Expires = Expires;
+    TimerWheelInsert(Wheel, Timer);
+    ++Wheel->Count;
+}
+
+/*
+ * NOTE(koekeishiya): Timers that have already expired, but have not been popped yet,
+ * are also unlinked, so cancelling a timer guarantees that its callback will not run,
+ * as long as the owner pops expired timers under the same lock.
+ */
+void TimerWheelCancel(timer_wheel *Wheel, timer *Timer)
+{
+    if (TimerPending(Timer)) {
+        TimerListUnlink(Timer);
+        --Wheel->Count;
+    }
+}
+
+// NOTE(koekeishiya): Re-insert every timer of a higher level slot, now that it is within range.
+internal void
+TimerWheelCascade(timer_wheel *Wheel, int Level, uint32_t Slot)
+{
+    timer List;
+    TimerListInit(&List);
+    TimerListSplice(&List, &Wheel->Slots[Level][Slot]);
+
+    timer *Timer;
+    while ((Timer = TimerListPop(&List))) {
+        TimerWheelInsert(Wheel, Timer);
+    }
+}
+
+/*
+ * NOTE(koekeishiya): Process every tick up to and including 'Now', and move expired
+ * timers to the expired list. Expired timers stay pending, and still count towards
+ * 'Count', until the owner pops them through 'TimerWheelPopExpired'.
+ */
+void TimerWheelAdvance(timer_wheel *Wheel, uint64_t Now)
+{
+    while (Wheel->Now <= Now) {
+        uint64_t Tick = Wheel->Now;
+
+        if ((Tick & TIMER_WHEEL_MASK) == 0) {
+            for (int Level = 1; Level < TIMER_WHEEL_LEVELS; ++Level) {
+                uint32_t Slot = (Tick >> (TIMER_WHEEL_BITS * Level)) & TIMER_WHEEL_MASK;
+                TimerWheelCascade(Wheel, Level, Slot);
+                if (Slot != 0) break;
+            }
+        }
+
+        TimerListSplice(&Wheel->Expired, &Wheel->Slots[0][Tick & TIMER_WHEEL_MASK]);
+        ++Wheel->Now;
+
+        if (Wheel->Count == 0) {
+            Wheel->Now = Now + 1;
+        }
+    }
+}
+
+timer *TimerWheelPopExpired(timer_wheel *Wheel)
+{
+    timer *Result = TimerListPop(&Wheel->Expired);
+    if (Result) {
+        --Wheel->Count;
+    }
+
+    return Result;
+}
@@ -0,0 +1,50 @@
+#ifndef CHUNKWM_CORE_TWHEEL_H
+#define CHUNKWM_CORE_TWHEEL_H
+
+#include <stdint.h>
+
+/*
+ * NOTE(koekeishiya): Hierarchical timer wheel. Level 0 has one slot per tick, and every
+ * slot in level N covers TIMER_WHEEL_SLOTS slots of level N-1. Timers are intrusive and
+ * kept in doubly-linked lists, so scheduling and cancelling a timer is O(1). Timers in a
+ * higher level are cascaded down when the lower level wraps around.
+ *
+ * The wheel does not know about real time and is not thread-safe; the owner advances
+ * it and provides locking.
+ */
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK    (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS  4
+
+struct timer;
+#define TIMER_CALLBACK(name) void name(timer *Timer, void *Data)
+typedef TIMER_CALLBACK(timer_callback);
+
+struct timer
+{
+    timer *Next;
+    timer *Prev;
+    uint64_t Expires;
+
+    timer_callback *Callback;
+    void *Data;
+};
+
+struct timer_wheel
+{
+    uint64_t Now;
+    uint32_t Count;
+    timer Expired;
+    timer Slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
+void TimerWheelInit(timer_wheel *Wheel, uint64_t Now);
+void TimerWheelSchedule(timer_wheel *Wheel, timer *Timer, uint64_t Expires);
+void TimerWheelCancel(timer_wheel *Wheel, timer *Timer);
+void TimerWheelAdvance(timer_wheel *Wheel, uint64_t Now);
+timer *TimerWheelPopExpired(timer_wheel *Wheel);
+
+bool TimerPending(timer *Timer);
+
+#endif
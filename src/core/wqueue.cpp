@@ -1,69 +1,208 @@
 #include "wqueue.h"
 #include "clog.h"
-#include "../common/misc/assert.h"
 
 #include <stdio.h>
-#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #define internal static
 
-#define ArrayCount(Array) (sizeof(Array) / sizeof(*(Array)))
+/*
+ * NOTE(koekeishiya): Every worker owns a deque. Entries are distributed round-robin
+ * across the deques of the active workers. A worker takes the oldest entry from its own
+ * deque, and steals the oldest entry from another deque when its own is empty; entries
+ * come from the producer and not from the worker itself, so there is nothing to gain from
+ * running the most recent one first, and doing so leaves the oldest entries waiting.
+ * The deques grow on demand, so the only limit is the total number of pending entries;
+ * when that is reached, the producer runs the entry itself instead of queueing it.
+ *
+ * The queue does not track completion. Callers that need to wait for their entries keep
+ * their own count under a lock and sleep on it; see PluginQueueWait.
+ */
+internal void
+DequeGrow(work_queue_deque *Deque)
+{
+    uint32_t Capacity = Deque->Capacity ? Deque->Capacity * 2 : WORK_QUEUE_DEQUE_SIZE;
+    work_queue_entry *Entries = (work_queue_entry *) malloc(Capacity * sizeof(work_queue_entry));
+
+    uint32_t Count = Deque->Tail - Deque->Head;
+    for (uint32_t Index = 0; Index < Count; ++Index) {
+        Entries[Index] = Deque->Entries[(Deque->Head + Index) & (Deque->Capacity - 1)];
+    }
+
+    free(Deque->Entries);
+    Deque->Entries = Entries;
+    Deque->Capacity = Capacity;
+    Deque->Head = 0;
+    Deque->Tail = Count;
+}
+
+internal void
+DequePush(work_queue_deque *Deque, work_queue_entry Entry)
+{
+    pthread_mutex_lock(&Deque->Lock);
+    if (Deque->Tail - Deque->Head == Deque->Capacity) {
+        DequeGrow(Deque);
+    }
+
+    Deque->Entries[Deque->Tail++ & (Deque->Capacity - 1)] = Entry;
+    pthread_mutex_unlock(&Deque->Lock);
+}
 
 internal bool
-DoNextWorkQueueEntry(work_queue *Queue)
+DequePop(work_queue_deque *Deque, work_queue_entry *Entry)
 {
-    uint32_t EntryToRead = Queue->EntryToRead;
-    uint32_t NextEntryToRead = (EntryToRead + 1) % ArrayCount(Queue->Entries);
-    if (EntryToRead != Queue->EntryToWrite) {
-        int Index = __sync_val_compare_and_swap(&Queue->EntryToRead, EntryToRead, NextEntryToRead);
-        if (Index == EntryToRead) {
-            work_queue_entry Entry = Queue->Entries[Index];
+    bool Result = false;
+    pthread_mutex_lock(&Deque->Lock);
+    if (Deque->Tail != Deque->Head) {
+        *Entry = Deque->Entries[Deque->Head++ & (Deque->Capacity - 1)];
+        Result = true;
+    }
+    pthread_mutex_unlock(&Deque->Lock);
+    return Result;
+}
+
+/*
+ * NOTE(koekeishiya): Try our own deque first, then every other deque that has been in use,
+ * starting with our neighbour, so that thieves do not all hit the same deque.
+ */
+internal bool
+NextWorkQueueEntry(work_queue *Queue, uint32_t Index, work_queue_entry *Entry)
+{
+    if (__atomic_load_n(&Queue->Pending, __ATOMIC_SEQ_CST) == 0) {
+        return false;
+    }
+
+    uint32_t DequeCount = __atomic_load_n(&Queue->DequeCount, __ATOMIC_ACQUIRE);
+    for (uint32_t Offset = 0; Offset < DequeCount; ++Offset) {
+        uint32_t Victim = (Index + Offset) % DequeCount;
+        if (DequePop(&Queue->Deques[Victim], Entry)) {
+            __atomic_sub_fetch(&Queue->Pending, 1, __ATOMIC_SEQ_CST);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+internal void *
+WorkQueueThreadProc(void *Data)
+{
+    work_queue_worker *Worker = (work_queue_worker *) Data;
+    work_queue *Queue = Worker->Queue;
+    work_queue_entry Entry;
+
+    for (;;) {
+        if (NextWorkQueueEntry(Queue, Worker->Index, &Entry)) {
             Entry.Callback(Entry.Data);
-            __sync_fetch_and_add(&Queue->EntriesCompleted, 1);
+            continue;
         }
 
-        return false;
+        pthread_mutex_lock(&Queue->Lock);
+        if (Worker->Index >= Queue->ThreadCount) {
+            Worker->Running = false;
+            pthread_mutex_unlock(&Queue->Lock);
+            break;
+        }
+
+        __atomic_add_fetch(&Queue->Sleeping, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&Queue->Pending, __ATOMIC_SEQ_CST) == 0) {
+            pthread_cond_wait(&Queue->Condition, &Queue->Lock);
+        }
+        __atomic_sub_fetch(&Queue->Sleeping, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&Queue->Lock);
     }
 
-    return true;
+    return NULL;
 }
 
 void AddWorkQueueEntry(work_queue *Queue, work_queue_callback *Callback, void *Data)
 {
-    uint32_t NextEntryToWrite = (Queue->EntryToWrite + 1) % ArrayCount(Queue->Entries);
-    ASSERT(NextEntryToWrite != Queue->EntryToRead);
+    work_queue_entry Entry = { Callback, Data };
+
+    /*
+     * NOTE(koekeishiya): Backpressure; if the workers have fallen this far behind,
+     * queueing more work only adds latency, so the producer does the work itself.
+     */
+    if (__atomic_load_n(&Queue->Pending, __ATOMIC_RELAXED) >= WORK_QUEUE_MAX_PENDING) {
+        Callback(Data);
+        return;
+    }
 
-    work_queue_entry *Entry = Queue->Entries + Queue->EntryToWrite;
-    Entry->Callback = Callback;
-    Entry->Data = Data;
-    ++Queue->EntryCount;
+    uint32_t ThreadCount = __atomic_load_n(&Queue->ThreadCount, __ATOMIC_RELAXED);
+    uint32_t Index = __atomic_fetch_add(&Queue->NextDeque, 1, __ATOMIC_RELAXED) % (ThreadCount ? ThreadCount : 1);
+    DequePush(&Queue->Deques[Index], Entry);
 
-    asm volatile("" ::: "memory");
-    Queue->EntryToWrite = NextEntryToWrite;
-    sem_post(Queue->Semaphore);
+    __atomic_add_fetch(&Queue->Pending, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&Queue->Sleeping, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&Queue->Lock);
+        pthread_cond_signal(&Queue->Condition);
+        pthread_mutex_unlock(&Queue->Lock);
+    }
 }
 
-void *WorkQueueThreadProc(void *Data)
+// NOTE(koekeishiya): A requested thread count of 0 means one worker per online core.
+uint32_t WorkQueueThreadCount(uint32_t Requested)
 {
-    work_queue *Queue = (work_queue *) Data;
-    for (;;) {
-        if (DoNextWorkQueueEntry(Queue)) {
-            int Result = sem_wait(Queue->Semaphore);
-            if (Result) {
-                uint64_t ID;
-                pthread_threadid_np(NULL, &ID);
-                c_log(C_LOG_LEVEL_DEBUG, "%lld: sem_wait(..) failed\n", ID);
-            }
+    if (Requested == 0) {
+        long Cores = sysconf(_SC_NPROCESSORS_ONLN);
+        Requested = Cores > 0 ? (uint32_t) Cores : 1;
+    }
+
+    return Requested < WORK_QUEUE_MAX_THREADS ? Requested : WORK_QUEUE_MAX_THREADS;
+}
+
+/*
+ * NOTE(koekeishiya): Workers above the new thread count exit once they run out of work.
+ * Their deques stay visible to the remaining workers, so nothing is left behind.
+ */
+void ResizeWorkQueue(work_queue *Queue, uint32_t ThreadCount)
+{
+    ThreadCount = WorkQueueThreadCount(ThreadCount);
+
+    pthread_mutex_lock(&Queue->Lock);
+    for (uint32_t Index = 0; Index < ThreadCount; ++Index) {
+        work_queue_worker *Worker = Queue->Workers + Index;
+        if (Worker->Running) continue;
+
+        pthread_t Thread;
+        Worker->Queue = Queue;
+        Worker->Index = Index;
+        Worker->Running = true;
+        if (pthread_create(&Thread, NULL, &WorkQueueThreadProc, Worker) != 0) {
+            c_log(C_LOG_LEVEL_WARN, "chunkwm: could not create worker thread %d\n", Index);
+            Worker->Running = false;
+            ThreadCount = Index;
+            break;
         }
+        pthread_detach(Thread);
     }
+
+    if (ThreadCount > Queue->DequeCount) {
+        __atomic_store_n(&Queue->DequeCount, ThreadCount, __ATOMIC_RELEASE);
+    }
+
+    __atomic_store_n(&Queue->ThreadCount, ThreadCount, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&Queue->Condition);
+    pthread_mutex_unlock(&Queue->Lock);
 }
 
-void CompleteWorkQueue(work_queue *Queue)
+bool BeginWorkQueue(work_queue *Queue, uint32_t ThreadCount)
 {
-    while (Queue->EntryCount != Queue->EntriesCompleted) {
-        DoNextWorkQueueEntry(Queue);
+    Queue->DequeCount = 1;
+    for (uint32_t Index = 0; Index < WORK_QUEUE_MAX_THREADS; ++Index) {
+        pthread_mutex_init(&Queue->Deques[Index].Lock, NULL);
+    }
+
+    if (pthread_mutex_init(&Queue->Lock, NULL) != 0) {
+        return false;
+    }
+
+    if (pthread_cond_init(&Queue->Condition, NULL) != 0) {
+        pthread_mutex_destroy(&Queue->Lock);
+        return false;
     }
 
-    Queue->EntryCount = 0;
-    Queue->EntriesCompleted = 0;
+    ResizeWorkQueue(Queue, ThreadCount);
+    return Queue->ThreadCount > 0;
 }
@@ -2,30 +2,57 @@
 #define CHUNKWM_CORE_WQUEUE_H
 
 #include <stdint.h>
-#include <semaphore.h>
+#include <pthread.h>
 
 #define WORK_QUEUE_CALLBACK(name) void name(void *Data)
 typedef WORK_QUEUE_CALLBACK(work_queue_callback);
 
+#define WORK_QUEUE_MAX_THREADS  64
+#define WORK_QUEUE_DEQUE_SIZE   64
+#define WORK_QUEUE_MAX_PENDING  4096
+
 struct work_queue_entry
 {
     work_queue_callback *Callback;
     void *Data;
 };
 
+struct work_queue;
+struct work_queue_deque
+{
+    pthread_mutex_t Lock;
+    work_queue_entry *Entries;
+    uint32_t Capacity;
+    uint32_t Head;
+    uint32_t Tail;
+} __attribute__((aligned(64)));
+
+struct work_queue_worker
+{
+    work_queue *Queue;
+    uint32_t Index;
+    bool Running;
+};
+
 struct work_queue
 {
-    uint32_t volatile EntriesCompleted;
-    uint32_t volatile EntryCount;
-    uint32_t volatile EntryToWrite;
-    uint32_t volatile EntryToRead;
-    sem_t *Semaphore;
+    uint32_t volatile Pending;
+    uint32_t volatile NextDeque;
 
-    work_queue_entry Entries[256];
+    uint32_t volatile ThreadCount;
+    uint32_t volatile DequeCount;
+    uint32_t volatile Sleeping;
+    pthread_mutex_t Lock;
+    pthread_cond_t Condition;
+
+    work_queue_worker Workers[WORK_QUEUE_MAX_THREADS];
+    work_queue_deque Deques[WORK_QUEUE_MAX_THREADS];
 };
 
-void CompleteWorkQueue(work_queue *Queue);
+bool BeginWorkQueue(work_queue *Queue, uint32_t ThreadCount);
+void ResizeWorkQueue(work_queue *Queue, uint32_t ThreadCount);
+uint32_t WorkQueueThreadCount(uint32_t Requested);
+
 void AddWorkQueueEntry(work_queue *Queue, work_queue_callback *Callback, void *Data);
-void *WorkQueueThreadProc(void *Data);
 
 #endif
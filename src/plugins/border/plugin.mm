@@ -21,12 +21,26 @@
 
 #define internal static
 
+#define CVAR_BORDER_PREFIX          "focused_border_"
+#define CVAR_BORDER_COLOR           "focused_border_color"
+#define CVAR_BORDER_WIDTH           "focused_border_width"
+#define CVAR_BORDER_RADIUS          "focused_border_radius"
+#define CVAR_BORDER_SKIP_FLOATING   "focused_border_skip_floating"
+
+internal const char *PluginName = "Border";
+internal const char *PluginVersion = "0.2.10";
+
 internal macos_application *Application;
 internal border_window *Border;
 internal bool SkipFloating;
 internal bool DrawBorder;
 internal chunkwm_api API;
 
+// NOTE(koekeishiya): Cached, and refreshed when we are told that a cvar has changed.
+internal unsigned BorderColor;
+internal int BorderWidth;
+internal int BorderRadius;
+
 internal AXUIElementRef
 GetFocusedWindow()
 {
@@ -44,13 +58,19 @@ GetFocusedWindow()
     return NULL;;
 }
 
+internal void
+ReadBorderConfig()
+{
+    BorderColor = CVarUnsignedValue(CVAR_BORDER_COLOR);
+    BorderWidth = CVarIntegerValue(CVAR_BORDER_WIDTH);
+    BorderRadius = CVarIntegerValue(CVAR_BORDER_RADIUS);
+    SkipFloating = CVarIntegerValue(CVAR_BORDER_SKIP_FLOATING);
+}
+
 internal void
 CreateBorder(int X, int Y, int W, int H)
 {
-    unsigned Color = CVarUnsignedValue("focused_border_color");
-    int Width = CVarIntegerValue("focused_border_width");
-    int Radius = CVarIntegerValue("focused_border_radius");
-    Border = CreateBorderWindow(X, Y, W, H, Width, Radius, Color);
+    Border = CreateBorderWindow(X, Y, W, H, BorderWidth, BorderRadius, BorderColor);
 }
 
 internal inline void
@@ -165,7 +185,7 @@ WindowFocusedHandler(void *Data)
         ((Window->Owner == Application) ||
         (Application == NULL))) {
         CFStringRef DisplayRef = AXLibGetDisplayIdentifierFromWindow(Window->Id);
-        if (!DisplayRef) DisplayRef = AXLibGetDisplayIdentifierFromWindowRect(Window->Position, Window->Size);
+        if (!DisplayRef) DisplayRef = AXLibGetDisplayIdentifierFromWindowRect(AXLibLoadWindowPosition(Window), AXLibLoadWindowSize(Window));
         ASSERT(DisplayRef);
 
         macos_space *Space = AXLibActiveSpace(DisplayRef);
@@ -244,6 +264,26 @@ SpaceChangedHandler()
     AXLibDestroySpace(Space);
 }
 
+// NOTE(koekeishiya): The width and radius of a border can only be set when it is created.
+internal void
+CVarChangedHandler()
+{
+    unsigned Color = BorderColor;
+    int Width = BorderWidth;
+    int Radius = BorderRadius;
+
+    ReadBorderConfig();
+    if (!Border) return;
+
+    if ((Width != BorderWidth) || (Radius != BorderRadius)) {
+        DestroyBorderWindow(Border);
+        Border = NULL;
+        NewWindowHandler();
+    } else if (Color != BorderColor) {
+        UpdateBorderWindowColor(Border, BorderColor);
+    }
+}
+
 internal inline bool
 StringEquals(const char *A, const char *B)
 {
@@ -251,7 +291,7 @@ StringEquals(const char *A, const char *B)
     return Result;
 }
 
-internal void
+internal bool
 CommandHandler(void *Data)
 {
     chunkwm_payload *Payload = (chunkwm_payload *) Data;
@@ -262,12 +302,16 @@ CommandHandler(void *Data)
             if (Border) {
                 UpdateBorderWindowColor(Border, Color);
             }
+            return true;
         }
     } else if (StringEquals(Payload->Command, "clear")) {
         if (Border) {
             ClearBorderWindow(Border);
         }
+        return true;
     }
+
+    return false;
 }
 
 internal inline void
@@ -319,7 +363,9 @@ PLUGIN_MAIN_FUNC(PluginMain)
         SpaceChangedHandler();
         return true;
     } else if (StringEquals(Node, "chunkwm_daemon_command")) {
-        CommandHandler(Data);
+        return CommandHandler(Data);
+    } else if (StringEquals(Node, "chunkwm_cvar_changed")) {
+        CVarChangedHandler();
         return true;
     } else if ((StringEquals(Node, "Tiling_focused_window_float")) && (SkipFloating)) {
         TilingFocusedWindowFloatStatus(Data);
@@ -334,12 +380,14 @@ PLUGIN_BOOL_FUNC(PluginInit)
     API = ChunkwmAPI;
     BeginCVars(&API);
 
-    CreateCVar("focused_border_color", 0xffd5c4a1);
-    CreateCVar("focused_border_width", 4);
-    CreateCVar("focused_border_radius", 4);
-    CreateCVar("focused_border_skip_floating", 0);
+    CreateCVar(CVAR_BORDER_COLOR, 0xffd5c4a1);
+    CreateCVar(CVAR_BORDER_WIDTH, 4);
+    CreateCVar(CVAR_BORDER_RADIUS, 4);
+    CreateCVar(CVAR_BORDER_SKIP_FLOATING, 0);
+
+    ReadBorderConfig();
+    WatchCVarPrefix(PluginName, CVAR_BORDER_PREFIX);
 
-    SkipFloating = CVarIntegerValue("focused_border_skip_floating");
     DrawBorder = !SkipFloating;
     CreateBorder(0, 0, 0, 0);
     return true;
@@ -372,4 +420,4 @@ chunkwm_plugin_export Subscriptions[] =
     chunkwm_export_display_changed,
 };
 CHUNKWM_PLUGIN_SUBSCRIBE(Subscriptions)
-CHUNKWM_PLUGIN("Border", "0.2.10")
+CHUNKWM_PLUGIN(PluginName, PluginVersion)
@@ -10,6 +10,7 @@
 #include "../../common/accessibility/element.h"
 #include "../../common/accessibility/observer.h"
 #include "../../common/ipc/daemon.h"
+#include "../../common/ipc/extdock.h"
 
 #include "../../common/misc/carbon.cpp"
 #include "../../common/misc/workspace.mm"
@@ -18,6 +19,7 @@
 #include "../../common/accessibility/element.cpp"
 #include "../../common/accessibility/observer.cpp"
 #include "../../common/ipc/daemon.cpp"
+#include "../../common/ipc/extdock.cpp"
 
 #define internal static
 
@@ -28,14 +30,9 @@ internal chunkwm_api API;
 internal void
 ExtendedDockDisableWindowShadow(uint32_t WindowId)
 {
-    int SockFD;
-    if (ConnectToDaemon(&SockFD, 5050)) {
-        char Message[64];
-        sprintf(Message, "window_shadow %d 0", WindowId);
-        WriteToSocket(Message, SockFD);
-    }
-    CloseSocket(SockFD);
+    ExtendedDockCommand("window_shadow %d 0", WindowId);
 }
+
 inline bool
 StringsAreEqual(const char *A, const char *B)
 {
@@ -43,13 +40,8 @@ StringsAreEqual(const char *A, const char *B)
     return Result;
 }
 
-/*
- * NOTE(koekeishiya):
- * parameter: const char *Node
- * parameter: void *Data
- * return: bool
- */
-PLUGIN_MAIN_FUNC(PluginMain)
+internal bool
+HandleEvent(const char *Node, void *Data)
 {
     if (StringsAreEqual(Node, "chunkwm_export_application_launched")) {
         macos_application *Application = (macos_application *) Data;
@@ -74,6 +66,19 @@ PLUGIN_MAIN_FUNC(PluginMain)
     return false;
 }
 
+/*
+ * NOTE(koekeishiya):
+ * parameter: const char *Node
+ * parameter: void *Data
+ * return: bool
+ */
+PLUGIN_MAIN_FUNC(PluginMain)
+{
+    bool Result = HandleEvent(Node, Data);
+    ExtendedDockFlush();
+    return Result;
+}
+
 /*
  * NOTE(koekeishiya):
  * parameter: chunkwm_api ChunkwmAPI
@@ -82,6 +87,9 @@ PLUGIN_MAIN_FUNC(PluginMain)
 PLUGIN_BOOL_FUNC(PluginInit)
 {
     API = ChunkwmAPI;
+    if (!BeginExtendedDock(EXTENDED_DOCK_PORT)) {
+        return false;
+    }
 
     /*
      * NOTE(koekeishiya): Disable shadows for existing windows.
@@ -104,11 +112,13 @@ PLUGIN_BOOL_FUNC(PluginInit)
         free(WindowList);
     }
 
+    ExtendedDockFlush();
     return true;
 }
 
 PLUGIN_VOID_FUNC(PluginDeInit)
 {
+    EndExtendedDock();
 }
 
 // NOTE(koekeishiya): Enable to manually trigger ABI mismatch
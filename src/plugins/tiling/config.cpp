@@ -472,6 +472,7 @@ query_func QueryCommandDispatch(char Flag)
     case 'm': return QueryMonitor;            break;
     case 'D': return QueryDesktopsForMonitor; break;
     case 'M': return QueryMonitorForDesktop;  break;
+    case 's': return QuerySnapshot;           break;
 
     // NOTE(koekeishiya): silence compiler warning.
     default: return 0; break;
@@ -485,7 +486,7 @@ ParseQueryCommand(const char *Message, command *Chain)
 
     int Option;
     bool Success = true;
-    const char *Short = "w:d:m:D:M:";
+    const char *Short = "w:d:m:D:M:s:";
 
     struct option Long[] = {
         { "window", required_argument, NULL, 'w' },
@@ -493,6 +494,7 @@ ParseQueryCommand(const char *Message, command *Chain)
         { "monitor", required_argument, NULL, 'm' },
         { "desktops-for-monitor", required_argument, NULL, 'D' },
         { "monitor-for-desktop", required_argument, NULL, 'M' },
+        { "snapshot", required_argument, NULL, 's' },
         { NULL, 0, NULL, 0 }
     };
 
@@ -557,6 +559,18 @@ ParseQueryCommand(const char *Message, command *Chain)
                 goto End;
             }
         } break;
+        case 's': {
+            if (StringEquals(optarg, "json")) {
+                command *Entry = ConstructCommand(Option, optarg);
+                Command->Next = Entry;
+                Command = Entry;
+            } else {
+                c_log(C_LOG_LEVEL_WARN, "    invalid format '%s' for snapshot flag '%c'\n", optarg, Option);
+                Success = false;
+                FreeCommandChain(Chain);
+                goto End;
+            }
+        } break;
         case '?': {
             Success = false;
             FreeCommandChain(Chain);
@@ -652,11 +666,12 @@ End:
     return Success;
 }
 
-void CommandCallback(int SockFD, const char *Type, const char *Message)
+bool CommandCallback(int SockFD, const char *Type, const char *Message)
 {
+    bool Success = false;
     if (StringEquals(Type, "query")) {
         command Chain = {};
-        bool Success = ParseQueryCommand(Message, &Chain);
+        Success = ParseQueryCommand(Message, &Chain);
         if (Success) {
             command *Command = &Chain;
             while ((Command = Command->Next)) {
@@ -668,12 +683,12 @@ void CommandCallback(int SockFD, const char *Type, const char *Message)
         }
     } else if (StringEquals(Type, "rule")) {
         window_rule Rule = {};
-        if (ParseRuleCommand(Message, &Rule)) {
+        if ((Success = ParseRuleCommand(Message, &Rule))) {
             AddWindowRule(&Rule);
         }
     } else if (StringEquals(Type, "window")) {
         command Chain = {};
-        bool Success = ParseWindowCommand(Message, &Chain);
+        Success = ParseWindowCommand(Message, &Chain);
         if (Success) {
             float Ratio = CVarFloatingPointValue(CVAR_BSP_SPLIT_RATIO);
             command *Command = &Chain;
@@ -690,7 +705,7 @@ void CommandCallback(int SockFD, const char *Type, const char *Message)
         }
     } else if (StringEquals(Type, "desktop")) {
         command Chain = {};
-        bool Success = ParseSpaceCommand(Message, &Chain);
+        Success = ParseSpaceCommand(Message, &Chain);
         if (Success) {
             command *Command = &Chain;
             while ((Command = Command->Next)) {
@@ -702,7 +717,7 @@ void CommandCallback(int SockFD, const char *Type, const char *Message)
         }
     } else if (StringEquals(Type, "monitor")) {
         command Chain = {};
-        bool Success = ParseMonitorCommand(Message, &Chain);
+        Success = ParseMonitorCommand(Message, &Chain);
         if (Success) {
             command *Command = &Chain;
             while ((Command = Command->Next)) {
@@ -715,4 +730,6 @@ void CommandCallback(int SockFD, const char *Type, const char *Message)
     } else {
         c_log(C_LOG_LEVEL_WARN, "chunkwm-tiling: no match for '%s %s'\n", Type, Message);
     }
+
+    return Success;
 }
@@ -1,6 +1,6 @@
 #ifndef PLUGIN_CONFIG_H
 #define PLUGIN_CONFIG_H
 
-void CommandCallback(int SockFD, const char *Type, const char *Message);
+bool CommandCallback(int SockFD, const char *Type, const char *Message);
 
 #endif
@@ -11,12 +11,16 @@
 #define _CVAR_SPACE_OFFSET_GAP      "desktop_offset_gap"
 #define _CVAR_SPACE_TREE            "desktop_tree"
 
-#define CVAR_SPACE_MODE             "global_" _CVAR_SPACE_MODE
-#define CVAR_SPACE_OFFSET_TOP       "global_" _CVAR_SPACE_OFFSET_TOP
-#define CVAR_SPACE_OFFSET_BOTTOM    "global_" _CVAR_SPACE_OFFSET_BOTTOM
-#define CVAR_SPACE_OFFSET_LEFT      "global_" _CVAR_SPACE_OFFSET_LEFT
-#define CVAR_SPACE_OFFSET_RIGHT     "global_" _CVAR_SPACE_OFFSET_RIGHT
-#define CVAR_SPACE_OFFSET_GAP       "global_" _CVAR_SPACE_OFFSET_GAP
+#define CVAR_SPACE_GLOBAL_PREFIX    "global_"
+#define CVAR_SPACE_MODE             CVAR_SPACE_GLOBAL_PREFIX _CVAR_SPACE_MODE
+#define CVAR_SPACE_OFFSET_TOP       CVAR_SPACE_GLOBAL_PREFIX _CVAR_SPACE_OFFSET_TOP
+#define CVAR_SPACE_OFFSET_BOTTOM    CVAR_SPACE_GLOBAL_PREFIX _CVAR_SPACE_OFFSET_BOTTOM
+#define CVAR_SPACE_OFFSET_LEFT      CVAR_SPACE_GLOBAL_PREFIX _CVAR_SPACE_OFFSET_LEFT
+#define CVAR_SPACE_OFFSET_RIGHT     CVAR_SPACE_GLOBAL_PREFIX _CVAR_SPACE_OFFSET_RIGHT
+#define CVAR_SPACE_OFFSET_GAP       CVAR_SPACE_GLOBAL_PREFIX _CVAR_SPACE_OFFSET_GAP
+
+#define CVAR_SPACE_GLOBAL_WATCH     CVAR_SPACE_GLOBAL_PREFIX "desktop_"
+#define CVAR_SPACE_DESKTOP_WATCH    "#_desktop_"
 
 #define CVAR_PADDING_STEP_SIZE      "desktop_padding_step_size"
 #define CVAR_GAP_STEP_SIZE          "desktop_gap_step_size"
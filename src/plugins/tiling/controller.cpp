@@ -6,7 +6,9 @@
 #include "../../common/accessibility/element.h"
 #include "../../common/config/cvar.h"
 #include "../../common/ipc/daemon.h"
+#include "../../common/ipc/extdock.h"
 #include "../../common/misc/assert.h"
+#include "../../common/misc/json.h"
 
 #include "presel.h"
 #include "region.h"
@@ -17,6 +19,7 @@
 
 #include <math.h>
 #include <vector>
+#include <map>
 
 #define internal static
 
@@ -32,6 +35,7 @@ extern void UntileWindow(macos_window *Window);
 extern void UntileWindowFromSpace(macos_window *Window, macos_space *Space, virtual_space *VirtualSpace);
 extern bool IsWindowValid(macos_window *Window);
 extern void BroadcastFocusedWindowFloating(int Status);
+extern std::map<uint32_t, macos_window *> CopyWindowCache();
 
 internal bool
 IsCursorInRegion(region *Region)
@@ -613,37 +617,19 @@ void TemporaryRatio(char *Ratio)
 
 void ExtendedDockSetWindowPosition(uint32_t WindowId, int X, int Y)
 {
-    int SockFD;
-    if (ConnectToDaemon(&SockFD, 5050)) {
-        char Message[64];
-        sprintf(Message, "window_move %d %d %d", WindowId, X, Y);
-        WriteToSocket(Message, SockFD);
-    }
-    CloseSocket(SockFD);
+    ExtendedDockCommand("window_move %d %d %d", WindowId, X, Y);
 }
 
 internal void
 ExtendedDockSetWindowLevel(macos_window *Window, int WindowLevelKey)
 {
-    int SockFD;
-    if (ConnectToDaemon(&SockFD, 5050)) {
-        char Message[64];
-        sprintf(Message, "window_level %d %d", Window->Id, WindowLevelKey);
-        WriteToSocket(Message, SockFD);
-    }
-    CloseSocket(SockFD);
+    ExtendedDockCommand("window_level %d %d", Window->Id, WindowLevelKey);
 }
 
 internal void
 ExtendedDockSetWindowSticky(macos_window *Window, int Value)
 {
-    int SockFD;
-    if (ConnectToDaemon(&SockFD, 5050)) {
-        char Message[64];
-        sprintf(Message, "window_sticky %d %d", Window->Id, Value);
-        WriteToSocket(Message, SockFD);
-    }
-    CloseSocket(SockFD);
+    ExtendedDockCommand("window_sticky %d %d", Window->Id, Value);
 }
 
 void FloatWindow(macos_window *Window)
@@ -2241,3 +2227,258 @@ void QueryMonitorForDesktop(char *Op, int SockFD)
         WriteToSocket(Message, SockFD);
     }
 }
+
+internal void
+SnapshotRegion(json_writer *Writer, const char *Key, region *Region)
+{
+    JsonBeginObject(Writer, Key);
+    JsonNumber(Writer, "x", Region->X);
+    JsonNumber(Writer, "y", Region->Y);
+    JsonNumber(Writer, "w", Region->Width);
+    JsonNumber(Writer, "h", Region->Height);
+    JsonEndObject(Writer);
+}
+
+internal void
+SnapshotNode(json_writer *Writer, const char *Key, node *Node, node *Tree)
+{
+    JsonBeginObject(Writer, Key);
+    SnapshotRegion(Writer, "region", &Node->Region);
+
+    if (IsLeafNode(Node)) {
+        if ((Node->WindowId) && (Node->WindowId != Node_PseudoLeaf)) {
+            JsonInteger(Writer, "window", Node->WindowId);
+        } else {
+            JsonNull(Writer, "window");
+        }
+
+        if (Tree->Zoom == Node) {
+            JsonString(Writer, "zoom", "fullscreen");
+        } else if (Node->Parent && Node->Parent->Zoom == Node) {
+            JsonString(Writer, "zoom", "parent");
+        }
+    } else {
+        JsonString(Writer, "split", node_split_str[Node->Split]);
+        JsonNumber(Writer, "ratio", Node->Ratio);
+        SnapshotNode(Writer, "left", Node->Left, Tree);
+        SnapshotNode(Writer, "right", Node->Right, Tree);
+    }
+
+    JsonEndObject(Writer);
+}
+
+internal void
+SnapshotVirtualSpace(json_writer *Writer, macos_space *Space)
+{
+    virtual_space *VirtualSpace = AcquireVirtualSpace(Space);
+    JsonString(Writer, "mode", virtual_space_mode_str[VirtualSpace->Mode]);
+
+    JsonBeginObject(Writer, "offset");
+    JsonNumber(Writer, "top", VirtualSpace->Offset->Top);
+    JsonNumber(Writer, "bottom", VirtualSpace->Offset->Bottom);
+    JsonNumber(Writer, "left", VirtualSpace->Offset->Left);
+    JsonNumber(Writer, "right", VirtualSpace->Offset->Right);
+    JsonNumber(Writer, "gap", VirtualSpace->Offset->Gap);
+    JsonEndObject(Writer);
+
+    if (!VirtualSpace->Tree) {
+        JsonNull(Writer, "tree");
+    } else if (VirtualSpace->Mode == Virtual_Space_Bsp) {
+        SnapshotNode(Writer, "tree", VirtualSpace->Tree, VirtualSpace->Tree);
+    } else if (VirtualSpace->Mode == Virtual_Space_Monocle) {
+        // NOTE(koekeishiya): Monocle spaces are a list of nodes linked through Right.
+        JsonBeginArray(Writer, "tree");
+        for (node *Node = VirtualSpace->Tree; Node; Node = Node->Right) {
+            JsonInteger(Writer, NULL, Node->WindowId);
+        }
+        JsonEndArray(Writer);
+    } else {
+        JsonNull(Writer, "tree");
+    }
+
+    ReleaseVirtualSpace(VirtualSpace);
+}
+
+internal inline const char *
+SnapshotSpaceType(macos_space *Space)
+{
+    switch (Space->Type) {
+    case kCGSSpaceUser:       return "user";       break;
+    case kCGSSpaceFullscreen: return "fullscreen"; break;
+    default:                  return "system";     break;
+    }
+}
+
+internal void
+SnapshotWindow(json_writer *Writer, macos_window *Window)
+{
+    char *Mainrole = Window->Mainrole ? CopyCFStringToC(Window->Mainrole) : NULL;
+    char *Subrole = Window->Subrole ? CopyCFStringToC(Window->Subrole) : NULL;
+
+    JsonBeginObject(Writer, NULL);
+    JsonInteger(Writer, "id", Window->Id);
+    JsonInteger(Writer, "pid", Window->Owner->PID);
+    JsonString(Writer, "owner", Window->Owner->Name);
+    JsonString(Writer, "name", Window->Name);
+    JsonString(Writer, "role", Mainrole);
+    JsonString(Writer, "subrole", Subrole);
+    JsonInteger(Writer, "level", Window->Level);
+
+    JsonBeginObject(Writer, "frame");
+    JsonNumber(Writer, "x", Window->Position.x);
+    JsonNumber(Writer, "y", Window->Position.y);
+    JsonNumber(Writer, "w", Window->Size.width);
+    JsonNumber(Writer, "h", Window->Size.height);
+    JsonEndObject(Writer);
+
+    JsonBool(Writer, "float", AXLibHasFlags(Window, Window_Float));
+    JsonBool(Writer, "sticky", AXLibHasFlags(Window, Window_Sticky));
+    JsonBool(Writer, "minimized", AXLibHasFlags(Window, Window_Minimized));
+    JsonBool(Writer, "movable", AXLibHasFlags(Window, Window_Movable));
+    JsonBool(Writer, "resizable", AXLibHasFlags(Window, Window_Resizable));
+    JsonBool(Writer, "valid", IsWindowValid(Window));
+    JsonEndObject(Writer);
+
+    if (Subrole)  { free(Subrole); }
+    if (Mainrole) { free(Mainrole); }
+}
+
+/*
+ * NOTE(koekeishiya): Desktop ids are assigned in mission-control order, which is the
+ * order of the monitor arrangement, skipping spaces that are not user-created. We keep
+ * count ourselves instead of translating every space through the window server.
+ */
+internal void
+SnapshotMonitors(json_writer *Writer, CGSSpaceID FocusedSpaceId,
+                 unsigned *FocusedMonitorId, unsigned *FocusedDesktopId)
+{
+    unsigned DesktopId = 1;
+    unsigned DisplayCount = AXLibDisplayCount();
+
+    JsonBeginArray(Writer, "monitors");
+    for (unsigned Arrangement = 0; Arrangement < DisplayCount; ++Arrangement) {
+        CFStringRef DisplayRef = AXLibGetDisplayIdentifierFromArrangement(Arrangement);
+        if (!DisplayRef) continue;
+
+        char *DisplayCRef = CopyCFStringToC(DisplayRef);
+        CGRect Bounds = AXLibGetDisplayBounds(DisplayRef);
+        CGSSpaceID ActiveSpaceId = AXLibActiveCGSSpaceID(DisplayRef);
+
+        JsonBeginObject(Writer, NULL);
+        JsonInteger(Writer, "id", Arrangement + 1);
+        JsonString(Writer, "uuid", DisplayCRef);
+
+        JsonBeginObject(Writer, "frame");
+        JsonNumber(Writer, "x", Bounds.origin.x);
+        JsonNumber(Writer, "y", Bounds.origin.y);
+        JsonNumber(Writer, "w", Bounds.size.width);
+        JsonNumber(Writer, "h", Bounds.size.height);
+        JsonEndObject(Writer);
+
+        JsonBeginArray(Writer, "desktops");
+        macos_space *Space, **List, **Spaces;
+        List = Spaces = AXLibSpacesForDisplay(DisplayRef);
+        while (List && (Space = *List++)) {
+            bool Active = (Space->Id == ActiveSpaceId);
+            bool User = (Space->Type == kCGSSpaceUser);
+
+            JsonBeginObject(Writer, NULL);
+            if (Space->Id == FocusedSpaceId) {
+                *FocusedMonitorId = Arrangement + 1;
+                *FocusedDesktopId = User ? DesktopId : 0;
+            }
+
+            if (User) {
+                JsonInteger(Writer, "id", DesktopId++);
+            } else {
+                JsonNull(Writer, "id");
+            }
+            JsonInteger(Writer, "space", Space->Id);
+            JsonString(Writer, "type", SnapshotSpaceType(Space));
+            JsonBool(Writer, "active", Active);
+
+            if (User) {
+                SnapshotVirtualSpace(Writer, Space);
+            }
+
+            if (Active) {
+                std::vector<uint32_t> Windows = GetAllVisibleWindowsForSpace(Space, true, true);
+                JsonBeginArray(Writer, "windows");
+                for (size_t Index = 0; Index < Windows.size(); ++Index) {
+                    JsonInteger(Writer, NULL, Windows[Index]);
+                }
+                JsonEndArray(Writer);
+            }
+
+            JsonEndObject(Writer);
+            AXLibDestroySpace(Space);
+        }
+        JsonEndArray(Writer);
+        JsonEndObject(Writer);
+
+        if (Spaces) free(Spaces);
+        free(DisplayCRef);
+        CFRelease(DisplayRef);
+    }
+    JsonEndArray(Writer);
+}
+
+/*
+ * NOTE(koekeishiya): Writes the state of every monitor, desktop and window that we know
+ * of as a single JSON document. The document is versioned through SNAPSHOT_VERSION, and
+ * fields are only ever added within a version. The list of visible windows is only
+ * included for desktops that are active, as the window server does not report windows
+ * of other desktops without a round-trip per window.
+ */
+void QuerySnapshot(char *Op, int SockFD)
+{
+    if (!StringEquals(Op, "json")) return;
+
+    json_writer Writer;
+    BeginJsonWriter(&Writer, SockFD);
+
+    JsonBeginObject(&Writer, NULL);
+    JsonInteger(&Writer, "version", SNAPSHOT_VERSION);
+
+    macos_space *FocusedSpace;
+    CGSSpaceID FocusedSpaceId = 0;
+    if (AXLibActiveSpace(&FocusedSpace)) {
+        FocusedSpaceId = FocusedSpace->Id;
+        AXLibDestroySpace(FocusedSpace);
+    }
+
+    unsigned FocusedMonitorId = 0;
+    unsigned FocusedDesktopId = 0;
+    SnapshotMonitors(&Writer, FocusedSpaceId, &FocusedMonitorId, &FocusedDesktopId);
+
+    JsonBeginObject(&Writer, "focus");
+    if (FocusedMonitorId) {
+        JsonInteger(&Writer, "monitor", FocusedMonitorId);
+    } else {
+        JsonNull(&Writer, "monitor");
+    }
+
+    if (FocusedDesktopId) {
+        JsonInteger(&Writer, "desktop", FocusedDesktopId);
+    } else {
+        JsonNull(&Writer, "desktop");
+    }
+
+    macos_window *FocusedWindow = GetFocusedWindow();
+    if (FocusedWindow) {
+        JsonInteger(&Writer, "window", FocusedWindow->Id);
+    } else {
+        JsonNull(&Writer, "window");
+    }
+    JsonEndObject(&Writer);
+
+    JsonBeginArray(&Writer, "windows");
+    std::map<uint32_t, macos_window *> Windows = CopyWindowCache();
+    for (std::map<uint32_t, macos_window *>::iterator It = Windows.begin(); It != Windows.end(); ++It) {
+        SnapshotWindow(&Writer, It->second);
+    }
+    JsonEndArray(&Writer);
+
+    JsonEndObject(&Writer);
+    EndJsonWriter(&Writer);
+}
@@ -51,4 +51,7 @@ void QueryMonitor(char *Op, int SockFD);
 void QueryDesktopsForMonitor(char *Op, int SockFD);
 void QueryMonitorForDesktop(char *Op, int SockFD);
 
+#define SNAPSHOT_VERSION 1
+void QuerySnapshot(char *Op, int SockFD);
+
 #endif
@@ -5,6 +5,7 @@
 #include "../../common/border/border.h"
 #include "../../common/config/cvar.h"
 #include "../../common/config/tokenize.h"
+#include "../../common/ipc/extdock.h"
 #include "../../common/misc/assert.h"
 
 #include "node.h"
@@ -216,6 +217,7 @@ LeftMouseDragged()
                 ExtendedDockSetWindowPosition(ResizeState.Window->Id,
                                               (int)(ResizeState.InitialRatioH + DeltaX),
                                               (int)(ResizeState.InitialRatioV + DeltaY));
+                ExtendedDockFlush();
             } else {
                 AXLibSetWindowPosition(ResizeState.Window->Ref,
                                        (int)(ResizeState.InitialRatioH + DeltaX),
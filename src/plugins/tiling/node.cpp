@@ -17,6 +17,18 @@
 
 extern macos_window *GetWindowByID(uint32_t Id);
 
+// NOTE(koekeishiya): Read for every node that is created, so we only look them up once.
+internal cvar_handle OptimalRatioCVar;
+internal cvar_handle SplitRatioCVar;
+internal cvar_handle SpawnLeftCVar;
+
+void ResolveNodeCVars()
+{
+    OptimalRatioCVar = CVarHandle(CVAR_BSP_OPTIMAL_RATIO);
+    SplitRatioCVar = CVarHandle(CVAR_BSP_SPLIT_RATIO);
+    SpawnLeftCVar = CVarHandle(CVAR_BSP_SPAWN_LEFT);
+}
+
 node_ids AssignNodeIds(uint32_t ExistingId, uint32_t NewId, bool SpawnLeft)
 {
     node_ids NodeIds;
@@ -32,7 +44,7 @@ node_ids AssignNodeIds(uint32_t ExistingId, uint32_t NewId, bool SpawnLeft)
 
 node_split OptimalSplitMode(node *Node)
 {
-    float OptimalRatio = CVarFloatingPointValue(CVAR_BSP_OPTIMAL_RATIO);
+    float OptimalRatio = CVarFloatingPointValue(OptimalRatioCVar);
     float NodeRatio = Node->Region.Width / Node->Region.Height;
     return NodeRatio >= OptimalRatio ? Split_Vertical : Split_Horizontal;
 }
@@ -55,7 +67,7 @@ node *CreateRootNode(uint32_t WindowId, macos_space *Space, virtual_space *Virtu
     Node->WindowId = WindowId;
     CreateNodeRegion(Node, Region_Full, Space, VirtualSpace);
     Node->Split = OptimalSplitMode(Node);
-    Node->Ratio = CVarFloatingPointValue(CVAR_BSP_SPLIT_RATIO);
+    Node->Ratio = CVarFloatingPointValue(SplitRatioCVar);
 
     return Node;
 }
@@ -70,7 +82,7 @@ node *CreateLeafNode(node *Parent, uint32_t WindowId, region_type Type,
     Node->WindowId = WindowId;
     CreateNodeRegion(Node, Type, Space, VirtualSpace);
     Node->Split = OptimalSplitMode(Node);
-    Node->Ratio = CVarFloatingPointValue(CVAR_BSP_SPLIT_RATIO);
+    Node->Ratio = CVarFloatingPointValue(SplitRatioCVar);
 
     return Node;
 }
@@ -80,9 +92,9 @@ void CreateLeafNodePair(node *Parent, uint32_t ExistingWindowId, uint32_t Spawne
 {
     Parent->WindowId = Node_Root;
     Parent->Split = Split;
-    Parent->Ratio = CVarFloatingPointValue(CVAR_BSP_SPLIT_RATIO);
+    Parent->Ratio = CVarFloatingPointValue(SplitRatioCVar);
 
-    int SpawnLeft = CVarIntegerValue(CVAR_BSP_SPAWN_LEFT);
+    int SpawnLeft = CVarIntegerValue(SpawnLeftCVar);
     node_ids NodeIds = AssignNodeIds(ExistingWindowId, SpawnedWindowId, SpawnLeft);
 
     ASSERT(Split == Split_Vertical || Split == Split_Horizontal);
@@ -729,7 +741,7 @@ node *DeserializeNodeFromBuffer(char *Buffer)
 
             Leaf->WindowId = Node_PseudoLeaf;
             Leaf->Parent = Current;
-            Leaf->Ratio = CVarFloatingPointValue(CVAR_BSP_SPLIT_RATIO);
+            Leaf->Ratio = CVarFloatingPointValue(SplitRatioCVar);
             Current->Left = Leaf;
         } else if (TokenEquals(Token, "right_leaf")) {
             node *Leaf = (node *) malloc(sizeof(node));
@@ -737,7 +749,7 @@ node *DeserializeNodeFromBuffer(char *Buffer)
 
             Leaf->WindowId = Node_PseudoLeaf;
             Leaf->Parent = Current;
-            Leaf->Ratio = CVarFloatingPointValue(CVAR_BSP_SPLIT_RATIO);
+            Leaf->Ratio = CVarFloatingPointValue(SplitRatioCVar);
             Current->Right = Leaf;
 
             // NOTE(koekeishiya): After parsing a right-leaf, we are done with this node
@@ -78,6 +78,8 @@ inline equalize_node operator+(const equalize_node A, const equalize_node B)
              A.HorizontalCount + B.HorizontalCount };
 }
 
+void ResolveNodeCVars();
+
 node_ids AssignNodeIds(uint32_t ExistingId, uint32_t NewId, bool SpawnLeft);
 node_split OptimalSplitMode(node *Node);
 node_split NodeSplitFromString(char *Value);
@@ -15,8 +15,10 @@
 #include "../../common/config/cvar.h"
 #include "../../common/config/tokenize.h"
 #include "../../common/ipc/daemon.h"
+#include "../../common/ipc/extdock.h"
 #include "../../common/misc/carbon.h"
 #include "../../common/misc/workspace.h"
+#include "../../common/misc/json.h"
 #include "../../common/misc/assert.h"
 #include "../../common/border/border.h"
 
@@ -29,8 +31,10 @@
 #include "../../common/config/cvar.cpp"
 #include "../../common/config/tokenize.cpp"
 #include "../../common/ipc/daemon.cpp"
+#include "../../common/ipc/extdock.cpp"
 #include "../../common/misc/carbon.cpp"
 #include "../../common/misc/workspace.mm"
+#include "../../common/misc/json.cpp"
 #include "../../common/border/border.mm"
 
 #include "presel.h"
@@ -95,13 +99,7 @@ chunkwm_log *c_log;
 internal void
 ExtendedDockSetWindowAlpha(uint32_t WindowId, float Value, float Duration)
 {
-    int SockFD;
-    if (ConnectToDaemon(&SockFD, 5050)) {
-        char Message[64];
-        sprintf(Message, "window_alpha_fade %d %f %f", WindowId, Value, Duration);
-        WriteToSocket(Message, SockFD);
-    }
-    CloseSocket(SockFD);
+    ExtendedDockCommand("window_alpha_fade %d %f %f", WindowId, Value, Duration);
 }
 
 macos_window_map CopyWindowCache()
@@ -1469,47 +1467,85 @@ DisplayRemovedHandler(void *Data)
 }
 #endif
 
+/*
+ * NOTE(koekeishiya): Publish the number of windows and the layout of every visible desktop
+ * to the shared state page of chunkwm. Desktops that are not visible keep the values from
+ * when they were last visible. This is only done for events that can change these values.
+ */
 internal void
+PublishVisibleDesktops()
+{
+    unsigned DisplayCount = AXLibDisplayCount();
+    for (unsigned Arrangement = 0; Arrangement < DisplayCount; ++Arrangement) {
+        CFStringRef DisplayRef = AXLibGetDisplayIdentifierFromArrangement(Arrangement);
+        if (!DisplayRef) continue;
+
+        unsigned DesktopId;
+        macos_space *Space = AXLibActiveSpace(DisplayRef);
+        if ((Space->Type == kCGSSpaceUser) &&
+            (AXLibCGSSpaceIDToDesktopID(Space->Id, NULL, &DesktopId))) {
+            std::vector<uint32_t> Windows = GetAllVisibleWindowsForSpace(Space, false, true);
+
+            virtual_space *VirtualSpace = AcquireVirtualSpace(Space);
+            virtual_space_mode Mode = VirtualSpace->Mode;
+            ReleaseVirtualSpace(VirtualSpace);
+
+            API.PublishDesktop(DesktopId, Arrangement + 1, Windows.size(), virtual_space_mode_str[Mode]);
+        }
+
+        AXLibDestroySpace(Space);
+        CFRelease(DisplayRef);
+    }
+}
+
+internal bool
 ChunkwmDaemonCommandHandler(void *Data)
 {
     chunkwm_payload *Payload = (chunkwm_payload *) Data;
-    CommandCallback(Payload->SockFD, Payload->Command, Payload->Message);
+    bool Result = CommandCallback(Payload->SockFD, Payload->Command, Payload->Message);
+    if (Result && !StringEquals(Payload->Command, "query")) {
+        PublishVisibleDesktops();
+    }
+    return Result;
 }
 
-/*
- * NOTE(koekeishiya):
- * parameter: const char *Node
- * parameter: void *Data
- * return: bool
- */
-PLUGIN_MAIN_FUNC(PluginMain)
+internal bool
+HandleEvent(const char *Node, void *Data)
 {
     if (StringEquals(Node, "chunkwm_export_application_launched")) {
         ApplicationLaunchedHandler(Data);
+        PublishVisibleDesktops();
         return true;
     } else if (StringEquals(Node, "chunkwm_export_application_terminated")) {
         ApplicationTerminatedHandler(Data);
+        PublishVisibleDesktops();
         return true;
     } else if (StringEquals(Node, "chunkwm_export_application_hidden")) {
         ApplicationHiddenHandler(Data);
+        PublishVisibleDesktops();
         return true;
     } else if (StringEquals(Node, "chunkwm_export_application_unhidden")) {
         ApplicationUnhiddenHandler(Data);
+        PublishVisibleDesktops();
         return true;
     } else if (StringEquals(Node, "chunkwm_export_application_activated")) {
         ApplicationActivatedHandler(Data);
         return true;
     } else if (StringEquals(Node, "chunkwm_export_window_created")) {
         WindowCreatedHandler(Data);
+        PublishVisibleDesktops();
         return true;
     } else if (StringEquals(Node, "chunkwm_export_window_destroyed")) {
         WindowDestroyedHandler(Data);
+        PublishVisibleDesktops();
         return true;
     } else if(StringEquals(Node, "chunkwm_export_window_minimized")) {
         WindowMinimizedHandler(Data);
+        PublishVisibleDesktops();
         return true;
     } else if (StringEquals(Node, "chunkwm_export_window_deminimized")) {
         WindowDeminimizedHandler(Data);
+        PublishVisibleDesktops();
         return true;
     } else if (StringEquals(Node, "chunkwm_export_window_focused")) {
         WindowFocusedHandler(Data);
@@ -1526,6 +1562,7 @@ PLUGIN_MAIN_FUNC(PluginMain)
     } else if ((StringEquals(Node, "chunkwm_export_space_changed")) ||
                (StringEquals(Node, "chunkwm_export_display_changed"))) {
         SpaceAndDisplayChangedHandler(Data);
+        PublishVisibleDesktops();
         return true;
     } else if (StringEquals(Node, "chunkwm_export_display_resized")) {
         DisplayResizedHandler(Data);
@@ -1539,7 +1576,9 @@ PLUGIN_MAIN_FUNC(PluginMain)
         return true;
 #endif
     } else if (StringEquals(Node, "chunkwm_daemon_command")) {
-        ChunkwmDaemonCommandHandler(Data);
+        return ChunkwmDaemonCommandHandler(Data);
+    } else if (StringEquals(Node, "chunkwm_cvar_changed")) {
+        VirtualSpaceConfigChanged();
         return true;
     } else if (StringEquals(Node, "chunkwm_events_subscribed")) {
         /* NOTE(koekeishiya): Tile windows visible on the current space using configured mode */
@@ -1548,12 +1587,30 @@ PLUGIN_MAIN_FUNC(PluginMain)
         /* NOTE(koekeishiya): Set our initial insertion-point on launch. */
         uint32_t WindowId = GetFocusedWindowId();
         if (WindowId) WindowFocusedHandler(WindowId);
+
+        PublishVisibleDesktops();
         return true;
     }
 
     return false;
 }
 
+/*
+ * NOTE(koekeishiya):
+ * parameter: const char *Node
+ * parameter: void *Data
+ * return: bool
+ *
+ * Commands for the extended dock that were issued while handling the
+ * event are sent together, once the event has been handled.
+ */
+PLUGIN_MAIN_FUNC(PluginMain)
+{
+    bool Result = HandleEvent(Node, Data);
+    ExtendedDockFlush();
+    return Result;
+}
+
 internal bool
 Init(chunkwm_api ChunkwmAPI)
 {
@@ -1571,6 +1628,9 @@ Init(chunkwm_api ChunkwmAPI)
     Success = (pthread_mutex_init(&WindowsLock, NULL) == 0);
     if (!Success) goto out;
 
+    Success = BeginExtendedDock(EXTENDED_DOCK_PORT);
+    if (!Success) goto out;
+
 
     EventTap.Mask = ((1 << kCGEventLeftMouseDown) |
                      (1 << kCGEventLeftMouseDragged) |
@@ -1588,6 +1648,9 @@ Init(chunkwm_api ChunkwmAPI)
     CreateCVar(CVAR_SPACE_OFFSET_RIGHT, 50.0f);
     CreateCVar(CVAR_SPACE_OFFSET_GAP, 20.0f);
 
+    WatchCVarPrefix(PluginName, CVAR_SPACE_GLOBAL_WATCH);
+    WatchCVarPrefix(PluginName, CVAR_SPACE_DESKTOP_WATCH);
+
     CreateCVar(CVAR_PADDING_STEP_SIZE, 10.0f);
     CreateCVar(CVAR_GAP_STEP_SIZE, 5.0f);
 
@@ -1601,6 +1664,7 @@ Init(chunkwm_api ChunkwmAPI)
     CreateCVar(CVAR_BSP_OPTIMAL_RATIO, 1.618f);
     CreateCVar(CVAR_BSP_SPLIT_RATIO, 0.5f);
     CreateCVar(CVAR_BSP_SPLIT_MODE, node_split_str[Split_Optimal]);
+    ResolveNodeCVars();
 
     CreateCVar(CVAR_MONITOR_FOCUS_CYCLE, 0);
     CreateCVar(CVAR_WINDOW_FOCUS_CYCLE, "none");
@@ -1650,12 +1714,14 @@ Init(chunkwm_api ChunkwmAPI)
     Success = BeginVirtualSpaces();
     if (Success) {
         SetMouseModifier(CVarStringValue(CVAR_MOUSE_MODIFIER));
+        ExtendedDockFlush();
         goto out;
     }
 
     c_log(C_LOG_LEVEL_ERROR, "chunkwm-tiling: failed to initialize virtual space system!\n");
 
     EndEventTap(&EventTap);
+    EndExtendedDock();
     ClearApplicationCache();
     ClearWindowCache();
 
@@ -1667,6 +1733,7 @@ internal void
 Deinit()
 {
     EndEventTap(&EventTap);
+    EndExtendedDock();
 
     ClearApplicationCache();
     ClearWindowCache();
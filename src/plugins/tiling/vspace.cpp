@@ -9,6 +9,7 @@
 #include "../../common/config/cvar.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 
 #define internal static
@@ -17,6 +18,9 @@
 internal virtual_space_map VirtualSpaces;
 internal pthread_mutex_t VirtualSpacesLock;
 
+internal virtual_space_config_table ConfigTable;
+internal pthread_mutex_t ConfigTableLock;
+
 internal virtual_space_mode
 VirtualSpaceModeFromString(char *Value)
 {
@@ -29,39 +33,111 @@ VirtualSpaceModeFromString(char *Value)
     return Virtual_Space_Bsp;
 }
 
+internal void
+SetVirtualSpaceConfigField(virtual_space_config *Config, const char *Key, cvar_snapshot_entry *Entry)
+{
+    if (strcmp(Key, _CVAR_SPACE_MODE) == 0) {
+        Config->Mode = VirtualSpaceModeFromString((char *) Entry->String);
+    } else if (strcmp(Key, _CVAR_SPACE_OFFSET_TOP) == 0) {
+        Config->Offset.Top = CVarFloatingPointValue(Entry);
+    } else if (strcmp(Key, _CVAR_SPACE_OFFSET_BOTTOM) == 0) {
+        Config->Offset.Bottom = CVarFloatingPointValue(Entry);
+    } else if (strcmp(Key, _CVAR_SPACE_OFFSET_LEFT) == 0) {
+        Config->Offset.Left = CVarFloatingPointValue(Entry);
+    } else if (strcmp(Key, _CVAR_SPACE_OFFSET_RIGHT) == 0) {
+        Config->Offset.Right = CVarFloatingPointValue(Entry);
+    } else if (strcmp(Key, _CVAR_SPACE_OFFSET_GAP) == 0) {
+        Config->Offset.Gap = CVarFloatingPointValue(Entry);
+    } else if (strcmp(Key, _CVAR_SPACE_TREE) == 0) {
+        Config->TreeLayout = (char *) Entry->String;
+    }
+}
+
+// NOTE(koekeishiya): Returns the desktop index of a '<index>_desktop_*' cvar, and points Key past the index.
+internal bool
+ParseDesktopCVarName(const char *Name, unsigned *DesktopId, const char **Key)
+{
+    char *End;
+    unsigned long Value = strtoul(Name, &End, 10);
+    if ((End == Name) || (*End != '_') || (Value > VIRTUAL_SPACE_MAX_DESKTOP_ID)) {
+        return false;
+    }
+
+    *DesktopId = (unsigned) Value;
+    *Key = End + 1;
+    return true;
+}
+
+/*
+ * NOTE(koekeishiya): Rebuild the per-desktop configuration from a single snapshot of every
+ * cvar, so that we never combine values from before and after a cvar was changed. Global
+ * values are applied first, such that the order of the snapshot does not matter. Strings
+ * in the table point into the snapshot, which is kept until the next rebuild.
+ * Caller must hold ConfigTableLock.
+ */
+internal void
+RebuildVirtualSpaceConfigTable()
+{
+    virtual_space_config_table *Table = &ConfigTable;
+    Table->Stale = false;
+    ReleaseCVarSnapshot(&Table->Snapshot);
+    AcquireCVarPrefixSnapshot("", &Table->Snapshot);
+
+    virtual_space_config Global = {};
+    unsigned DesktopCount = 0;
+
+    size_t GlobalLength = strlen(CVAR_SPACE_GLOBAL_PREFIX);
+    for (unsigned Index = 0; Index < Table->Snapshot.Count; ++Index) {
+        cvar_snapshot_entry *Entry = &Table->Snapshot.Entries[Index];
+
+        unsigned DesktopId;
+        const char *Key;
+        if (strncmp(Entry->Name, CVAR_SPACE_GLOBAL_PREFIX, GlobalLength) == 0) {
+            SetVirtualSpaceConfigField(&Global, Entry->Name + GlobalLength, Entry);
+        } else if ((ParseDesktopCVarName(Entry->Name, &DesktopId, &Key)) &&
+                   (DesktopId >= DesktopCount)) {
+            DesktopCount = DesktopId + 1;
+        }
+    }
+
+    // NOTE(koekeishiya): There is no global tree layout.
+    Global.TreeLayout = NULL;
+
+    Table->Global = Global;
+    Table->Desktops.assign(DesktopCount, Global);
+
+    for (unsigned Index = 0; Index < Table->Snapshot.Count; ++Index) {
+        cvar_snapshot_entry *Entry = &Table->Snapshot.Entries[Index];
+
+        unsigned DesktopId;
+        const char *Key;
+        if (ParseDesktopCVarName(Entry->Name, &DesktopId, &Key)) {
+            SetVirtualSpaceConfigField(&Table->Desktops[DesktopId], Key, Entry);
+        }
+    }
+}
+
+/*
+ * NOTE(koekeishiya): The table is only rebuilt if a desktop cvar has changed since it was last
+ * built; the cvars that the plugin keeps writing, such as the focused window, do not count.
+ * The tree layout is copied, because the table may be rebuilt while the virtual space exists.
+ */
 internal virtual_space_config
 GetVirtualSpaceConfig(unsigned SpaceIndex)
 {
-    virtual_space_config Config;
-
-    char KeyMode[BUFFER_SIZE];
-    snprintf(KeyMode, BUFFER_SIZE, "%d_%s", SpaceIndex, _CVAR_SPACE_MODE);
-    Config.Mode = CVarExists(KeyMode) ? VirtualSpaceModeFromString(CVarStringValue(KeyMode))
-                                      : VirtualSpaceModeFromString(CVarStringValue(CVAR_SPACE_MODE));
-    char KeyTop[BUFFER_SIZE];
-    snprintf(KeyTop, BUFFER_SIZE, "%d_%s", SpaceIndex, _CVAR_SPACE_OFFSET_TOP);
-    Config.Offset.Top = CVarExists(KeyTop) ? CVarFloatingPointValue(KeyTop)
-                                           : CVarFloatingPointValue(CVAR_SPACE_OFFSET_TOP);
-    char KeyBottom[BUFFER_SIZE];
-    snprintf(KeyBottom, BUFFER_SIZE, "%d_%s", SpaceIndex, _CVAR_SPACE_OFFSET_BOTTOM);
-    Config.Offset.Bottom = CVarExists(KeyBottom) ? CVarFloatingPointValue(KeyBottom)
-                                                 : CVarFloatingPointValue(CVAR_SPACE_OFFSET_BOTTOM);
-    char KeyLeft[BUFFER_SIZE];
-    snprintf(KeyLeft, BUFFER_SIZE, "%d_%s", SpaceIndex, _CVAR_SPACE_OFFSET_LEFT);
-    Config.Offset.Left = CVarExists(KeyLeft) ? CVarFloatingPointValue(KeyLeft)
-                                             : CVarFloatingPointValue(CVAR_SPACE_OFFSET_LEFT);
-    char KeyRight[BUFFER_SIZE];
-    snprintf(KeyRight, BUFFER_SIZE, "%d_%s", SpaceIndex, _CVAR_SPACE_OFFSET_RIGHT);
-    Config.Offset.Right = CVarExists(KeyRight) ? CVarFloatingPointValue(KeyRight)
-                                               : CVarFloatingPointValue(CVAR_SPACE_OFFSET_RIGHT);
-    char KeyGap[BUFFER_SIZE];
-    snprintf(KeyGap, BUFFER_SIZE, "%d_%s", SpaceIndex, _CVAR_SPACE_OFFSET_GAP);
-    Config.Offset.Gap = CVarExists(KeyGap) ? CVarFloatingPointValue(KeyGap)
-                                           : CVarFloatingPointValue(CVAR_SPACE_OFFSET_GAP);
-    char KeyTree[BUFFER_SIZE];
-    snprintf(KeyTree, BUFFER_SIZE, "%d_%s", SpaceIndex, _CVAR_SPACE_TREE);
-    Config.TreeLayout = CVarExists(KeyTree) ? CVarStringValue(KeyTree)
-                                            : NULL;
+    pthread_mutex_lock(&ConfigTableLock);
+    if (ConfigTable.Stale) {
+        RebuildVirtualSpaceConfigTable();
+    }
+
+    virtual_space_config Config = SpaceIndex < ConfigTable.Desktops.size()
+                                ? ConfigTable.Desktops[SpaceIndex]
+                                : ConfigTable.Global;
+    if (Config.TreeLayout) {
+        Config.TreeLayout = strdup(Config.TreeLayout);
+    }
+    pthread_mutex_unlock(&ConfigTableLock);
+
     return Config;
 }
 
@@ -142,9 +218,19 @@ void ReleaseVirtualSpace(virtual_space *VirtualSpace)
     pthread_mutex_unlock(&VirtualSpace->Lock);
 }
 
+// NOTE(koekeishiya): Called when a watched desktop cvar has changed; see virtual_space_config_table.
+void VirtualSpaceConfigChanged()
+{
+    pthread_mutex_lock(&ConfigTableLock);
+    ConfigTable.Stale = true;
+    pthread_mutex_unlock(&ConfigTableLock);
+}
+
 bool BeginVirtualSpaces()
 {
-    return pthread_mutex_init(&VirtualSpacesLock, NULL) == 0;
+    ConfigTable.Stale = true;
+    return ((pthread_mutex_init(&VirtualSpacesLock, NULL) == 0) &&
+            (pthread_mutex_init(&ConfigTableLock, NULL) == 0));
 }
 
 void EndVirtualSpaces()
@@ -156,6 +242,10 @@ void EndVirtualSpaces()
             FreeNodeTree(VirtualSpace->Tree, VirtualSpace->Mode);
         }
 
+        if (VirtualSpace->TreeLayout) {
+            free(VirtualSpace->TreeLayout);
+        }
+
         pthread_mutex_destroy(&VirtualSpace->Lock);
         free(VirtualSpace);
         free((char *) It->first);
@@ -163,6 +253,10 @@ void EndVirtualSpaces()
 
     VirtualSpaces.clear();
     pthread_mutex_destroy(&VirtualSpacesLock);
+
+    ReleaseCVarSnapshot(&ConfigTable.Snapshot);
+    ConfigTable.Desktops.clear();
+    pthread_mutex_destroy(&ConfigTableLock);
 }
 
 void VirtualSpaceRecreateRegions(macos_space *Space, virtual_space *VirtualSpace)
@@ -4,9 +4,11 @@
 #include "region.h"
 
 #include "../../common/misc/string.h"
+#include "../../api/plugin_cvar.h"
 #include <stdint.h>
 #include <pthread.h>
 #include <map>
+#include <vector>
 
 static char *virtual_space_mode_str[] =
 {
@@ -28,6 +30,25 @@ struct virtual_space_config
     char *TreeLayout;
 };
 
+// NOTE(koekeishiya): Highest desktop index that we accept a '<index>_desktop_*' cvar for.
+#define VIRTUAL_SPACE_MAX_DESKTOP_ID 256
+
+/*
+ * NOTE(koekeishiya): Desktops[Index] is the configuration of the desktop with that mission-control
+ * index, with its overrides applied on top of the global values. Desktops without overrides that
+ * are past the end of the vector use Global.
+ *
+ * The table is Stale until it is first built, and again whenever the plugin is told that one of
+ * the 'global_desktop_*' or '<index>_desktop_*' cvars has changed.
+ */
+struct virtual_space_config_table
+{
+    virtual_space_config Global;
+    std::vector<virtual_space_config> Desktops;
+    cvar_snapshot Snapshot;
+    bool Stale;
+};
+
 enum virtual_space_flags
 {
     Virtual_Space_Require_Resize = 1 << 0,
@@ -60,6 +81,7 @@ void ReleaseVirtualSpace(virtual_space *VirtualSpace);
 
 void VirtualSpaceRecreateRegions(macos_space *Space, virtual_space *VirtualSpace);
 void VirtualSpaceUpdateRegions(virtual_space *VirtualSpace);
+void VirtualSpaceConfigChanged();
 
 bool BeginVirtualSpaces();
 void EndVirtualSpaces();
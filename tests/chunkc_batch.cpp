@@ -0,0 +1,174 @@
+#include "daemon_test.h"
+
+#include <libgen.h>
+#include <sys/wait.h>
+
+/*
+ * NOTE(koekeishiya): Startup cost of a config file. The same commands are sent once by a
+ * bash script that calls chunkc for every line, the way ~/.chunkwmrc does and is run by
+ * ForkExecWait, and once through 'chunkc --batch'. Both must produce the same output.
+ */
+#define CONFIG_COMMANDS 150
+#define CONFIG_ROUNDS   5
+
+static test_daemon Daemon;
+static char Chunkc[512];
+static char Directory[] = "/tmp/chunkwm_batch_XXXXXX";
+
+static const char *
+ConfigCommand(int Index, char *Buffer, size_t Size)
+{
+    switch (Index % 3) {
+    case 0: snprintf(Buffer, Size, "tiling::rule --owner App%d --state float", Index); break;
+    case 1: snprintf(Buffer, Size, "set %d_desktop_mode bsp", Index); break;
+    case 2: snprintf(Buffer, Size, "set window_gap %d", Index); break;
+    }
+
+    return Buffer;
+}
+
+static bool
+WriteConfigFiles(const char *Script, const char *Batch)
+{
+    FILE *ScriptFile = fopen(Script, "w");
+    FILE *BatchFile = fopen(Batch, "w");
+    if (!ScriptFile || !BatchFile) return false;
+
+    char Command[128];
+    fprintf(ScriptFile, "#!/bin/bash\n");
+    fprintf(BatchFile, "# the same commands as '%s'\n\n", Script);
+    for (int Index = 0; Index < CONFIG_COMMANDS; ++Index) {
+        ConfigCommand(Index, Command, sizeof(Command));
+        fprintf(ScriptFile, "\"%s\" %s\n", Chunkc, Command);
+        fprintf(BatchFile, "%s\n", Command);
+    }
+
+    fclose(ScriptFile);
+    fclose(BatchFile);
+    return true;
+}
+
+// NOTE(koekeishiya): Run a program with its output redirected, and return its exit status.
+static int
+RunProgram(const char *Argv[], const char *Output, const char *Error, uint64_t *Elapsed)
+{
+    fflush(stdout);
+    uint64_t Start = TestTime();
+
+    int Pid = fork();
+    if (Pid == 0) {
+        freopen(Output, "w", stdout);
+        freopen(Error, "w", stderr);
+        execvp(Argv[0], (char **) Argv);
+        _exit(127);
+    }
+
+    int Status = -1;
+    if (Pid > 0) {
+        waitpid(Pid, &Status, 0);
+    }
+
+    if (Elapsed) *Elapsed = TestTime() - Start;
+    return (Pid > 0 && WIFEXITED(Status)) ? WEXITSTATUS(Status) : -1;
+}
+
+static char *
+ReadFile(const char *Path)
+{
+    FILE *File = fopen(Path, "r");
+    if (!File) return NULL;
+
+    fseek(File, 0, SEEK_END);
+    long Length = ftell(File);
+    fseek(File, 0, SEEK_SET);
+
+    char *Result = (char *) malloc(Length + 1);
+    Result[fread(Result, 1, Length, File)] = '\0';
+    fclose(File);
+    return Result;
+}
+
+static void
+BenchmarkStartup()
+{
+    char Script[256], Batch[256], ScriptOutput[256], BatchOutput[256], Error[256];
+    snprintf(Script, sizeof(Script), "%s/chunkwmrc", Directory);
+    snprintf(Batch, sizeof(Batch), "%s/chunkwmrc.batch", Directory);
+    snprintf(ScriptOutput, sizeof(ScriptOutput), "%s/script.out", Directory);
+    snprintf(BatchOutput, sizeof(BatchOutput), "%s/batch.out", Directory);
+    snprintf(Error, sizeof(Error), "%s/error", Directory);
+    TEST_CHECK(WriteConfigFiles(Script, Batch));
+
+    const char *ScriptArgv[] = { "/bin/bash", "-c", Script, NULL };
+    const char *BatchArgv[] = { Chunkc, "--batch", Batch, NULL };
+    chmod(Script, 0700);
+
+    uint64_t ScriptBest = UINT64_MAX;
+    uint64_t BatchBest = UINT64_MAX;
+    for (int Round = 0; Round < CONFIG_ROUNDS; ++Round) {
+        uint64_t Elapsed;
+        TEST_CHECK(RunProgram(ScriptArgv, ScriptOutput, Error, &Elapsed) == 0);
+        if (Elapsed < ScriptBest) ScriptBest = Elapsed;
+
+        TEST_CHECK(RunProgram(BatchArgv, BatchOutput, Error, &Elapsed) == 0);
+        if (Elapsed < BatchBest) BatchBest = Elapsed;
+    }
+
+    printf("%d commands: chunkc per line %.1fms, chunkc --batch %.1fms\n",
+           CONFIG_COMMANDS, ScriptBest / 1e6, BatchBest / 1e6);
+
+    char *Expected = ReadFile(ScriptOutput);
+    char *Result = ReadFile(BatchOutput);
+    TEST_CHECK(Expected && Result && strcmp(Expected, Result) == 0);
+    TEST_CHECK(Expected && strstr(Expected, "echo:set window_gap 149\n"));
+    free(Expected);
+    free(Result);
+}
+
+// NOTE(koekeishiya): Failed commands are reported by line number, and do not stop the batch.
+static void
+TestFailure()
+{
+    char Batch[256], Output[256], Error[256];
+    snprintf(Batch, sizeof(Batch), "%s/failing.batch", Directory);
+    snprintf(Output, sizeof(Output), "%s/failing.out", Directory);
+    snprintf(Error, sizeof(Error), "%s/failing.err", Directory);
+
+    FILE *File = fopen(Batch, "w");
+    TEST_CHECK(File != NULL);
+    fprintf(File, "first\nfail\n\nlate\nlast");
+    fclose(File);
+
+    const char *Argv[] = { Chunkc, "--batch", Batch, NULL };
+    TEST_CHECK(RunProgram(Argv, Output, Error, NULL) == 1);
+
+    char *Result = ReadFile(Output);
+    char *Message = ReadFile(Error);
+    TEST_CHECK(Result && strcmp(Result, "echo:first\nfailed\nlate\necho:last\n") == 0);
+    TEST_CHECK(Message && strcmp(Message, "chunkc: line 2 failed: fail\n") == 0);
+    free(Result);
+    free(Message);
+}
+
+int main(int Argc, char **Argv)
+{
+    char Self[512];
+    snprintf(Self, sizeof(Self), "%s", Argv[0]);
+    snprintf(Chunkc, sizeof(Chunkc), "%s/chunkc", dirname(Self));
+    TEST_CHECK(access(Chunkc, X_OK) == 0);
+
+    TEST_CHECK(mkdtemp(Directory) != NULL);
+    TEST_CHECK(StartTestDaemon(&Daemon));
+    setenv("CHUNKC_SOCKET", Daemon.Path, 1);
+
+    BenchmarkStartup();
+    TestFailure();
+
+    StopDaemon();
+
+    char Command[512];
+    snprintf(Command, sizeof(Command), "rm -rf %s", Directory);
+    system(Command);
+
+    return TestResult("chunkc_batch");
+}
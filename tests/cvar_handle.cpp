@@ -0,0 +1,78 @@
+#include "cvar_test.h"
+
+/*
+ * NOTE(koekeishiya): A handle is resolved once and must keep working while the table grows.
+ * Reads through a handle are compared with reads by name, which hash the name and compare
+ * strings on every call.
+ */
+#define HANDLE_READS 20000000
+#define GROW_CVARS   2000
+
+static void
+TestHandles()
+{
+    CreateCVar("bsp_split_ratio", 0.5f);
+
+    cvar_handle Handle = CVarHandle("bsp_split_ratio");
+    TEST_CHECK(Handle != NULL);
+    TEST_CHECK(CVarHandle("missing") == NULL);
+    TEST_CHECK(CVarFloatingPointValue((cvar_handle) NULL) == 0.0f);
+
+    char Name[64];
+    uint32_t Capacity = CVars->Capacity;
+    for (int Index = 0; Index < GROW_CVARS; ++Index) {
+        snprintf(Name, sizeof(Name), "grow_%d", Index);
+        CreateCVar(Name, Index);
+    }
+    TEST_CHECK(CVars->Capacity > Capacity);
+
+    UpdateCVar("bsp_split_ratio", 0.25f);
+    TEST_CHECK(CVarHandle("bsp_split_ratio") == Handle);
+    TEST_CHECK(CVarFloatingPointValue(Handle) == 0.25f);
+    TEST_CHECK(CVarIntegerValue(Handle) == 0);
+
+    CreateCVar("window_gap", 12);
+    cvar_handle Gap = CVarHandle("window_gap");
+    TEST_CHECK(CVarIntegerValue(Gap) == 12);
+    TEST_CHECK(CVarFloatingPointValue(Gap) == 12.0f);
+}
+
+static void
+BenchmarkHandles()
+{
+    cvar_handle Handle = CVarHandle("bsp_split_ratio");
+    int Mismatch = 0;
+
+    uint64_t Start = TestTime();
+    for (int Index = 0; Index < HANDLE_READS; ++Index) {
+        if (CVarFloatingPointValue("bsp_split_ratio") != 0.25f) ++Mismatch;
+    }
+    uint64_t ByName = TestTime() - Start;
+
+    Start = TestTime();
+    for (int Index = 0; Index < HANDLE_READS; ++Index) {
+        if (CVarFloatingPointValue(Handle) != 0.25f) ++Mismatch;
+    }
+    uint64_t ByHandle = TestTime() - Start;
+
+    printf("by name %.1fM reads/s, by handle %.1fM reads/s\n",
+           HANDLE_READS * 1e3 / ByName, HANDLE_READS * 1e3 / ByHandle);
+    TEST_CHECK(Mismatch == 0);
+}
+
+int main()
+{
+    TEST_CHECK(BeginCVars());
+
+    char Name[64];
+    for (int Index = 0; Index < 100; ++Index) {
+        snprintf(Name, sizeof(Name), "plugin_option_%d", Index);
+        CreateCVar(Name, Index);
+    }
+
+    TestHandles();
+    BenchmarkHandles();
+
+    EndCVars();
+    return TestResult("cvar_handle");
+}
@@ -0,0 +1,42 @@
+#ifndef CHUNKWM_TESTS_CVAR_TEST_H
+#define CHUNKWM_TESTS_CVAR_TEST_H
+
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+#include "../src/api/plugin_api.h"
+#include "../src/core/cvar.h"
+#include "../src/core/dispatch/event.h"
+
+/*
+ * NOTE(koekeishiya): The cvar store, and the wrappers plugins use to reach it, with the
+ * function table filled in the same way as in plugin.cpp. Events are not dispatched; the
+ * names of changed cvars are collected in TestCVarEvents instead.
+ */
+chunkwm_api API = { UpdateCVarAPI, AcquireCVarAPI, FindCVarAPI, NULL, NULL, NULL,
+                    DeclareCVarAPI, AcquireCVarValueAPI, ResolveCVarAPI, AcquireCVarHandleValueAPI,
+                    WatchCVarAPI, AcquireCVarSnapshotAPI, AcquireCVarPrefixSnapshotAPI, CVarGenerationAPI };
+
+static std::vector<std::string> TestCVarEvents;
+
+CHUNKWM_CALLBACK(Callback_ChunkWM_CVarChanged) {}
+
+void AddEvent(chunk_event Event)
+{
+    if (Event.Type == ChunkWM_CVarChanged) {
+        TestCVarEvents.push_back((char *) Event.Context);
+    }
+
+    free(Event.Context);
+}
+
+#include "../src/common/config/cvar.cpp"
+#include "../src/core/cvar.cpp"
+
+#endif
@@ -0,0 +1,180 @@
+#include "cvar_test.h"
+#include "../src/common/misc/string.h"
+
+#include <map>
+
+/*
+ * NOTE(koekeishiya): Typed cvar reads, and a comparison with the store they replaced: a
+ * std::map behind a mutex, with the string value run through sscanf on every read. A writer
+ * keeps changing the value that is read, the way a config reload does, and a read must
+ * always see one of the values that was written.
+ */
+#define READ_DURATION  500000
+#define READ_BATCH     1000
+#define GROW_CVARS     5000
+
+static std::map<const char *, char *, string_comparator> LegacyCVars;
+static pthread_mutex_t LegacyLock = PTHREAD_MUTEX_INITIALIZER;
+
+static float
+LegacyFloatingPointValue(const char *Name)
+{
+    float Result = 0;
+    pthread_mutex_lock(&LegacyLock);
+    std::map<const char *, char *, string_comparator>::iterator It = LegacyCVars.find(Name);
+    if (It != LegacyCVars.end()) sscanf(It->second, "%f", &Result);
+    pthread_mutex_unlock(&LegacyLock);
+    return Result;
+}
+
+static void
+LegacyUpdate(const char *Name, float Value)
+{
+    char Buffer[64];
+    snprintf(Buffer, sizeof(Buffer), "%f", Value);
+
+    pthread_mutex_lock(&LegacyLock);
+    free(LegacyCVars[Name]);
+    LegacyCVars[Name] = strdup(Buffer);
+    pthread_mutex_unlock(&LegacyLock);
+}
+
+static void
+TestTypes()
+{
+    UpdateCVar("preset", (char *) "10");
+    CreateCVar("preset", 5u);
+    TEST_CHECK(CVarExists("preset"));
+    TEST_CHECK(CVarUnsignedValue("preset") == 0x10);
+    TEST_CHECK(CVarIntegerValue("preset") == 10);
+
+    CreateCVar("ratio", 0.5f);
+    UpdateCVar("ratio", 2.25f);
+    TEST_CHECK(CVarFloatingPointValue("ratio") == 2.25f);
+    TEST_CHECK(CVarIntegerValue("ratio") == 2);
+
+    UpdateCVar("undeclared", (char *) "42");
+    TEST_CHECK(CVarIntegerValue("undeclared") == 42);
+    TEST_CHECK(strcmp(CVarStringValue("undeclared"), "42") == 0);
+
+    TEST_CHECK(!CVarExists("missing"));
+    TEST_CHECK(CVarIntegerValue("missing") == 0);
+}
+
+struct read_benchmark
+{
+    bool Typed;
+    const char *Name;
+    bool volatile Stop;
+    uint64_t Reads;
+    uint64_t Torn;
+};
+
+static void *
+WriteRatio(void *Data)
+{
+    read_benchmark *Benchmark = (read_benchmark *) Data;
+    float Value = 0.25f;
+    while (!Benchmark->Stop) {
+        if (Benchmark->Typed) {
+            UpdateCVar(Benchmark->Name, Value);
+        } else {
+            LegacyUpdate(Benchmark->Name, Value);
+        }
+        Value = (Value == 0.25f) ? 0.75f : 0.25f;
+        usleep(100);
+    }
+
+    return NULL;
+}
+
+static void
+BenchmarkReads(bool Typed)
+{
+    read_benchmark Benchmark = {};
+    Benchmark.Typed = Typed;
+    Benchmark.Name = "bsp_split_ratio";
+
+    pthread_t Writer;
+    pthread_create(&Writer, NULL, &WriteRatio, &Benchmark);
+
+    uint64_t Start = TestTime();
+    while (TestTime() - Start < READ_DURATION * 1000ULL) {
+        for (int Index = 0; Index < READ_BATCH; ++Index) {
+            float Value = Typed ? CVarFloatingPointValue(Benchmark.Name)
+                                : LegacyFloatingPointValue(Benchmark.Name);
+            if (Value != 0.25f && Value != 0.5f && Value != 0.75f) ++Benchmark.Torn;
+        }
+        Benchmark.Reads += READ_BATCH;
+    }
+    uint64_t Elapsed = TestTime() - Start;
+
+    Benchmark.Stop = true;
+    pthread_join(Writer, NULL);
+
+    printf("%-15s %6.1fM reads/s\n", Typed ? "typed" : "string + sscanf", Benchmark.Reads * 1e3 / Elapsed);
+    TEST_CHECK(Benchmark.Torn == 0);
+}
+
+// NOTE(koekeishiya): Lookups do not take the lock, and must not miss while the table grows.
+static bool volatile StopLookups;
+
+static void *
+LookupWhileGrowing(void *Data)
+{
+    uint64_t *Missed = (uint64_t *) Data;
+    while (!StopLookups) {
+        if (!CVarExists("ratio")) ++*Missed;
+    }
+
+    return NULL;
+}
+
+static void
+TestGrowth()
+{
+    uint32_t Capacity = CVars->Capacity;
+    uint64_t Missed = 0;
+
+    pthread_t Reader;
+    pthread_create(&Reader, NULL, &LookupWhileGrowing, &Missed);
+
+    char Name[64];
+    for (int Index = 0; Index < GROW_CVARS; ++Index) {
+        snprintf(Name, sizeof(Name), "grow_%d", Index);
+        CreateCVar(Name, Index);
+    }
+
+    StopLookups = true;
+    pthread_join(Reader, NULL);
+
+    TEST_CHECK(Missed == 0);
+    TEST_CHECK(CVars->Capacity > Capacity);
+    for (int Index = 0; Index < GROW_CVARS; ++Index) {
+        snprintf(Name, sizeof(Name), "grow_%d", Index);
+        TEST_CHECK(CVarIntegerValue(Name) == Index);
+    }
+}
+
+int main()
+{
+    TEST_CHECK(BeginCVars());
+
+    char Name[64];
+    for (int Index = 0; Index < 100; ++Index) {
+        snprintf(Name, sizeof(Name), "plugin_option_%d", Index);
+        CreateCVar(Name, (float) Index);
+        LegacyUpdate(strdup(Name), (float) Index);
+    }
+
+    CreateCVar("bsp_split_ratio", 0.5f);
+    LegacyUpdate("bsp_split_ratio", 0.5f);
+
+    TestTypes();
+    BenchmarkReads(false);
+    BenchmarkReads(true);
+    TestGrowth();
+
+    EndCVars();
+    return TestResult("cvar_typed");
+}
@@ -0,0 +1,71 @@
+#include "cvar_test.h"
+
+/*
+ * NOTE(koekeishiya): Which changes are reported to a watching plugin. Notifications are
+ * collected by the stand-in event loop in cvar_test.h, one entry per ChunkWM_CVarChanged.
+ */
+static bool
+ExpectEvents(std::vector<std::string> Expected)
+{
+    bool Result = TestCVarEvents == Expected;
+    if (!Result) {
+        fprintf(stderr, "got:");
+        for (size_t Index = 0; Index < TestCVarEvents.size(); ++Index) {
+            fprintf(stderr, " %s", TestCVarEvents[Index].c_str());
+        }
+        fprintf(stderr, "\n");
+    }
+
+    TestCVarEvents.clear();
+    return Result;
+}
+
+int main()
+{
+    TEST_CHECK(BeginCVars());
+
+    CreateCVar("focused_border_color", 0xffd5c4a1u);
+    TEST_CHECK(ExpectEvents({}));
+
+    WatchCVarPrefix("Border", "focused_border_");
+    WatchCVar("Tiling", "bsp_split_ratio");
+
+    // NOTE(koekeishiya): Assigning the value a cvar already has is not a change.
+    UpdateCVar("focused_border_color", 0xffd5c4a1u);
+    TEST_CHECK(ExpectEvents({}));
+
+    UpdateCVar("focused_border_color", 0xff0000ffu);
+    TEST_CHECK(ExpectEvents({ "focused_border_color" }));
+
+    // NOTE(koekeishiya): Declaring a cvar only fires when it is created.
+    CreateCVar("focused_border_width", 4);
+    TEST_CHECK(ExpectEvents({ "focused_border_width" }));
+    CreateCVar("focused_border_width", 8);
+    TEST_CHECK(ExpectEvents({}));
+    TEST_CHECK(CVarIntegerValue("focused_border_width") == 4);
+
+    // NOTE(koekeishiya): An exact watch does not match longer names.
+    UpdateCVar("bsp_split_ratio", 0.3f);
+    UpdateCVar("bsp_split_ratio_x", 0.3f);
+    UpdateCVar("other", 1);
+    TEST_CHECK(ExpectEvents({ "bsp_split_ratio" }));
+
+    TEST_CHECK(IsCVarWatchedBy("Border", "focused_border_color"));
+    TEST_CHECK(!IsCVarWatchedBy("Border", "bsp_split_ratio"));
+    TEST_CHECK(IsCVarWatchedBy("Tiling", "bsp_split_ratio"));
+
+    // NOTE(koekeishiya): A cvar watched by two plugins is posted once; the callback fans it out.
+    WatchCVar("Tiling", "focused_border_color");
+    UpdateCVar("focused_border_color", 0xff00ff00u);
+    TEST_CHECK(ExpectEvents({ "focused_border_color" }));
+
+    UnwatchCVars("Border");
+    UnwatchCVars("Tiling");
+    UpdateCVar("focused_border_color", 1u);
+    UpdateCVar("bsp_split_ratio", 0.4f);
+    TEST_CHECK(ExpectEvents({}));
+    TEST_CHECK(!IsCVarWatchedBy("Border", "focused_border_color"));
+
+    EndCVars();
+    return TestResult("cvar_watch");
+}
@@ -0,0 +1,183 @@
+#ifndef CHUNKWM_TESTS_DAEMON_TEST_H
+#define CHUNKWM_TESTS_DAEMON_TEST_H
+
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// NOTE(koekeishiya): Catch the daemon moving a read buffer that a request still points into.
+#define CHUNKWM_DEBUG
+#include "../src/common/ipc/daemon.cpp"
+
+/*
+ * NOTE(koekeishiya): A stand-in for the chunkwm daemon. It listens on a unix domain socket
+ * in /tmp and on a loopback port picked by the system, and answers the following commands:
+ *
+ *   fail       responds with a failure status
+ *   big        responds with TEST_DAEMON_BIG bytes
+ *   late       responds from another thread, after TEST_DAEMON_LATE microseconds
+ *   <other>    responds with "echo:<other>\n"
+ */
+#define TEST_DAEMON_BIG  (2 << 20)
+#define TEST_DAEMON_LATE 20000
+
+struct test_daemon
+{
+    char Path[64];
+    int Port;
+};
+
+struct test_response
+{
+    char *Data;
+    size_t Length;
+    size_t Capacity;
+    size_t Consumed;
+};
+
+static void *
+TestDaemonLateThread(void *Data)
+{
+    int SockFD = (int) (intptr_t) Data;
+    usleep(TEST_DAEMON_LATE);
+    WriteToSocket("late\n", SockFD);
+    CloseSocket(SockFD);
+    return NULL;
+}
+
+static
+DAEMON_CALLBACK(TestDaemonCallback)
+{
+    if (strcmp(Message, "fail") == 0) {
+        WriteToSocket("failed\n", SockFD);
+        SetSocketStatus(SockFD, DAEMON_STATUS_FAILURE);
+        CloseSocket(SockFD);
+    } else if (strcmp(Message, "big") == 0) {
+        char *Buffer = (char *) malloc(TEST_DAEMON_BIG + 1);
+        memset(Buffer, 'x', TEST_DAEMON_BIG);
+        Buffer[TEST_DAEMON_BIG] = '\0';
+        WriteToSocket(Buffer, SockFD);
+        CloseSocket(SockFD);
+        free(Buffer);
+    } else if (strcmp(Message, "late") == 0) {
+        pthread_t Thread;
+        pthread_create(&Thread, NULL, &TestDaemonLateThread, (void *) (intptr_t) SockFD);
+        pthread_detach(Thread);
+    } else {
+        size_t Length = strlen(Message);
+        char *Buffer = (char *) malloc(Length + 7);
+        memcpy(Buffer, "echo:", 5);
+        memcpy(Buffer + 5, Message, Length);
+        memcpy(Buffer + 5 + Length, "\n", 2);
+        WriteToSocket(Buffer, SockFD);
+        CloseSocket(SockFD);
+        free(Buffer);
+    }
+}
+
+static bool
+StartTestDaemon(test_daemon *Daemon)
+{
+    snprintf(Daemon->Path, sizeof(Daemon->Path), "/tmp/chunkwm_test_%d.socket", getpid());
+    if (!StartDaemon(Daemon->Path, 0, TestDaemonCallback)) {
+        return false;
+    }
+
+    struct sockaddr_in Address;
+    socklen_t Length = sizeof(Address);
+    if (getsockname(DaemonSockFD, (struct sockaddr *) &Address, &Length) == -1) {
+        return false;
+    }
+
+    Daemon->Port = ntohs(Address.sin_port);
+    return true;
+}
+
+static int
+TestConnect(test_daemon *Daemon)
+{
+    int SockFD;
+    if (!ConnectToDaemonSocket(&SockFD, Daemon->Path)) {
+        return -1;
+    }
+
+    return SockFD;
+}
+
+static bool
+TestSendRequest(int SockFD, const char *Message)
+{
+    return WriteRequestToSocket(Message, strlen(Message), SockFD);
+}
+
+/*
+ * NOTE(koekeishiya): Read the next framed response. 'Text' points into the buffer of the
+ * response reader and remains valid until the next call.
+ */
+static bool
+TestReadResponse(int SockFD, test_response *Response, char **Text, size_t *Length, int *Status)
+{
+    if (Response->Consumed) {
+        memmove(Response->Data, Response->Data + Response->Consumed, Response->Length - Response->Consumed);
+        Response->Length -= Response->Consumed;
+        Response->Consumed = 0;
+    }
+
+    size_t Scanned = 0;
+    for (;;) {
+        char *End = NULL;
+        if (Response->Length > Scanned) {
+            End = (char *) memchr(Response->Data + Scanned, DAEMON_RESPONSE_END, Response->Length - Scanned);
+        }
+        if (End && End + 1 < Response->Data + Response->Length) {
+            *End = '\0';
+            *Text = Response->Data;
+            *Length = End - Response->Data;
+            *Status = End[1];
+            Response->Consumed = *Length + 2;
+            return true;
+        }
+
+        Scanned = End ? End - Response->Data : Response->Length;
+        if (Response->Length == Response->Capacity) {
+            Response->Capacity = Response->Capacity ? Response->Capacity * 2 : 4096;
+            Response->Data = (char *) realloc(Response->Data, Response->Capacity);
+        }
+
+        ssize_t Received = recv(SockFD, Response->Data + Response->Length, Response->Capacity - Response->Length, 0);
+        if (Received <= 0) {
+            return false;
+        }
+
+        Response->Length += Received;
+    }
+}
+
+static void
+TestFreeResponse(test_response *Response)
+{
+    free(Response->Data);
+    memset(Response, 0, sizeof(test_response));
+}
+
+// NOTE(koekeishiya): Send one request and check that the response is what the test daemon would echo.
+static bool
+TestRoundTrip(int SockFD, test_response *Response, const char *Message)
+{
+    char *Text;
+    size_t Length;
+    int Status;
+
+    if (!TestSendRequest(SockFD, Message)) return false;
+    if (!TestReadResponse(SockFD, Response, &Text, &Length, &Status)) return false;
+
+    return (Status == DAEMON_STATUS_SUCCESS) &&
+           (Length == strlen(Message) + 6) &&
+           (strncmp(Text, "echo:", 5) == 0) &&
+           (strncmp(Text + 5, Message, Length - 6) == 0);
+}
+
+#endif
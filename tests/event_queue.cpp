@@ -0,0 +1,271 @@
+#include "test.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <queue>
+
+#include "../src/core/clog.c"
+#include "../src/core/trace.h"
+#include "../src/common/config/cvar.h"
+
+void CreateCVar(const char *, int) {}
+int CVarIntegerValue(const char *) { return 0; }
+bool IsTraceRecording() { return false; }
+void TraceEvent(chunk_event *) {}
+
+#include "../src/core/histogram.cpp"
+#include "../src/core/wqueue.cpp"
+#include "../src/core/pqueue.cpp"
+#include "../src/core/dispatch/event.cpp"
+
+/*
+ * NOTE(koekeishiya): Producers post window events whose context encodes the producer and
+ * a sequence number. Window creation is never merged, so the event-loop must deliver
+ * every event of a producer exactly once and in order.
+ */
+#define MAX_PRODUCERS       8
+#define EVENTS_PER_PRODUCER 200000
+#define LATENCY_SAMPLE      64
+
+struct producer
+{
+    pthread_t Thread;
+    uint64_t Id;
+    uint64_t Count;
+    histogram Latency;
+    void (*Post)(uint64_t Context);
+};
+
+static uint64_t volatile Received;
+static uint64_t LastSequence[MAX_PRODUCERS];
+static uint64_t OutOfOrder;
+
+static void
+ReceiveEvent(uint64_t Context)
+{
+    uint64_t Producer = Context >> 32;
+    uint64_t Sequence = Context & 0xffffffff;
+    if (Sequence != LastSequence[Producer] + 1) {
+        ++OutOfOrder;
+    }
+
+    LastSequence[Producer] = Sequence;
+    __atomic_add_fetch(&Received, 1, __ATOMIC_RELEASE);
+}
+
+CHUNKWM_CALLBACK(Callback_ChunkWM_WindowCreated)
+{
+    ReceiveEvent((uint64_t) Event->Context);
+}
+
+static void
+LoopAddEvent(uint64_t Context)
+{
+    ConstructEvent(ChunkWM_WindowCreated, (void *) Context);
+}
+
+/*
+ * NOTE(koekeishiya): The ring on its own, against the queue it replaced: a std::queue behind
+ * a mutex. Both are drained by the same consumer, which does nothing but receive the event,
+ * and yields when the queue is empty. A producer that finds the ring full yields and retries,
+ * where AddEvent would spill.
+ */
+static event_queue RingQueue;
+static pthread_mutex_t LockedLock = PTHREAD_MUTEX_INITIALIZER;
+static std::queue<uint64_t> LockedQueue;
+
+static bool volatile Consuming;
+static bool (*ConsumerPop)(uint64_t *Context);
+
+static void
+RingPost(uint64_t Context)
+{
+    chunk_event Event = {};
+    Event.Type = ChunkWM_WindowCreated;
+    Event.Context = (void *) Context;
+    while (!EventQueuePush(&RingQueue, &Event)) {
+        sched_yield();
+    }
+}
+
+static bool
+RingPop(uint64_t *Context)
+{
+    chunk_event Event;
+    if (!EventQueuePop(&RingQueue, &Event)) return false;
+
+    *Context = (uint64_t) Event.Context;
+    return true;
+}
+
+static void
+LockedPost(uint64_t Context)
+{
+    pthread_mutex_lock(&LockedLock);
+    LockedQueue.push(Context);
+    pthread_mutex_unlock(&LockedLock);
+}
+
+static bool
+LockedPop(uint64_t *Context)
+{
+    pthread_mutex_lock(&LockedLock);
+    bool Result = !LockedQueue.empty();
+    if (Result) {
+        *Context = LockedQueue.front();
+        LockedQueue.pop();
+    }
+    pthread_mutex_unlock(&LockedLock);
+    return Result;
+}
+
+static void *
+ConsumeEvents(void *)
+{
+    uint64_t Context;
+    while (Consuming) {
+        if (ConsumerPop(&Context)) {
+            ReceiveEvent(Context);
+        } else {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void *
+ProduceEvents(void *Data)
+{
+    producer *Producer = (producer *) Data;
+    for (uint64_t Sequence = 1; Sequence <= Producer->Count; ++Sequence) {
+        uint64_t Context = (Producer->Id << 32) | Sequence;
+        if (Sequence % LATENCY_SAMPLE == 0) {
+            uint64_t Start = TestTime();
+            Producer->Post(Context);
+            HistogramRecord(&Producer->Latency, TestTime() - Start);
+        } else {
+            Producer->Post(Context);
+        }
+    }
+
+    return NULL;
+}
+
+static void
+RunProducers(const char *Name, void (*Post)(uint64_t), int ProducerCount)
+{
+    static producer Producers[MAX_PRODUCERS];
+    uint64_t Expected = (uint64_t) ProducerCount * EVENTS_PER_PRODUCER;
+
+    Received = 0;
+    OutOfOrder = 0;
+    memset(LastSequence, 0, sizeof(LastSequence));
+
+    uint64_t Start = TestTime();
+    for (int Index = 0; Index < ProducerCount; ++Index) {
+        producer *Producer = Producers + Index;
+        memset(&Producer->Latency, 0, sizeof(histogram));
+        Producer->Id = Index;
+        Producer->Count = EVENTS_PER_PRODUCER;
+        Producer->Post = Post;
+        pthread_create(&Producer->Thread, NULL, &ProduceEvents, Producer);
+    }
+
+    for (int Index = 0; Index < ProducerCount; ++Index) {
+        pthread_join(Producers[Index].Thread, NULL);
+    }
+
+    while (__atomic_load_n(&Received, __ATOMIC_ACQUIRE) < Expected) {
+        usleep(100);
+    }
+    uint64_t Elapsed = TestTime() - Start;
+
+    histogram Latency = {};
+    for (int Index = 0; Index < ProducerCount; ++Index) {
+        histogram *Sample = &Producers[Index].Latency;
+        for (uint32_t Bucket = 0; Bucket < HISTOGRAM_BUCKETS; ++Bucket) {
+            Latency.Buckets[Bucket] += Sample->Buckets[Bucket];
+        }
+        if (Sample->Max > Latency.Max) Latency.Max = Sample->Max;
+    }
+
+    printf("%-6s %d producer(s): %6.2fM events/s, enqueue p50 %lluns p99 %lluns max %lluns\n",
+           Name, ProducerCount, Expected * 1e3 / Elapsed,
+           (unsigned long long) HistogramPercentile(&Latency, 50.0),
+           (unsigned long long) HistogramPercentile(&Latency, 99.0),
+           (unsigned long long) Latency.Max);
+
+    TEST_CHECK(Received == Expected);
+    TEST_CHECK(OutOfOrder == 0);
+}
+
+/*
+ * NOTE(koekeishiya): Lane wait is recorded when an event is dispatched, once for every event,
+ * so an event that was held while the event-loop was paused has waited for the whole pause.
+ */
+#define HELD_WAIT 20000
+
+static void
+TestHeldWait()
+{
+    event_lane_stats Before, After;
+    EventLoopLaneStats(Event_Lane_Normal, &Before);
+
+    Received = 0;
+    memset(LastSequence, 0, sizeof(LastSequence));
+
+    PauseEventLoop();
+    LoopAddEvent(1);
+    usleep(HELD_WAIT);
+    ResumeEventLoop();
+
+    while (__atomic_load_n(&Received, __ATOMIC_ACQUIRE) < 1) {
+        usleep(100);
+    }
+
+    EventLoopLaneStats(Event_Lane_Normal, &After);
+    TEST_CHECK(After.Count == Before.Count + 1);
+    TEST_CHECK(After.TotalWait - Before.TotalWait >= HELD_WAIT * 1000ULL);
+}
+
+static void
+RunQueue(const char *Name, void (*Post)(uint64_t), bool (*Pop)(uint64_t *), int ProducerCount)
+{
+    pthread_t Consumer;
+    ConsumerPop = Pop;
+    Consuming = true;
+    pthread_create(&Consumer, NULL, &ConsumeEvents, NULL);
+
+    RunProducers(Name, Post, ProducerCount);
+
+    Consuming = false;
+    pthread_join(Consumer, NULL);
+}
+
+int main()
+{
+    int ProducerCounts[] = { 1, 2, 4, 8 };
+    size_t Runs = sizeof(ProducerCounts) / sizeof(*ProducerCounts);
+
+    EventQueueInit(&RingQueue);
+    for (size_t Index = 0; Index < Runs; ++Index) {
+        RunQueue("ring", &RingPost, &RingPop, ProducerCounts[Index]);
+    }
+
+    for (size_t Index = 0; Index < Runs; ++Index) {
+        RunQueue("locked", &LockedPost, &LockedPop, ProducerCounts[Index]);
+    }
+
+    // NOTE(koekeishiya): The whole event-loop, with the lanes, batching and dispatch.
+    TEST_CHECK(StartEventLoop());
+    for (size_t Index = 0; Index < Runs; ++Index) {
+        RunProducers("loop", &LoopAddEvent, ProducerCounts[Index]);
+    }
+    TestHeldWait();
+    StopEventLoop();
+
+    return TestResult("event_queue");
+}
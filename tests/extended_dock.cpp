@@ -0,0 +1,288 @@
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+#include "../src/common/ipc/daemon.cpp"
+#include "../src/common/ipc/extdock.cpp"
+
+/*
+ * NOTE(koekeishiya): Stand-ins for the scripting addition. The single server behaves like
+ * the one that is shipped today: it reads one command and closes the connection. The batch
+ * server answers the hello and reads newline-terminated commands until the client goes away,
+ * or until it has read 'CloseAfter' of them, to mimic a restart of the Dock.
+ */
+#define DOCK_COMMAND_SIZE 256
+
+struct stub_dock
+{
+    bool Batch;
+    int Port;
+    int ListenFD;
+    pthread_t Thread;
+
+    uint32_t volatile Commands;
+    uint32_t volatile Connections;
+    uint32_t volatile Hellos;
+    uint32_t volatile Malformed;
+    uint32_t CloseAfter;
+    char Last[DOCK_COMMAND_SIZE];
+};
+
+static void
+ReceiveCommand(stub_dock *Dock, const char *Command, size_t Length)
+{
+    if (Length == strlen(EXTENDED_DOCK_HELLO) - 1 &&
+        memcmp(Command, EXTENDED_DOCK_HELLO, Length) == 0) {
+        __atomic_add_fetch(&Dock->Hellos, 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    if (Length == 0 || Length >= DOCK_COMMAND_SIZE || memchr(Command, '\n', Length)) {
+        __atomic_add_fetch(&Dock->Malformed, 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    memcpy(Dock->Last, Command, Length);
+    Dock->Last[Length] = '\0';
+    __atomic_add_fetch(&Dock->Commands, 1, __ATOMIC_RELEASE);
+}
+
+static void
+ServeSingle(stub_dock *Dock, int SockFD)
+{
+    char Command[DOCK_COMMAND_SIZE];
+    ssize_t Length = recv(SockFD, Command, sizeof(Command), 0);
+    if (Length > 0) {
+        // NOTE(koekeishiya): The hello is an unknown command to the shipped scripting addition.
+        if (Command[Length - 1] == '\n') --Length;
+        ReceiveCommand(Dock, Command, Length);
+    }
+}
+
+static void
+ServeBatch(stub_dock *Dock, int SockFD)
+{
+    static char Buffer[1 << 16];
+    size_t Length = 0;
+    uint32_t Served = 0;
+    bool Greeted = false;
+
+    for (;;) {
+        ssize_t Received = recv(SockFD, Buffer + Length, sizeof(Buffer) - Length, 0);
+        if (Received <= 0) break;
+        Length += Received;
+
+        char *Line = Buffer;
+        char *End = Buffer + Length;
+        char *Newline;
+        while ((Newline = (char *) memchr(Line, '\n', End - Line))) {
+            ReceiveCommand(Dock, Line, Newline - Line);
+            if (!Greeted) {
+                send(SockFD, EXTENDED_DOCK_HELLO, strlen(EXTENDED_DOCK_HELLO), 0);
+                Greeted = true;
+            } else if (++Served == Dock->CloseAfter) {
+                return;
+            }
+            Line = Newline + 1;
+        }
+
+        Length = End - Line;
+        memmove(Buffer, Line, Length);
+    }
+}
+
+static void *
+RunStubDock(void *Data)
+{
+    stub_dock *Dock = (stub_dock *) Data;
+    for (;;) {
+        int SockFD = accept(Dock->ListenFD, NULL, NULL);
+        if (SockFD == -1) break;
+
+        __atomic_add_fetch(&Dock->Connections, 1, __ATOMIC_RELEASE);
+        if (Dock->Batch) {
+            ServeBatch(Dock, SockFD);
+        } else {
+            ServeSingle(Dock, SockFD);
+        }
+        close(SockFD);
+    }
+
+    return NULL;
+}
+
+static bool
+StartStubDock(stub_dock *Dock, bool Batch, int Port)
+{
+    memset(Dock, 0, sizeof(stub_dock));
+    Dock->Batch = Batch;
+
+    int _True = 1;
+    Dock->ListenFD = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(Dock->ListenFD, SOL_SOCKET, SO_REUSEADDR, &_True, sizeof(int));
+
+    struct sockaddr_in Address = {};
+    Address.sin_family = AF_INET;
+    Address.sin_port = htons(Port);
+    Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t Length = sizeof(Address);
+    if ((bind(Dock->ListenFD, (struct sockaddr *) &Address, sizeof(Address)) == -1) ||
+        (listen(Dock->ListenFD, SOMAXCONN) == -1) ||
+        (getsockname(Dock->ListenFD, (struct sockaddr *) &Address, &Length) == -1)) {
+        close(Dock->ListenFD);
+        return false;
+    }
+
+    Dock->Port = ntohs(Address.sin_port);
+    pthread_create(&Dock->Thread, NULL, &RunStubDock, Dock);
+    return true;
+}
+
+static void
+StopStubDock(stub_dock *Dock)
+{
+    shutdown(Dock->ListenFD, SHUT_RDWR);
+    close(Dock->ListenFD);
+    pthread_join(Dock->Thread, NULL);
+}
+
+static bool
+WaitForCommands(stub_dock *Dock, uint32_t Count)
+{
+    for (int Wait = 0; Wait < 5000; ++Wait) {
+        if (__atomic_load_n(&Dock->Commands, __ATOMIC_ACQUIRE) >= Count) return true;
+        usleep(1000);
+    }
+
+    return false;
+}
+
+static void
+FlushWindowMoves(int Count, int Offset)
+{
+    for (int Index = 0; Index < Count; ++Index) {
+        ExtendedDockCommand("window_move %d %d %d", Offset + Index, Index, Index * 2);
+    }
+
+    TEST_CHECK(ExtendedDockFlush());
+}
+
+// NOTE(koekeishiya): The shipped scripting addition gets every command on a connection of its own.
+static void
+TestSingle(stub_dock *Dock)
+{
+    TEST_CHECK(StartStubDock(Dock, false, 0));
+    TEST_CHECK(BeginExtendedDock(Dock->Port));
+
+    FlushWindowMoves(30, 0);
+    FlushWindowMoves(30, 100);
+    TEST_CHECK(WaitForCommands(Dock, 60));
+
+    TEST_CHECK(Dock->Hellos == 1);
+    TEST_CHECK(Dock->Connections == 61);
+    TEST_CHECK(Dock->Malformed == 0);
+    TEST_CHECK(strcmp(Dock->Last, "window_move 129 29 58") == 0);
+
+    EndExtendedDock();
+}
+
+// NOTE(koekeishiya): After the Dock restarts with a scripting addition that batches, so do we.
+static void
+TestUpgrade(stub_dock *Dock)
+{
+    int Port = Dock->Port;
+    TEST_CHECK(BeginExtendedDock(Port));
+    FlushWindowMoves(1, 0);
+    TEST_CHECK(WaitForCommands(Dock, 1));
+    StopStubDock(Dock);
+
+    ExtendedDockCommand("window_move 1 1 1");
+    TEST_CHECK(!ExtendedDockFlush());
+
+    sleep(EXTENDED_DOCK_RETRY_SEC + 1);
+    TEST_CHECK(StartStubDock(Dock, true, Port));
+
+    FlushWindowMoves(30, 0);
+    TEST_CHECK(WaitForCommands(Dock, 30));
+    TEST_CHECK(Dock->Hellos == 1);
+    TEST_CHECK(Dock->Connections == 1);
+    TEST_CHECK(Dock->Malformed == 0);
+
+    EndExtendedDock();
+    StopStubDock(Dock);
+}
+
+// NOTE(koekeishiya): A batching scripting addition keeps the connection; when it drops it, we reconnect.
+static void
+TestBatch(stub_dock *Dock)
+{
+    TEST_CHECK(StartStubDock(Dock, true, 0));
+    Dock->CloseAfter = 50;
+    TEST_CHECK(BeginExtendedDock(Dock->Port));
+
+    FlushWindowMoves(30, 0);
+    FlushWindowMoves(20, 30);
+    TEST_CHECK(WaitForCommands(Dock, 50));
+    TEST_CHECK(Dock->Connections == 1);
+
+    usleep(10000);
+    FlushWindowMoves(10, 50);
+    TEST_CHECK(WaitForCommands(Dock, 60));
+    TEST_CHECK(Dock->Connections == 2);
+    TEST_CHECK(Dock->Hellos == 2);
+    TEST_CHECK(Dock->Malformed == 0);
+    TEST_CHECK(strcmp(Dock->Last, "window_move 59 9 18") == 0);
+
+    EndExtendedDock();
+    StopStubDock(Dock);
+}
+
+/*
+ * NOTE(koekeishiya): Fading every window is one command per window; the old protocol costs a
+ * connection per command, batching costs one send per event.
+ */
+#define BENCHMARK_SINGLE  2000
+#define BENCHMARK_BATCH   400000
+#define BENCHMARK_WINDOWS 20
+
+static void
+BenchmarkThroughput(stub_dock *Dock, bool Batch, uint32_t Count)
+{
+    TEST_CHECK(StartStubDock(Dock, Batch, 0));
+    TEST_CHECK(BeginExtendedDock(Dock->Port));
+
+    uint64_t Start = TestTime();
+    for (uint32_t Sent = 0; Sent < Count; Sent += BENCHMARK_WINDOWS) {
+        for (int Index = 0; Index < BENCHMARK_WINDOWS; ++Index) {
+            ExtendedDockCommand("window_alpha_fade %d %f %f", Index, 0.5f, 0.25f);
+        }
+        ExtendedDockFlush();
+    }
+    TEST_CHECK(WaitForCommands(Dock, Count));
+    uint64_t Elapsed = TestTime() - Start;
+
+    printf("%-6s %6u commands in %7.1fms: %9.0f commands/s over %u connection(s)\n",
+           Batch ? "batch" : "single", Count, Elapsed / 1e6, Count * 1e9 / Elapsed, Dock->Connections);
+
+    EndExtendedDock();
+    StopStubDock(Dock);
+}
+
+int main()
+{
+    static stub_dock Dock;
+
+    TestSingle(&Dock);
+    TestUpgrade(&Dock);
+    TestBatch(&Dock);
+
+    BenchmarkThroughput(&Dock, false, BENCHMARK_SINGLE);
+    BenchmarkThroughput(&Dock, true, BENCHMARK_BATCH);
+
+    return TestResult("extended_dock");
+}
@@ -0,0 +1,260 @@
+#include "daemon_test.h"
+
+/*
+ * NOTE(koekeishiya): Framing and pipelining of the daemon protocol, and a comparison of the
+ * round-trip time of a single command: connect-per-command over loopback TCP with the old
+ * unframed protocol, connect-per-command over the unix domain socket, one persistent
+ * connection, and one connection with every request pipelined.
+ */
+#define PIPELINED_REQUESTS 1000
+#define ROUND_TRIPS        2000
+
+static test_daemon Daemon;
+
+static void
+TestPipelined()
+{
+    int SockFD = TestConnect(&Daemon);
+    TEST_CHECK(SockFD != -1);
+
+    char Message[64];
+    for (int Index = 0; Index < PIPELINED_REQUESTS; ++Index) {
+        snprintf(Message, sizeof(Message), "request %d", Index);
+        TEST_CHECK(TestSendRequest(SockFD, Message));
+    }
+
+    test_response Response = {};
+    char Expected[64];
+    char *Text;
+    size_t Length;
+    int Status;
+    int Mismatch = 0;
+
+    for (int Index = 0; Index < PIPELINED_REQUESTS; ++Index) {
+        snprintf(Expected, sizeof(Expected), "echo:request %d\n", Index);
+        if (!TestReadResponse(SockFD, &Response, &Text, &Length, &Status) ||
+            (Status != DAEMON_STATUS_SUCCESS) ||
+            (strcmp(Text, Expected) != 0)) {
+            ++Mismatch;
+        }
+    }
+
+    TEST_CHECK(Mismatch == 0);
+    TestFreeResponse(&Response);
+    close(SockFD);
+}
+
+// NOTE(koekeishiya): Responses stay in request order, even when an earlier one is answered late.
+static void
+TestOrderAndStatus()
+{
+    int SockFD = TestConnect(&Daemon);
+    TEST_CHECK(SockFD != -1);
+
+    TEST_CHECK(TestSendRequest(SockFD, "late"));
+    TEST_CHECK(TestSendRequest(SockFD, "fail"));
+    TEST_CHECK(TestSendRequest(SockFD, "big"));
+    TEST_CHECK(TestSendRequest(SockFD, "after"));
+
+    test_response Response = {};
+    char *Text;
+    size_t Length;
+    int Status;
+
+    TEST_CHECK(TestReadResponse(SockFD, &Response, &Text, &Length, &Status));
+    TEST_CHECK(strcmp(Text, "late\n") == 0 && Status == DAEMON_STATUS_SUCCESS);
+
+    TEST_CHECK(TestReadResponse(SockFD, &Response, &Text, &Length, &Status));
+    TEST_CHECK(strcmp(Text, "failed\n") == 0 && Status == DAEMON_STATUS_FAILURE);
+
+    TEST_CHECK(TestReadResponse(SockFD, &Response, &Text, &Length, &Status));
+    TEST_CHECK(Length == TEST_DAEMON_BIG && Status == DAEMON_STATUS_SUCCESS);
+
+    TEST_CHECK(TestReadResponse(SockFD, &Response, &Text, &Length, &Status));
+    TEST_CHECK(strcmp(Text, "echo:after\n") == 0);
+
+    TestFreeResponse(&Response);
+    close(SockFD);
+}
+
+// NOTE(koekeishiya): A frame that arrives one byte at a time, and a request that is larger than a buffer.
+static void
+TestFragments()
+{
+    int SockFD = TestConnect(&Daemon);
+    TEST_CHECK(SockFD != -1);
+
+    const char *Message = "fragmented";
+    uint32_t Header = htonl(strlen(Message));
+    char Frame[64];
+    memcpy(Frame, &Header, DAEMON_FRAME_HEADER_SIZE);
+    memcpy(Frame + DAEMON_FRAME_HEADER_SIZE, Message, strlen(Message));
+
+    for (size_t Index = 0; Index < DAEMON_FRAME_HEADER_SIZE + strlen(Message); ++Index) {
+        TEST_CHECK(send(SockFD, Frame + Index, 1, 0) == 1);
+        usleep(1000);
+    }
+
+    test_response Response = {};
+    char *Text;
+    size_t Length;
+    int Status;
+
+    TEST_CHECK(TestReadResponse(SockFD, &Response, &Text, &Length, &Status));
+    TEST_CHECK(strcmp(Text, "echo:fragmented\n") == 0);
+
+    size_t LargeSize = 3 * DAEMON_BUFFER_SIZE + 17;
+    char *Large = (char *) malloc(LargeSize + 1);
+    memset(Large, 'y', LargeSize);
+    Large[LargeSize] = '\0';
+    TEST_CHECK(TestRoundTrip(SockFD, &Response, Large));
+    free(Large);
+
+    TestFreeResponse(&Response);
+    close(SockFD);
+}
+
+// NOTE(koekeishiya): Clients that predate the framed protocol still work over TCP.
+static void
+TestLegacy()
+{
+    int SockFD;
+    TEST_CHECK(ConnectToDaemon(&SockFD, Daemon.Port));
+    TEST_CHECK(send(SockFD, "legacy", 6, 0) == 6);
+
+    char *Response = ReadFromSocket(SockFD);
+    TEST_CHECK(Response && strcmp(Response, "echo:legacy\n") == 0);
+    free(Response);
+    close(SockFD);
+
+    test_response Framed = {};
+    TEST_CHECK(ConnectToDaemon(&SockFD, Daemon.Port));
+    TEST_CHECK(TestRoundTrip(SockFD, &Framed, "framed over tcp"));
+    TestFreeResponse(&Framed);
+    close(SockFD);
+}
+
+/*
+ * NOTE(koekeishiya): A request that is held back behind a large response is started once the
+ * client catches up, from the same wakeup that may also find the client's next request. The
+ * message of the started request lives in the read buffer, which must not move underneath it.
+ */
+#define CROSSING_ROUNDS 50
+
+static void
+TestCrossingWakeup()
+{
+    int SockFD = TestConnect(&Daemon);
+    TEST_CHECK(SockFD != -1);
+
+    test_response Response = {};
+    char Held[64], Next[64], Expected[80];
+    char *Text;
+    size_t Length;
+    int Status;
+    int Mismatch = 0;
+
+    int Round;
+    for (Round = 0; Round < CROSSING_ROUNDS; ++Round) {
+        snprintf(Held, sizeof(Held), "held back in round %d", Round);
+        snprintf(Next, sizeof(Next), "sent while reading in round %d", Round);
+
+        if (!TestSendRequest(SockFD, "big") || !TestSendRequest(SockFD, Held)) break;
+        usleep(5000);
+
+        if (!TestSendRequest(SockFD, Next)) break;
+        if (!TestReadResponse(SockFD, &Response, &Text, &Length, &Status) || Length != TEST_DAEMON_BIG) break;
+
+        snprintf(Expected, sizeof(Expected), "echo:%s\n", Held);
+        if (!TestReadResponse(SockFD, &Response, &Text, &Length, &Status)) break;
+        if (strcmp(Text, Expected) != 0) ++Mismatch;
+
+        snprintf(Expected, sizeof(Expected), "echo:%s\n", Next);
+        if (!TestReadResponse(SockFD, &Response, &Text, &Length, &Status)) break;
+        if (strcmp(Text, Expected) != 0) ++Mismatch;
+    }
+
+    TEST_CHECK(Round == CROSSING_ROUNDS);
+    TEST_CHECK(Mismatch == 0);
+    TestFreeResponse(&Response);
+    close(SockFD);
+}
+
+static void
+ReportRoundTrip(const char *Name, uint64_t Elapsed, int Failures)
+{
+    printf("%-24s %7.1fus per command\n", Name, Elapsed / 1e3 / ROUND_TRIPS);
+    TEST_CHECK(Failures == 0);
+}
+
+static void
+BenchmarkRoundTrip()
+{
+    test_response Response = {};
+    int Failures = 0;
+    int SockFD;
+
+    uint64_t Start = TestTime();
+    for (int Index = 0; Index < ROUND_TRIPS; ++Index) {
+        if (!ConnectToDaemon(&SockFD, Daemon.Port)) {
+            ++Failures;
+            continue;
+        }
+
+        send(SockFD, "query", 5, 0);
+        char *Result = ReadFromSocket(SockFD);
+        if (!Result) ++Failures;
+        free(Result);
+        close(SockFD);
+    }
+    ReportRoundTrip("tcp, connect per command", TestTime() - Start, Failures);
+
+    Failures = 0;
+    Start = TestTime();
+    for (int Index = 0; Index < ROUND_TRIPS; ++Index) {
+        SockFD = TestConnect(&Daemon);
+        if (!TestRoundTrip(SockFD, &Response, "query")) ++Failures;
+        close(SockFD);
+    }
+    ReportRoundTrip("unix, connect per command", TestTime() - Start, Failures);
+
+    Failures = 0;
+    SockFD = TestConnect(&Daemon);
+    Start = TestTime();
+    for (int Index = 0; Index < ROUND_TRIPS; ++Index) {
+        if (!TestRoundTrip(SockFD, &Response, "query")) ++Failures;
+    }
+    ReportRoundTrip("unix, one connection", TestTime() - Start, Failures);
+
+    Failures = 0;
+    Start = TestTime();
+    for (int Index = 0; Index < ROUND_TRIPS; ++Index) {
+        if (!TestSendRequest(SockFD, "query")) ++Failures;
+    }
+
+    char *Text;
+    size_t Length;
+    int Status;
+    for (int Index = 0; Index < ROUND_TRIPS; ++Index) {
+        if (!TestReadResponse(SockFD, &Response, &Text, &Length, &Status)) ++Failures;
+    }
+    ReportRoundTrip("unix, pipelined", TestTime() - Start, Failures);
+
+    close(SockFD);
+    TestFreeResponse(&Response);
+}
+
+int main()
+{
+    TEST_CHECK(StartTestDaemon(&Daemon));
+
+    TestPipelined();
+    TestOrderAndStatus();
+    TestFragments();
+    TestLegacy();
+    TestCrossingWakeup();
+    BenchmarkRoundTrip();
+
+    StopDaemon();
+    return TestResult("ipc_framing");
+}
@@ -0,0 +1,145 @@
+#include "daemon_test.h"
+#include "../src/core/histogram.cpp"
+
+#include <sys/socket.h>
+
+/*
+ * NOTE(koekeishiya): Load generator for the daemon event loop. Many clients pipeline
+ * requests at the same time, while one client sits on half a frame header and another
+ * asks for large responses without reading them. Neither may stall anybody else, and
+ * every client must get every response, in order.
+ */
+#define LOAD_CLIENTS   64
+#define LOAD_REQUESTS  200
+#define LOAD_PIPELINE  10
+#define STALLED_BIG    4
+
+static test_daemon Daemon;
+static histogram Latency;
+
+struct load_client
+{
+    pthread_t Thread;
+    int Id;
+    int Failures;
+};
+
+static void *
+RunLoadClient(void *Data)
+{
+    load_client *Client = (load_client *) Data;
+    test_response Response = {};
+    char Message[64];
+    char Expected[64];
+    char *Text;
+    size_t Length;
+    int Status;
+
+    int SockFD = TestConnect(&Daemon);
+    if (SockFD == -1) {
+        Client->Failures = LOAD_REQUESTS;
+        return NULL;
+    }
+
+    for (int Sent = 0; Sent < LOAD_REQUESTS; Sent += LOAD_PIPELINE) {
+        uint64_t Start = TestTime();
+        for (int Index = Sent; Index < Sent + LOAD_PIPELINE; ++Index) {
+            snprintf(Message, sizeof(Message), "client %d request %d", Client->Id, Index);
+            if (!TestSendRequest(SockFD, Message)) ++Client->Failures;
+        }
+
+        for (int Index = Sent; Index < Sent + LOAD_PIPELINE; ++Index) {
+            snprintf(Expected, sizeof(Expected), "echo:client %d request %d\n", Client->Id, Index);
+            if (!TestReadResponse(SockFD, &Response, &Text, &Length, &Status) ||
+                (strcmp(Text, Expected) != 0)) {
+                ++Client->Failures;
+            }
+        }
+        HistogramRecordShared(&Latency, (TestTime() - Start) / 1000);
+    }
+
+    TestFreeResponse(&Response);
+    close(SockFD);
+    return NULL;
+}
+
+// NOTE(koekeishiya): A client that has finished sending still gets the responses to what it sent.
+static void
+TestHalfClose()
+{
+    int SockFD = TestConnect(&Daemon);
+    TEST_CHECK(SockFD != -1);
+    TEST_CHECK(TestSendRequest(SockFD, "late"));
+    TEST_CHECK(TestSendRequest(SockFD, "closing"));
+    shutdown(SockFD, SHUT_WR);
+
+    test_response Response = {};
+    char *Text;
+    size_t Length;
+    int Status;
+
+    TEST_CHECK(TestReadResponse(SockFD, &Response, &Text, &Length, &Status));
+    TEST_CHECK(strcmp(Text, "late\n") == 0);
+    TEST_CHECK(TestReadResponse(SockFD, &Response, &Text, &Length, &Status));
+    TEST_CHECK(strcmp(Text, "echo:closing\n") == 0);
+
+    TestFreeResponse(&Response);
+    close(SockFD);
+}
+
+int main()
+{
+    TEST_CHECK(StartTestDaemon(&Daemon));
+
+    int Idle = TestConnect(&Daemon);
+    TEST_CHECK(Idle != -1);
+    TEST_CHECK(send(Idle, "\0\0", 2, 0) == 2);
+
+    int Stalled = TestConnect(&Daemon);
+    TEST_CHECK(Stalled != -1);
+    for (int Index = 0; Index < STALLED_BIG; ++Index) {
+        TEST_CHECK(TestSendRequest(Stalled, "big"));
+    }
+
+    static load_client Clients[LOAD_CLIENTS];
+    uint64_t Start = TestTime();
+    for (int Index = 0; Index < LOAD_CLIENTS; ++Index) {
+        Clients[Index].Id = Index;
+        pthread_create(&Clients[Index].Thread, NULL, &RunLoadClient, Clients + Index);
+    }
+
+    int Failures = 0;
+    for (int Index = 0; Index < LOAD_CLIENTS; ++Index) {
+        pthread_join(Clients[Index].Thread, NULL);
+        Failures += Clients[Index].Failures;
+    }
+    uint64_t Elapsed = TestTime() - Start;
+
+    printf("%d clients x %d requests: %.0f requests/s, batch of %d p50 %lluus p99 %lluus max %lluus\n",
+           LOAD_CLIENTS, LOAD_REQUESTS, LOAD_CLIENTS * LOAD_REQUESTS * 1e9 / Elapsed, LOAD_PIPELINE,
+           (unsigned long long) HistogramPercentile(&Latency, 50.0),
+           (unsigned long long) HistogramPercentile(&Latency, 99.0),
+           (unsigned long long) Latency.Max);
+
+    TEST_CHECK(Failures == 0);
+    TEST_CHECK(Latency.Max < 1000000);
+
+    TestHalfClose();
+
+    // NOTE(koekeishiya): The stalled client has been held back, but nothing was lost.
+    test_response Response = {};
+    char *Text;
+    size_t Length;
+    int Status;
+    for (int Index = 0; Index < STALLED_BIG; ++Index) {
+        TEST_CHECK(TestReadResponse(Stalled, &Response, &Text, &Length, &Status));
+        TEST_CHECK(Length == TEST_DAEMON_BIG);
+    }
+    TestFreeResponse(&Response);
+
+    close(Stalled);
+    close(Idle);
+    StopDaemon();
+
+    return TestResult("ipc_load");
+}
@@ -0,0 +1,202 @@
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../src/core/clog.c"
+#include "../src/core/statepage.cpp"
+
+extern "C" {
+#include "../src/chunkstate/chunkstate.c"
+}
+
+/*
+ * NOTE(koekeishiya): Two threads update the page through the same functions as the
+ * event-loop and the tiling plugin, while the reader library takes snapshots. Every
+ * update is internally consistent, so any snapshot that mixes two updates is torn.
+ *
+ * A read may fail when a writer is preempted in the middle of an update and the reader
+ * gives up waiting for it; that is allowed, but it must not happen for most reads.
+ */
+#define READ_DURATION 1000000000ULL
+
+static char User[16];
+static char Name[STATE_PAGE_NAME_MAX];
+static bool volatile Stop;
+
+static void *
+WriteFocus(void *)
+{
+    char Owner[128], Title[256];
+    macos_application Application = {};
+    macos_window Window = {};
+    Window.Owner = &Application;
+    Window.Name = Title;
+    Application.Name = Owner;
+
+    for (uint32_t Index = 1; !Stop; ++Index) {
+        snprintf(Owner, sizeof(Owner), "owner-%u", Index);
+        int Length = snprintf(Title, sizeof(Title), "title-%u-", Index);
+        for (; Length < 200; ++Length) Title[Length] = 'a' + Index % 26;
+        Title[Length] = '\0';
+
+        Application.PID = Index;
+        Window.Id = Index;
+        StatePageSetFocus(&Window);
+
+        if (Index % 5 == 0) {
+            snprintf(Title, sizeof(Title), "title-%u-renamed", Index);
+            StatePageUpdateTitle(&Window);
+        }
+
+        if (Index % 7 == 0) {
+            StatePageClearFocus(Index);
+        }
+
+        StatePageSetActiveDesktop(Index, Index);
+        if (Index % 64 == 0) usleep(1);
+    }
+
+    return NULL;
+}
+
+// NOTE(koekeishiya): Desktops are written one at a time, so a snapshot may see at most two generations.
+static void *
+WriteDesktops(void *)
+{
+    for (uint32_t Index = 1; !Stop; ++Index) {
+        for (unsigned Desktop = 1; Desktop <= 8; ++Desktop) {
+            StatePageSetDesktop(Desktop, Index, Index, (Index & 1) ? "bsp" : "monocle");
+        }
+        if (Index % 16 == 0) usleep(1);
+    }
+
+    return NULL;
+}
+
+static bool
+IsTorn(state_page *Snapshot)
+{
+    if (Snapshot->ActiveDesktop != Snapshot->ActiveMonitor) return true;
+
+    if (Snapshot->FocusedWindow) {
+        char Owner[64], Title[64];
+        snprintf(Owner, sizeof(Owner), "owner-%u", Snapshot->FocusedWindow);
+        int Length = snprintf(Title, sizeof(Title), "title-%u-", Snapshot->FocusedWindow);
+        if ((uint32_t) Snapshot->FocusedPID != Snapshot->FocusedWindow) return true;
+        if (strcmp(Owner, Snapshot->FocusedOwner) != 0) return true;
+        if (strncmp(Title, Snapshot->FocusedName, Length) != 0) return true;
+    } else if (Snapshot->FocusedPID || Snapshot->FocusedOwner[0] || Snapshot->FocusedName[0]) {
+        return true;
+    }
+
+    uint32_t First = Snapshot->Desktops[0].WindowCount;
+    for (uint32_t Index = 0; Index < Snapshot->DesktopCount; ++Index) {
+        state_page_desktop *Desktop = Snapshot->Desktops + Index;
+        if (Desktop->WindowCount != Desktop->Monitor) return true;
+        if (strcmp(Desktop->Mode, (Desktop->WindowCount & 1) ? "bsp" : "monocle") != 0) return true;
+        if ((Desktop->WindowCount > First) || (First - Desktop->WindowCount > 1)) return true;
+    }
+
+    return false;
+}
+
+static void
+TestTornReads()
+{
+    TEST_CHECK(BeginStatePage());
+
+    chunkstate State;
+    TEST_CHECK(ChunkStateOpen(&State, User));
+    if (!State.Page) return;
+
+    pthread_t Focus, Desktops;
+    pthread_create(&Focus, NULL, &WriteFocus, NULL);
+    pthread_create(&Desktops, NULL, &WriteDesktops, NULL);
+
+    uint64_t Reads = 0;
+    uint64_t Failed = 0;
+    uint64_t Torn = 0;
+    state_page Snapshot;
+
+    uint64_t Start = TestTime();
+    while (TestTime() - Start < READ_DURATION) {
+        if (!ChunkStateChanged(&State)) continue;
+
+        if (!ChunkStateRead(&State, &Snapshot)) {
+            ++Failed;
+        } else {
+            ++Reads;
+            if (IsTorn(&Snapshot)) ++Torn;
+        }
+    }
+
+    Stop = true;
+    pthread_join(Focus, NULL);
+    pthread_join(Desktops, NULL);
+
+    printf("%llu snapshots, %llu failed, %llu torn, %u updates\n",
+           (unsigned long long) Reads, (unsigned long long) Failed,
+           (unsigned long long) Torn, State.Page->Sequence / 2);
+
+    TEST_CHECK(Reads > 0);
+    TEST_CHECK(Failed < Reads);
+    TEST_CHECK(Torn == 0);
+
+    ChunkStateClose(&State);
+    munmap(Page, sizeof(state_page));
+    Page = NULL;
+}
+
+// NOTE(koekeishiya): An object that anybody else can open is neither published into nor read.
+static void
+TestForeignPage()
+{
+    shm_unlink(Name);
+    int FD = shm_open(Name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    TEST_CHECK(FD != -1);
+    TEST_CHECK(fchmod(FD, 0666) == 0);
+    TEST_CHECK(ftruncate(FD, sizeof(state_page)) == 0);
+    close(FD);
+
+    chunkstate State;
+    TEST_CHECK(OpenStatePage(Name) == -1);
+    TEST_CHECK(!ChunkStateOpen(&State, User));
+
+    shm_unlink(Name);
+}
+
+// NOTE(koekeishiya): An object of our own with a different size is replaced.
+static void
+TestStalePage()
+{
+    shm_unlink(Name);
+    int FD = shm_open(Name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    TEST_CHECK(FD != -1);
+    TEST_CHECK(ftruncate(FD, 64) == 0);
+    close(FD);
+
+    FD = OpenStatePage(Name);
+    TEST_CHECK(FD != -1);
+
+    struct stat Buffer;
+    TEST_CHECK(IsPrivateStatePage(FD, &Buffer));
+    TEST_CHECK(Buffer.st_size == sizeof(state_page));
+    close(FD);
+}
+
+int main()
+{
+    snprintf(User, sizeof(User), "test%d", getpid());
+    snprintf(Name, sizeof(Name), STATE_PAGE_NAME_FMT, User);
+    setenv("USER", User, 1);
+
+    TestForeignPage();
+    TestStalePage();
+    TestTornReads();
+
+    shm_unlink(Name);
+    return TestResult("state_page");
+}
@@ -0,0 +1,29 @@
+#ifndef CHUNKWM_TESTS_STUB_CARBON_H
+#define CHUNKWM_TESTS_STUB_CARBON_H
+
+/*
+ * NOTE(koekeishiya): Just enough of Carbon to compile the platform independent parts of
+ * chunkwm on Linux. Nothing in here is ever called; tests provide their own contexts.
+ */
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef double CGFloat;
+typedef struct CGPoint { CGFloat x, y; } CGPoint;
+typedef struct CGSize { CGFloat width, height; } CGSize;
+typedef struct CGRect { CGPoint origin; CGSize size; } CGRect;
+typedef uint32_t CGDirectDisplayID;
+
+typedef const void *CFTypeRef;
+typedef const struct __CFString *CFStringRef;
+typedef const struct __AXUIElement *AXUIElementRef;
+typedef struct __AXObserver *AXObserverRef;
+typedef int32_t AXError;
+
+typedef struct
+{
+    unsigned long highLongOfPSN;
+    unsigned long lowLongOfPSN;
+} ProcessSerialNumber;
+
+#endif
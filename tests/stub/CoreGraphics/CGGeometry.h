@@ -0,0 +1,7 @@
+#ifndef CHUNKWM_TESTS_STUB_CGGEOMETRY_H
+#define CHUNKWM_TESTS_STUB_CGGEOMETRY_H
+
+// NOTE(koekeishiya): The geometry types live in the Carbon stub.
+#include <Carbon/Carbon.h>
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef CHUNKWM_TESTS_STUB_LIBPROC_H
+#define CHUNKWM_TESTS_STUB_LIBPROC_H
+
+// NOTE(koekeishiya): chunkc includes libproc.h, but does not use anything from it.
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef CHUNKWM_TESTS_TEST_H
+#define CHUNKWM_TESTS_TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * NOTE(koekeishiya): Every test is a single program that includes the sources it exercises,
+ * the same way chunkwm itself is built. A failed check is reported and the program exits
+ * with a non-zero status once it is done; benchmarks only print their numbers.
+ */
+static int TestFailures;
+
+#define TEST_CHECK(Condition) \
+    do { if (!(Condition)) { \
+             fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #Condition); \
+             ++TestFailures; \
+         } \
+       } while (0)
+
+static inline int
+TestResult(const char *Name)
+{
+    if (TestFailures) {
+        fprintf(stderr, "%s: %d check(s) failed\n", Name, TestFailures);
+        return 1;
+    }
+
+    printf("%s: ok\n", Name);
+    return 0;
+}
+
+static inline uint64_t
+TestTime()
+{
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return (uint64_t) Time.tv_sec * 1000000000ULL + (uint64_t) Time.tv_nsec;
+}
+
+#endif
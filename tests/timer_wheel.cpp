@@ -0,0 +1,165 @@
+#include "test.h"
+
+#include <stdlib.h>
+#include <map>
+#include <vector>
+
+#include "../src/core/twheel.cpp"
+
+/*
+ * NOTE(koekeishiya): Timers are scheduled at random deadlines across every level of the
+ * wheel, and a third of them are cancelled. The wheel is advanced in random steps, and
+ * every timer must fire exactly once, in the step that covers its deadline.
+ */
+#define TIMER_COUNT 200000
+#define TIMER_SPAN  (1 << 20)
+
+static timer_wheel Wheel;
+static timer Timers[TIMER_COUNT];
+
+static bool
+IsCancelled(timer *Timer)
+{
+    return ((Timer - Timers) % 3) == 0;
+}
+
+static void
+TestExpiry()
+{
+    srand(1);
+    TimerWheelInit(&Wheel, 1000);
+
+    for (int Index = 0; Index < TIMER_COUNT; ++Index) {
+        TimerWheelSchedule(&Wheel, Timers + Index, 1000 + (rand() % TIMER_SPAN));
+    }
+
+    // NOTE(koekeishiya): Rescheduling a pending timer moves it; it must not fire twice.
+    for (int Index = 1; Index < TIMER_COUNT; Index += 7) {
+        TimerWheelSchedule(&Wheel, Timers + Index, 1000 + (rand() % TIMER_SPAN));
+    }
+
+    for (int Index = 0; Index < TIMER_COUNT; Index += 3) {
+        TimerWheelCancel(&Wheel, Timers + Index);
+        TEST_CHECK(!TimerPending(Timers + Index));
+    }
+
+    uint32_t Expected = TIMER_COUNT - (TIMER_COUNT + 2) / 3;
+    TEST_CHECK(Wheel.Count == Expected);
+
+    uint32_t Fired = 0;
+    uint32_t Early = 0;
+    uint32_t Late = 0;
+    uint32_t Cancelled = 0;
+    uint64_t Now = 1000;
+    uint64_t Last;
+
+    uint64_t Start = TestTime();
+    while (Wheel.Count) {
+        Last = Now;
+        Now += rand() % 500;
+        TimerWheelAdvance(&Wheel, Now);
+
+        timer *Timer;
+        while ((Timer = TimerWheelPopExpired(&Wheel))) {
+            ++Fired;
+            if (Timer->Expires > Now) ++Early;
+            if (Timer->Expires <= Last) ++Late;
+            if (IsCancelled(Timer)) ++Cancelled;
+            TEST_CHECK(!TimerPending(Timer));
+        }
+    }
+    uint64_t Elapsed = TestTime() - Start;
+
+    printf("expiry: %u timers fired over %llu ticks in %.1fms\n",
+           Fired, (unsigned long long) (Now - 1000), Elapsed / 1e6);
+
+    TEST_CHECK(Fired == Expected);
+    TEST_CHECK(Early == 0);
+    TEST_CHECK(Late == 0);
+    TEST_CHECK(Cancelled == 0);
+}
+
+// NOTE(koekeishiya): Deadlines beyond the range of the wheel are clamped, not lost.
+static void
+TestClamp()
+{
+    timer Timer = {};
+    TimerWheelInit(&Wheel, 0);
+    TimerWheelSchedule(&Wheel, &Timer, 1ULL << 40);
+    TEST_CHECK(Timer.Expires == TIMER_WHEEL_RANGE - 1);
+
+    TimerWheelAdvance(&Wheel, TIMER_WHEEL_RANGE - 2);
+    TEST_CHECK(TimerWheelPopExpired(&Wheel) == NULL);
+
+    TimerWheelAdvance(&Wheel, TIMER_WHEEL_RANGE - 1);
+    TEST_CHECK(TimerWheelPopExpired(&Wheel) == &Timer);
+    TEST_CHECK(Wheel.Count == 0);
+}
+
+/*
+ * NOTE(koekeishiya): Many applications launching at once: every registration arms a retry,
+ * and most of them succeed and cancel it before it fires. The baseline is an ordered map,
+ * which is what a sorted queue of deadlines costs.
+ */
+#define LAUNCH_COUNT  100000
+#define LAUNCH_ROUNDS 8
+
+static void
+BenchmarkChurn()
+{
+    std::vector<timer> Retries(LAUNCH_COUNT);
+    for (size_t Index = 0; Index < Retries.size(); ++Index) {
+        Retries[Index].Next = NULL;
+    }
+
+    srand(2);
+    TimerWheelInit(&Wheel, 0);
+
+    uint64_t Start = TestTime();
+    for (int Round = 0; Round < LAUNCH_ROUNDS; ++Round) {
+        for (int Index = 0; Index < LAUNCH_COUNT; ++Index) {
+            TimerWheelSchedule(&Wheel, &Retries[Index], Wheel.Now + 3 + (rand() % 40));
+        }
+        for (int Index = 0; Index < LAUNCH_COUNT; Index += 2) {
+            TimerWheelCancel(&Wheel, &Retries[Index]);
+        }
+        TimerWheelAdvance(&Wheel, Wheel.Now + 50);
+        while (TimerWheelPopExpired(&Wheel));
+    }
+    uint64_t Wheeled = TestTime() - Start;
+    TEST_CHECK(Wheel.Count == 0);
+
+    srand(2);
+    std::multimap<uint64_t, int> Queue;
+    std::vector<std::multimap<uint64_t, int>::iterator> Handles(LAUNCH_COUNT);
+    uint64_t Now = 0;
+
+    Start = TestTime();
+    for (int Round = 0; Round < LAUNCH_ROUNDS; ++Round) {
+        for (int Index = 0; Index < LAUNCH_COUNT; ++Index) {
+            Handles[Index] = Queue.insert(std::make_pair(Now + 3 + (rand() % 40), Index));
+        }
+        for (int Index = 0; Index < LAUNCH_COUNT; Index += 2) {
+            Queue.erase(Handles[Index]);
+        }
+        Now += 50;
+        while (!Queue.empty() && Queue.begin()->first <= Now) {
+            Queue.erase(Queue.begin());
+        }
+    }
+    uint64_t Mapped = TestTime() - Start;
+    TEST_CHECK(Queue.empty());
+
+    uint64_t Operations = (uint64_t) LAUNCH_ROUNDS * (LAUNCH_COUNT + LAUNCH_COUNT / 2);
+    printf("churn: wheel %.1fns/op, ordered map %.1fns/op\n",
+           (double) Wheeled / Operations, (double) Mapped / Operations);
+}
+
+int main()
+{
+    TestExpiry();
+    TestClamp();
+    BenchmarkChurn();
+
+    return TestResult("timer_wheel");
+}
@@ -0,0 +1,272 @@
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/core/clog.c"
+#include "../src/core/trace.h"
+#include "../src/common/config/cvar.h"
+
+void CreateCVar(const char *, int) {}
+int CVarIntegerValue(const char *) { return 0; }
+bool IsTraceRecording() { return false; }
+void TraceEvent(chunk_event *) {}
+
+#include "../src/core/histogram.cpp"
+#include "../src/core/wqueue.cpp"
+#include "../src/core/pqueue.cpp"
+#include "../src/core/dispatch/event.cpp"
+#include "../src/core/replay.cpp"
+
+/*
+ * NOTE(koekeishiya): A stub window backend. Replayed records are resolved against a fixed
+ * table of windows, the recorded frame is applied to the window, and the event is posted
+ * to the real event-loop. The callbacks below stand in for 'callback.cpp' and hand a copy
+ * of the window to a plugin through the real plugin queue, so the cost of the dispatch path
+ * can be measured from a trace without the accessibility API.
+ */
+#define STUB_WINDOW_COUNT 4
+#define STUB_MOVES        2000
+#define STUB_INTERVAL     5000
+
+struct stub_window
+{
+    uint32_t Id;
+    float X, Y;
+    float Width, Height;
+};
+
+static stub_window Windows[STUB_WINDOW_COUNT];
+static stub_window PluginSeen[STUB_WINDOW_COUNT];
+static uint32_t volatile PluginFocused;
+
+static work_queue WorkQueue;
+static plugin StubPlugin;
+static plugin_queue StubQueue;
+
+static stub_window *
+GetStubWindow(uint32_t Id)
+{
+    for (int Index = 0; Index < STUB_WINDOW_COUNT; ++Index) {
+        if (Windows[Index].Id == Id) return Windows + Index;
+    }
+
+    return NULL;
+}
+
+static
+TRACE_REPLAY_BACKEND(ReplayStubRecord)
+{
+    stub_window *Window = GetStubWindow(Record->WindowId);
+    if (!Window) return false;
+
+    switch (Record->Type) {
+    case ChunkWM_WindowFocused: {
+        ConstructEvent(ChunkWM_WindowFocused, Window);
+    } break;
+    case ChunkWM_WindowMoved: {
+        Window->X = Record->X;
+        Window->Y = Record->Y;
+        ConstructEvent(ChunkWM_WindowMoved, Window);
+    } break;
+    case ChunkWM_WindowResized: {
+        Window->X = Record->X;
+        Window->Y = Record->Y;
+        Window->Width = Record->Width;
+        Window->Height = Record->Height;
+        ConstructEvent(ChunkWM_WindowResized, Window);
+    } break;
+    default: {
+        return false;
+    } break;
+    }
+
+    return true;
+}
+
+static
+PLUGIN_PAYLOAD_RELEASE(ReleaseStubWindow)
+{
+    free(Data);
+}
+
+static
+PLUGIN_MAIN_FUNC(StubPluginMain)
+{
+    stub_window *Window = (stub_window *) Data;
+    if (strcmp(Node, "chunkwm_export_window_focused") == 0) {
+        __atomic_store_n(&PluginFocused, Window->Id, __ATOMIC_RELEASE);
+    } else {
+        PluginSeen[Window->Id - 1] = *Window;
+    }
+
+    return true;
+}
+
+static void
+QueueStubWindow(const char *Export, stub_window *Window)
+{
+    stub_window *Copy = (stub_window *) malloc(sizeof(stub_window));
+    memcpy(Copy, Window, sizeof(stub_window));
+
+    plugin_payload *Payload = BeginPluginPayload(Copy, ReleaseStubWindow, NULL);
+    TrackEventCompletion(Payload);
+    PluginQueueAdd(&WorkQueue, &StubQueue, Export, Payload);
+    ReleasePluginPayload(Payload);
+}
+
+CHUNKWM_CALLBACK(Callback_ChunkWM_WindowFocused)
+{
+    QueueStubWindow("chunkwm_export_window_focused", (stub_window *) Event->Context);
+}
+
+CHUNKWM_CALLBACK(Callback_ChunkWM_WindowMoved)
+{
+    QueueStubWindow("chunkwm_export_window_moved", (stub_window *) Event->Context);
+}
+
+CHUNKWM_CALLBACK(Callback_ChunkWM_WindowResized)
+{
+    QueueStubWindow("chunkwm_export_window_resized", (stub_window *) Event->Context);
+}
+
+static void
+WriteRecord(FILE *Handle, uint64_t Timestamp, uint32_t Type, uint32_t WindowId,
+            float X, float Y, float Width, float Height)
+{
+    trace_record Record = {};
+    Record.Timestamp = Timestamp;
+    Record.Type = Type;
+    Record.WindowId = WindowId;
+    Record.X = X;
+    Record.Y = Y;
+    Record.Width = Width;
+    Record.Height = Height;
+    fwrite(&Record, sizeof(trace_record), 1, Handle);
+}
+
+/*
+ * NOTE(koekeishiya): A drag storm across every window. The timestamp of the first record
+ * is arbitrary; the replay is paced relative to the start of the session.
+ */
+static void
+WriteDragStorm(FILE *Handle, uint64_t Timestamp, int Offset)
+{
+    for (int Move = 0; Move < STUB_MOVES; ++Move) {
+        uint32_t Id = (Move % STUB_WINDOW_COUNT) + 1;
+        uint32_t Type = (Move % 3) ? ChunkWM_WindowMoved : ChunkWM_WindowResized;
+        WriteRecord(Handle, Timestamp, Type, Id, Offset + Move, Offset + Move * 2, 400 + Move, 300 + Move);
+        Timestamp += STUB_INTERVAL;
+    }
+
+    WriteRecord(Handle, Timestamp, ChunkWM_WindowFocused, 2, 0, 0, 0, 0);
+}
+
+/*
+ * NOTE(koekeishiya): Three recordings appended to the same file: a session recorded late in
+ * the uptime of the machine, one recorded after a reboot, and one written before session
+ * markers existed, whose timestamps also go backwards. A record for an unknown window is
+ * skipped.
+ */
+static bool
+WriteTrace(const char *Path)
+{
+    FILE *Handle = fopen(Path, "wb");
+    if (!Handle) return false;
+
+    trace_header Header = { TRACE_MAGIC, TRACE_VERSION, sizeof(trace_record), 0 };
+    fwrite(&Header, sizeof(trace_header), 1, Handle);
+
+    WriteRecord(Handle, 900000000000000ULL, TRACE_SESSION, 0, 0, 0, 0, 0);
+    WriteDragStorm(Handle, 900000000000000ULL, 0);
+
+    WriteRecord(Handle, 5000000000ULL, TRACE_SESSION, 0, 0, 0, 0, 0);
+    WriteDragStorm(Handle, 5000000000ULL, 10000);
+    WriteRecord(Handle, 5000000000ULL + STUB_MOVES * STUB_INTERVAL, ChunkWM_WindowMoved, 42, 0, 0, 0, 0);
+
+    WriteDragStorm(Handle, 1000000000ULL, 20000);
+
+    fclose(Handle);
+    return true;
+}
+
+static bool
+PluginCaughtUp()
+{
+    for (int Index = 0; Index < STUB_WINDOW_COUNT; ++Index) {
+        if ((PluginSeen[Index].X != Windows[Index].X) ||
+            (PluginSeen[Index].Width != Windows[Index].Width)) {
+            return false;
+        }
+    }
+
+    return __atomic_load_n(&PluginFocused, __ATOMIC_ACQUIRE) == 2;
+}
+
+static void
+ReplayStubTrace(const char *Path, bool Realtime)
+{
+    memset(PluginSeen, 0, sizeof(PluginSeen));
+    PluginFocused = 0;
+
+    trace_replay_result Result;
+    uint64_t Start = TestTime();
+    TEST_CHECK(ReplayTraceFile(Path, Realtime, ReplayStubRecord, NULL, &Result));
+    uint64_t Replayed = TestTime() - Start;
+
+    for (int Wait = 0; (Wait < 2000) && (!PluginCaughtUp()); ++Wait) {
+        usleep(1000);
+    }
+    PluginQueueWait(&StubQueue);
+    uint64_t Elapsed = TestTime() - Start;
+
+    histogram *Run = &EventLoopTypeStats(ChunkWM_WindowMoved)->Run;
+    printf("%-8s replayed %u skipped %u sessions %u in %.1fms, drained in %.1fms, window_moved run p50 %lluus p99 %lluus\n",
+           Realtime ? "realtime" : "fast", Result.Replayed, Result.Skipped, Result.Sessions,
+           Replayed / 1e6, Elapsed / 1e6,
+           (unsigned long long) HistogramPercentile(Run, 50.0),
+           (unsigned long long) HistogramPercentile(Run, 99.0));
+
+    TEST_CHECK(Result.Sessions == 3);
+    TEST_CHECK(Result.Replayed == 3 * (STUB_MOVES + 1));
+    TEST_CHECK(Result.Skipped == 1);
+    TEST_CHECK(PluginCaughtUp());
+
+    stub_window *Last = GetStubWindow(STUB_WINDOW_COUNT);
+    TEST_CHECK(Last->X == 20000 + STUB_MOVES - 1);
+    TEST_CHECK(Last->Y == 20000 + (STUB_MOVES - 1) * 2);
+
+    if (Realtime) {
+        uint64_t Recorded = 3ULL * STUB_MOVES * STUB_INTERVAL;
+        TEST_CHECK(Replayed >= Recorded);
+        TEST_CHECK(Replayed < Recorded + 2000000000ULL);
+    }
+}
+
+int main()
+{
+    char Path[] = "/tmp/chunkwm_trace_XXXXXX";
+    int FD = mkstemp(Path);
+    TEST_CHECK(FD != -1);
+    close(FD);
+    TEST_CHECK(WriteTrace(Path));
+
+    for (int Index = 0; Index < STUB_WINDOW_COUNT; ++Index) {
+        Windows[Index].Id = Index + 1;
+    }
+
+    StubPlugin.Run = StubPluginMain;
+    TEST_CHECK(BeginWorkQueue(&WorkQueue, 2));
+    TEST_CHECK(BeginPluginQueue(&StubQueue, &StubPlugin, "stub"));
+    TEST_CHECK(StartEventLoop());
+
+    ReplayStubTrace(Path, false);
+    ReplayStubTrace(Path, true);
+
+    StopEventLoop();
+    EndPluginQueue(&StubQueue);
+    unlink(Path);
+
+    return TestResult("trace_replay");
+}
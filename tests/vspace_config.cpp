@@ -0,0 +1,237 @@
+#include "cvar_test.h"
+#include "../src/plugins/tiling/vspace.cpp"
+
+/*
+ * NOTE(koekeishiya): The per-desktop config table of the tiling plugin. The accessibility and
+ * node functions that vspace.cpp calls are stand-ins: a space is identified by its desktop
+ * index, and its ref is a plain C string. Change notifications are delivered to the table the
+ * same way the event loop and the tiling plugin do, but only when DeliverCVarEvents is called.
+ */
+#define DESKTOP_COUNT  300
+#define LOOKUPS        100000
+
+bool AXLibCGSSpaceIDToDesktopID(CGSSpaceID SpaceId, unsigned *OutArrangement, unsigned *OutDesktopId)
+{
+    *OutDesktopId = SpaceId;
+    return true;
+}
+
+char *CopyCFStringToC(CFStringRef String)
+{
+    return strdup((const char *) String);
+}
+
+void FreeNodeTree(node *Node, virtual_space_mode Mode) {}
+void CreateNodeRegion(node *Node, region_type Type, macos_space *Space, virtual_space *VirtualSpace) {}
+void CreateNodeRegionRecursive(node *Node, bool Optimal, macos_space *Space, virtual_space *VirtualSpace) {}
+void ApplyNodeRegion(node *Node, virtual_space_mode Mode, bool Center) {}
+void ApplyNodeRegionWithPotentialZoom(node *Node, virtual_space *VirtualSpace) {}
+
+static const char *PluginName = "Tiling";
+
+static unsigned
+DeliverCVarEvents()
+{
+    unsigned Delivered = 0;
+    for (size_t Index = 0; Index < TestCVarEvents.size(); ++Index) {
+        if (IsCVarWatchedBy(PluginName, TestCVarEvents[Index].c_str())) {
+            VirtualSpaceConfigChanged();
+            ++Delivered;
+        }
+    }
+
+    TestCVarEvents.clear();
+    return Delivered;
+}
+
+// NOTE(koekeishiya): The lookup the table replaced: every key is formatted and looked up on its own.
+static float
+ReferenceOffset(unsigned SpaceIndex, const char *Key, const char *Global)
+{
+    char Name[BUFFER_SIZE];
+    snprintf(Name, sizeof(Name), "%d_%s", SpaceIndex, Key);
+    return CVarExists(Name) ? CVarFloatingPointValue(Name) : CVarFloatingPointValue(Global);
+}
+
+static virtual_space_config
+ReferenceConfig(unsigned SpaceIndex)
+{
+    virtual_space_config Config;
+    char Name[BUFFER_SIZE];
+
+    snprintf(Name, sizeof(Name), "%d_%s", SpaceIndex, _CVAR_SPACE_MODE);
+    Config.Mode = VirtualSpaceModeFromString(CVarExists(Name) ? CVarStringValue(Name)
+                                                              : CVarStringValue(CVAR_SPACE_MODE));
+    Config.Offset.Top = ReferenceOffset(SpaceIndex, _CVAR_SPACE_OFFSET_TOP, CVAR_SPACE_OFFSET_TOP);
+    Config.Offset.Bottom = ReferenceOffset(SpaceIndex, _CVAR_SPACE_OFFSET_BOTTOM, CVAR_SPACE_OFFSET_BOTTOM);
+    Config.Offset.Left = ReferenceOffset(SpaceIndex, _CVAR_SPACE_OFFSET_LEFT, CVAR_SPACE_OFFSET_LEFT);
+    Config.Offset.Right = ReferenceOffset(SpaceIndex, _CVAR_SPACE_OFFSET_RIGHT, CVAR_SPACE_OFFSET_RIGHT);
+    Config.Offset.Gap = ReferenceOffset(SpaceIndex, _CVAR_SPACE_OFFSET_GAP, CVAR_SPACE_OFFSET_GAP);
+
+    snprintf(Name, sizeof(Name), "%d_%s", SpaceIndex, _CVAR_SPACE_TREE);
+    Config.TreeLayout = CVarExists(Name) ? strdup(CVarStringValue(Name)) : NULL;
+    return Config;
+}
+
+static int
+CompareWithReference()
+{
+    int Mismatch = 0;
+    for (unsigned Index = 0; Index < DESKTOP_COUNT; ++Index) {
+        virtual_space_config Config = GetVirtualSpaceConfig(Index);
+        virtual_space_config Reference = ReferenceConfig(Index);
+
+        bool Tree = Config.TreeLayout && Reference.TreeLayout
+                  ? strcmp(Config.TreeLayout, Reference.TreeLayout) == 0
+                  : Config.TreeLayout == Reference.TreeLayout;
+        if ((!Tree) ||
+            (Config.Mode != Reference.Mode) ||
+            (memcmp(&Config.Offset, &Reference.Offset, sizeof(region_offset)) != 0)) {
+            fprintf(stderr, "desktop %u differs from the reference lookup\n", Index);
+            ++Mismatch;
+        }
+
+        free(Config.TreeLayout);
+        free(Reference.TreeLayout);
+    }
+
+    return Mismatch;
+}
+
+static void
+TestTable()
+{
+    TEST_CHECK(CompareWithReference() == 0);
+
+    UpdateCVar("12_desktop_offset_gap", (char *) "1");
+    UpdateCVar("2_desktop_offset_top", (char *) "15");
+    UpdateCVar(CVAR_SPACE_MODE, (char *) "float");
+    TEST_CHECK(DeliverCVarEvents() == 3);
+    TEST_CHECK(CompareWithReference() == 0);
+
+    virtual_space_config Config = GetVirtualSpaceConfig(2);
+    TEST_CHECK(Config.Mode == Virtual_Space_Monocle);
+    TEST_CHECK(Config.Offset.Top == 15.0f);
+    TEST_CHECK(Config.Offset.Gap == 7.5f);
+    TEST_CHECK(Config.TreeLayout == NULL);
+
+    Config = GetVirtualSpaceConfig(DESKTOP_COUNT + 1);
+    TEST_CHECK(Config.Mode == Virtual_Space_Float);
+    TEST_CHECK(Config.Offset.Top == 60.0f);
+}
+
+// NOTE(koekeishiya): The cvars that the plugin writes on every focus change must not invalidate the table.
+static void
+TestInvalidation()
+{
+    GetVirtualSpaceConfig(1);
+    uint64_t Built = ConfigTable.Snapshot.Generation;
+
+    for (int Index = 1; Index <= 10; ++Index) {
+        UpdateCVar(CVAR_FOCUSED_WINDOW, Index);
+        UpdateCVar(CVAR_BSP_INSERTION_POINT, Index);
+        UpdateCVar(CVAR_ACTIVE_DESKTOP, Index);
+    }
+    TEST_CHECK(DeliverCVarEvents() == 0);
+    GetVirtualSpaceConfig(1);
+    TEST_CHECK(ConfigTable.Snapshot.Generation == Built);
+
+    // NOTE(koekeishiya): Neither does assigning a desktop cvar the value it already has.
+    uint64_t Generation = CVarGeneration();
+    UpdateCVar(CVAR_SPACE_OFFSET_TOP, 60.0f);
+    CreateCVar(CVAR_SPACE_OFFSET_TOP, 10.0f);
+    UpdateCVar("2_desktop_mode", (char *) "monocle");
+    TEST_CHECK(CVarGeneration() == Generation);
+    TEST_CHECK(DeliverCVarEvents() == 0);
+
+    UpdateCVar("7_desktop_offset_left", (char *) "3");
+    TEST_CHECK(DeliverCVarEvents() == 1);
+    TEST_CHECK(GetVirtualSpaceConfig(7).Offset.Left == 3.0f);
+    TEST_CHECK(ConfigTable.Snapshot.Generation > Built);
+
+    TEST_CHECK(IsCVarWatchedBy(PluginName, "123_desktop_tree"));
+    TEST_CHECK(IsCVarWatchedBy(PluginName, CVAR_SPACE_OFFSET_GAP));
+    TEST_CHECK(!IsCVarWatchedBy(PluginName, "_desktop_mode"));
+    TEST_CHECK(!IsCVarWatchedBy(PluginName, "x1_desktop_mode"));
+    TEST_CHECK(!IsCVarWatchedBy(PluginName, "1_desktops"));
+    TEST_CHECK(!IsCVarWatchedBy(PluginName, CVAR_FOCUSED_WINDOW));
+}
+
+// NOTE(koekeishiya): A new virtual space takes its own copy of the tree layout.
+static void
+TestVirtualSpace()
+{
+    macos_space Space = { (CFStringRef) "space-3", 3, 0 };
+    virtual_space *VirtualSpace = AcquireVirtualSpace(&Space);
+    TEST_CHECK(VirtualSpace->Mode == Virtual_Space_Float);
+    TEST_CHECK(VirtualSpace->TreeLayout && strcmp(VirtualSpace->TreeLayout, "/tmp/tree") == 0);
+    ReleaseVirtualSpace(VirtualSpace);
+
+    UpdateCVar("3_desktop_tree", (char *) "/tmp/other");
+    TEST_CHECK(DeliverCVarEvents() == 1);
+    GetVirtualSpaceConfig(3);
+    TEST_CHECK(strcmp(VirtualSpace->TreeLayout, "/tmp/tree") == 0);
+}
+
+/*
+ * NOTE(koekeishiya): A lookup after the focused window changed. Before, every change to any
+ * cvar made the next lookup rebuild the whole table; now only a desktop cvar does.
+ */
+static void
+BenchmarkLookup()
+{
+    uint64_t Start = TestTime();
+    for (int Index = 0; Index < LOOKUPS; ++Index) {
+        UpdateCVar(CVAR_FOCUSED_WINDOW, Index);
+        VirtualSpaceConfigChanged();
+        free(GetVirtualSpaceConfig(2).TreeLayout);
+    }
+    uint64_t Rebuild = TestTime() - Start;
+
+    Start = TestTime();
+    for (int Index = 0; Index < LOOKUPS; ++Index) {
+        UpdateCVar(CVAR_FOCUSED_WINDOW, Index);
+        free(GetVirtualSpaceConfig(2).TreeLayout);
+    }
+    uint64_t Watched = TestTime() - Start;
+    TEST_CHECK(DeliverCVarEvents() == 0);
+
+    printf("focus change + lookup: %.2fus rebuilding, %.2fus with watches\n",
+           Rebuild / 1e3 / LOOKUPS, Watched / 1e3 / LOOKUPS);
+}
+
+int main()
+{
+    TEST_CHECK(BeginCVars());
+
+    // NOTE(koekeishiya): The config file may set cvars before the plugin declares them.
+    UpdateCVar("2_desktop_mode", (char *) "monocle");
+    UpdateCVar("2_desktop_offset_top", (char *) "10");
+    UpdateCVar("3_desktop_tree", (char *) "/tmp/tree");
+    UpdateCVar(CVAR_SPACE_OFFSET_GAP, (char *) "7.5");
+
+    CreateCVar(CVAR_SPACE_MODE, virtual_space_mode_str[Virtual_Space_Bsp]);
+    CreateCVar(CVAR_SPACE_OFFSET_TOP, 60.0f);
+    CreateCVar(CVAR_SPACE_OFFSET_BOTTOM, 50.0f);
+    CreateCVar(CVAR_SPACE_OFFSET_LEFT, 50.0f);
+    CreateCVar(CVAR_SPACE_OFFSET_RIGHT, 50.0f);
+    CreateCVar(CVAR_SPACE_OFFSET_GAP, 20.0f);
+
+    WatchCVarPrefix(PluginName, CVAR_SPACE_GLOBAL_WATCH);
+    WatchCVarPrefix(PluginName, CVAR_SPACE_DESKTOP_WATCH);
+
+    CreateCVar(CVAR_FOCUSED_WINDOW, 0);
+    CreateCVar(CVAR_BSP_INSERTION_POINT, 0);
+    CreateCVar(CVAR_ACTIVE_DESKTOP, 0);
+
+    TEST_CHECK(BeginVirtualSpaces());
+
+    TestTable();
+    TestInvalidation();
+    TestVirtualSpace();
+    BenchmarkLookup();
+
+    EndVirtualSpaces();
+    EndCVars();
+    return TestResult("vspace_config");
+}
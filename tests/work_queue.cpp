@@ -0,0 +1,203 @@
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "../src/core/clog.c"
+#include "../src/core/histogram.cpp"
+#include "../src/core/wqueue.cpp"
+
+/*
+ * NOTE(koekeishiya): Tasks record the time between being queued and starting to run, and
+ * then spin for a short while, roughly what a cheap plugin export costs. Every task must
+ * run exactly once.
+ */
+#define TASK_COUNT  400000
+#define TASK_SPIN   200
+#define THREADS     4
+
+struct task
+{
+    uint64_t Queued;
+    uint32_t Runs;
+};
+
+static task Tasks[TASK_COUNT];
+static histogram Latency;
+static uint32_t volatile Completed;
+
+static
+WORK_QUEUE_CALLBACK(RunTask)
+{
+    task *Task = (task *) Data;
+    HistogramRecordShared(&Latency, TestTime() - Task->Queued);
+
+    for (int volatile Spin = 0; Spin < TASK_SPIN; ++Spin);
+
+    __atomic_add_fetch(&Task->Runs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&Completed, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * NOTE(koekeishiya): The work_queue as it was before the work-stealing pool: one ring of
+ * 256 entries, a single producer, and a semaphore that is posted for every entry. The ring
+ * asserted when it was full; here the producer yields instead, so that the benchmark can
+ * queue more than 256 entries at a time.
+ */
+struct legacy_work_queue
+{
+    uint32_t volatile EntriesCompleted;
+    uint32_t volatile EntryCount;
+    uint32_t volatile EntryToWrite;
+    uint32_t volatile EntryToRead;
+    sem_t *Semaphore;
+
+    work_queue_entry Entries[256];
+};
+
+#define ArrayCount(Array) (sizeof(Array) / sizeof(*(Array)))
+
+static bool
+LegacyDoNextWorkQueueEntry(legacy_work_queue *Queue)
+{
+    uint32_t EntryToRead = Queue->EntryToRead;
+    uint32_t NextEntryToRead = (EntryToRead + 1) % ArrayCount(Queue->Entries);
+    if (EntryToRead != Queue->EntryToWrite) {
+        uint32_t Index = __sync_val_compare_and_swap(&Queue->EntryToRead, EntryToRead, NextEntryToRead);
+        if (Index == EntryToRead) {
+            work_queue_entry Entry = Queue->Entries[Index];
+            Entry.Callback(Entry.Data);
+            __sync_fetch_and_add(&Queue->EntriesCompleted, 1);
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+static void
+LegacyAddWorkQueueEntry(legacy_work_queue *Queue, work_queue_callback *Callback, void *Data)
+{
+    uint32_t NextEntryToWrite = (Queue->EntryToWrite + 1) % ArrayCount(Queue->Entries);
+    while (NextEntryToWrite == Queue->EntryToRead) {
+        sched_yield();
+    }
+
+    work_queue_entry *Entry = Queue->Entries + Queue->EntryToWrite;
+    Entry->Callback = Callback;
+    Entry->Data = Data;
+    ++Queue->EntryCount;
+
+    asm volatile("" ::: "memory");
+    Queue->EntryToWrite = NextEntryToWrite;
+    sem_post(Queue->Semaphore);
+}
+
+static void *
+LegacyWorkQueueThreadProc(void *Data)
+{
+    legacy_work_queue *Queue = (legacy_work_queue *) Data;
+    for (;;) {
+        if (LegacyDoNextWorkQueueEntry(Queue)) {
+            sem_wait(Queue->Semaphore);
+        }
+    }
+
+    return NULL;
+}
+
+static work_queue Pool;
+static legacy_work_queue Legacy;
+
+static void
+PoolAdd(task *Task)
+{
+    AddWorkQueueEntry(&Pool, RunTask, Task);
+}
+
+static void
+LegacyAdd(task *Task)
+{
+    LegacyAddWorkQueueEntry(&Legacy, RunTask, Task);
+}
+
+/*
+ * NOTE(koekeishiya): Tasks are queued in bursts, the way the event-loop hands a window
+ * event to every loaded plugin at once. A burst larger than 256 entries would have hit
+ * the assert in the old ring.
+ */
+static void
+RunTasks(const char *Name, void (*Add)(task *), int Burst)
+{
+    memset(Tasks, 0, sizeof(Tasks));
+    memset(&Latency, 0, sizeof(histogram));
+    Completed = 0;
+
+    uint64_t Start = TestTime();
+    for (int Index = 0; Index < TASK_COUNT; ++Index) {
+        Tasks[Index].Queued = TestTime();
+        Add(Tasks + Index);
+
+        if ((Index + 1) % Burst == 0) {
+            while (__atomic_load_n(&Completed, __ATOMIC_ACQUIRE) < (uint32_t) (Index + 1) - Burst / 2) {
+                sched_yield();
+            }
+        }
+    }
+
+    while (__atomic_load_n(&Completed, __ATOMIC_ACQUIRE) < TASK_COUNT) {
+        usleep(100);
+    }
+    uint64_t Elapsed = TestTime() - Start;
+
+    uint32_t Wrong = 0;
+    for (int Index = 0; Index < TASK_COUNT; ++Index) {
+        if (Tasks[Index].Runs != 1) ++Wrong;
+    }
+
+    printf("%-6s burst %5d: %5.2fM tasks/s, queue latency p50 %lluns p99 %lluns max %lluns\n",
+           Name, Burst, TASK_COUNT * 1e3 / Elapsed,
+           (unsigned long long) HistogramPercentile(&Latency, 50.0),
+           (unsigned long long) HistogramPercentile(&Latency, 99.0),
+           (unsigned long long) Latency.Max);
+
+    TEST_CHECK(Wrong == 0);
+}
+
+int main()
+{
+    int Bursts[] = { 16, 128, 2048 };
+
+    TEST_CHECK(BeginWorkQueue(&Pool, THREADS));
+    TEST_CHECK(Pool.ThreadCount == THREADS);
+    for (size_t Index = 0; Index < sizeof(Bursts) / sizeof(*Bursts); ++Index) {
+        RunTasks("pool", &PoolAdd, Bursts[Index]);
+    }
+
+    // NOTE(koekeishiya): Shrinking and growing the pool must not lose queued entries.
+    ResizeWorkQueue(&Pool, 1);
+    RunTasks("pool/1", &PoolAdd, 2048);
+    ResizeWorkQueue(&Pool, THREADS);
+
+    sem_unlink("/chunkwm_test_work_queue");
+    Legacy.Semaphore = sem_open("/chunkwm_test_work_queue", O_CREAT, 0600, 0);
+    TEST_CHECK(Legacy.Semaphore != SEM_FAILED);
+    for (int Index = 0; Index < THREADS; ++Index) {
+        pthread_t Thread;
+        pthread_create(&Thread, NULL, &LegacyWorkQueueThreadProc, &Legacy);
+        pthread_detach(Thread);
+    }
+
+    for (size_t Index = 0; Index < sizeof(Bursts) / sizeof(*Bursts); ++Index) {
+        RunTasks("ring", &LegacyAdd, Bursts[Index]);
+    }
+    sem_unlink("/chunkwm_test_work_queue");
+
+    return TestResult("work_queue");
+}